@@ -18,6 +18,10 @@
     #define DEBUG_BUFFER_SIZE                       (400U)
 #endif
 
+#ifndef DEBUG_ITF_TX_RING_SIZE
+    #define DEBUG_ITF_TX_RING_SIZE                  (2048U) //! Must hold a whole f32 debug buffer in DEBUG_ITF_TX_RING_MODE
+#endif
+
 /**************************************************************************************************/
 /*                                                                                                */
 /*                                    clocking_pif definitions                                    */
@@ -0,0 +1,104 @@
+#include "debug_crc_pif.h"
+
+#include "../../../src/debug_lib/debug_port.h"
+
+/**************************************************************************************************/
+/*                                                                                                */
+/*                                  Static functions declarations                                 */
+/*                                                                                                */
+/**************************************************************************************************/
+
+static uint16_t crc_peripheral_crc16_update( uint16_t crc, const uint8_t* data, uint32_t length );
+static uint32_t crc_peripheral_crc32_update( uint32_t crc, const uint8_t* data, uint32_t length );
+static void crc_feed_data( const uint8_t* data, uint32_t length );
+
+/**************************************************************************************************/
+/*                                                                                                */
+/*                                  Global variables definitions                                  */
+/*                                                                                                */
+/**************************************************************************************************/
+
+const debug_crc_backend crc_peripheral_backend =
+{
+    .crc16_update = crc_peripheral_crc16_update,
+    .crc32_update = crc_peripheral_crc32_update,
+};
+
+/**************************************************************************************************/
+/*                                                                                                */
+/*                                  Global functions definitions                                  */
+/*                                                                                                */
+/**************************************************************************************************/
+
+/**
+ * @brief Enables CRC peripheral clock. Must be called before crc_peripheral_backend is used
+ */
+void setup_crc( void )
+{
+    RCC->AHB1ENR |= RCC_AHB1ENR_CRCEN;
+    (void)RCC->AHB1ENR; // Wait until clock is enabled
+}
+
+/**************************************************************************************************/
+/*                                                                                                */
+/*                                  Static functions definitions                                  */
+/*                                                                                                */
+/**************************************************************************************************/
+
+/**
+ * @brief CRC-16/CCITT-FALSE: 16 bit polynomial 0x1021 without input and output reversal
+ */
+static uint16_t crc_peripheral_crc16_update( uint16_t crc, const uint8_t* data, uint32_t length )
+{
+    const debug_port_critical_state critical_state = debug_port_enter_critical();
+
+    CRC->POL = 0x1021U;
+    CRC->CR = CRC_CR_POLYSIZE_0;
+    CRC->INIT = crc;
+    CRC->CR |= CRC_CR_RESET;
+    crc_feed_data(data, length);
+    crc = (uint16_t)CRC->DR;
+
+    debug_port_exit_critical(critical_state);
+    return crc;
+}
+
+/**
+ * @brief CRC-32: default polynomial 0x04C11DB7 with input reversed by byte and reversed output, so DR holds the same
+ *  reflected running value as the software version. INIT is not reversed by the peripheral, so running value is loaded reversed.
+ */
+static uint32_t crc_peripheral_crc32_update( uint32_t crc, const uint8_t* data, uint32_t length )
+{
+    const debug_port_critical_state critical_state = debug_port_enter_critical();
+
+    CRC->POL = 0x04C11DB7U;
+    CRC->CR = CRC_CR_REV_IN_0 | CRC_CR_REV_OUT;
+    CRC->INIT = __RBIT(crc);
+    CRC->CR |= CRC_CR_RESET;
+    crc_feed_data(data, length);
+    crc = CRC->DR;
+
+    debug_port_exit_critical(critical_state);
+    return crc;
+}
+
+/**
+ * @brief Writes data into the peripheral a word at a time, remaining bytes one by one. Words are written with the first byte in
+ *  the most significant position, as the peripheral processes data written into DR starting from its most significant bit.
+ */
+static void crc_feed_data( const uint8_t* data, uint32_t length )
+{
+    while(length >= 4)
+    {
+        CRC->DR = ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) | ((uint32_t)data[2] << 8) | (uint32_t)data[3];
+        data += 4;
+        length -= 4;
+    }
+
+    while(length != 0)
+    {
+        *(volatile uint8_t*)(&CRC->DR) = *data;
+        data += 1;
+        length -= 1;
+    }
+}
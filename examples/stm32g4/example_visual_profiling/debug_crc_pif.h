@@ -0,0 +1,32 @@
+// Description can be found in the end of the file
+#pragma once
+
+#ifndef DEBUG_CRC_PIF_H_
+#define DEBUG_CRC_PIF_H_
+
+#include "device_mcu_includes.h"
+
+#include "../../../src/debug_lib/debug_crc/debug_crc.h"
+
+/**************************************************************************************************/
+/*                                                                                                */
+/*                                  Global functions declarations                                 */
+/*                                                                                                */
+/**************************************************************************************************/
+
+void setup_crc( void );
+
+extern const debug_crc_backend crc_peripheral_backend;
+
+#endif /* DEBUG_CRC_PIF_H_ */
+
+/**
+ * CRC backend of the debug library based on the STM32G4 CRC peripheral.
+ *
+ * Peripheral is reconfigured on every call, so both CRC-16 and CRC-32 can be used, and the running value is loaded into INIT
+ *  register, so a CRC can be continued over several messages. Peripheral is used inside a critical section, as debug messages
+ *  can be queued from main loop and interrupts at the same time. Usage:
+ *
+ *      setup_crc();
+ *      debug_crc_set_backend(&crc_peripheral_backend);
+ */
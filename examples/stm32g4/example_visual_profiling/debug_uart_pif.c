@@ -2,6 +2,8 @@
 
 #include "../../../src/debug_lib/debug_utils.h"
 
+#include <string.h>
+
 /**************************************************************************************************/
 /*                                                                                                */
 /*                                     Peripheral definitions                                     */
@@ -26,7 +28,8 @@
  *
  * Interrupts:
  *  USART3_IRQn
- *  DMA CHx full transfer complete IRQ
+ *  DMA2_Channel1_IRQn - RX half and full transfer complete IRQ. Must have the same priority as USART3_IRQn
+ *  DMA2_Channel2_IRQn - TX full transfer complete IRQ
  */
 
 /**************************************************************************************************/
@@ -50,6 +53,23 @@
 /**************************************************************************************************/
 
 static uint8_t dma_buffer[DEBUG_UART_BUFFER_SIZE] = {0};
+// Position in dma_buffer of the first byte that wasn't handled yet. DMA write position is calculated from CNDTR
+static uint16_t rx_read_index = 0;
+
+static uart_tx_path_statistics tx_path_statistics;
+
+#ifdef DEBUG_UART_TX_CIRCULAR_MODE
+#define UART_TX_RING_HALF_SIZE              (DEBUG_UART_TX_RING_SIZE / 2U)
+
+static uint8_t tx_ring[DEBUG_UART_TX_RING_SIZE];
+
+static struct
+{
+    const uint8_t* pending_message; // Part of the transfer given to uart_send_message_dma() that isn't copied into the ring yet
+    uint32_t pending_length;
+    uint8_t idle_halves_count; // Number of last refilled halves that got only fill bytes
+} tx_circular;
+#endif /* DEBUG_UART_TX_CIRCULAR_MODE */
 
 /**************************************************************************************************/
 /*                                                                                                */
@@ -62,6 +82,12 @@ static inline void setup_uart_gpio( void );
 static inline void setup_uart_peripheral( uint32_t desired_uart_baud_rate );
 
 static inline uint16_t setup_uart_dma( void );
+static void uart_handle_received_data( void );
+
+#ifdef DEBUG_UART_TX_CIRCULAR_MODE
+static void uart_refill_tx_ring_half( uint8_t* half );
+static void uart_stop_circular_tx( void );
+#endif
 
 /**************************************************************************************************/
 /*                                                                                                */
@@ -81,6 +107,10 @@ void setup_uart( uint32_t desired_uart_baud_rate )
     setup_uart_peripheral( desired_uart_baud_rate );
 
     (void)LOG_ERROR( setup_uart_dma() );
+
+    // DWT cycle counter is used to measure time spent on the TX path. Counter is not reset, as it can be used by profiling
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
 }
 
 
@@ -95,59 +125,72 @@ void setup_uart( uint32_t desired_uart_baud_rate )
  *
  * @update-type: #auto
  *
+ * Function doesn't wait for the previous message to leave the shift register. DMA only writes into TDR when USART sets TXE,
+ *  so the new transfer simply continues right after the last byte of the previous one. It must only be called when previous
+ *  DMA transfer is finished, which is guaranteed by the debug protocol TX queue.
+ *
  * @note The message must live long enough to be copied by the DMA! If message is corrupted so will
  * be the transfer. This is a problem of this implementation, but it also allows us not to use any other buffer in between.
  */
 void uart_send_message_dma( const uint8_t* message, const uint32_t message_len )
 {
-    while ( (USART3->ISR & USART_ISR_TC) != USART_ISR_TC ){} // Check that the last message was fully sent
+#ifdef DEBUG_UART_TX_CIRCULAR_MODE
+    // Message is only copied into the ring, DMA never reads it directly in circular mode
+    tx_circular.pending_message = message;
+    tx_circular.pending_length = message_len;
+    tx_circular.idle_halves_count = 0;
+
+    uart_refill_tx_ring_half(&tx_ring[0]);
+    uart_refill_tx_ring_half(&tx_ring[UART_TX_RING_HALF_SIZE]);
+
+    UART_TX_DMA_CH->CCR &= ~DMA_CCR_EN;
+
+    UART_TX_DMA_CH->CMAR = (uint32_t)tx_ring;
+    UART_TX_DMA_CH->CNDTR = DEBUG_UART_TX_RING_SIZE;
+
+    UART_TX_DMA_CH->CCR  |= DMA_CCR_MINC // Memory increment mode
+                        | DMA_CCR_DIR   // Send from memory to peripheral
+                        | DMA_CCR_CIRC  // Restart from the ring start after the last byte
+                        | DMA_CCR_HTIE  // Refill first half when it was sent
+                        | DMA_CCR_EN;   // Enable DMA
+
+    tx_path_statistics.transfers_count += 1;
+    return;
+#endif /* DEBUG_UART_TX_CIRCULAR_MODE */
 
     UART_TX_DMA_CH->CCR &= ~DMA_CCR_EN;
 
     UART_TX_DMA_CH->CMAR = (uint32_t)message;   // Set new source memory address
     UART_TX_DMA_CH->CNDTR = message_len;
 
-    USART3->ICR = USART_ICR_TCCF; // Clear "Transmission complete" flag
-
     UART_TX_DMA_CH->CCR  |= DMA_CCR_MINC // Memory increment mode
                         | DMA_CCR_DIR   // Send from memory to peripheral
                         | DMA_CCR_EN;   // Enable DMA
-}
 
-/**
- * @brief returns the length of the message received by DMA
- *
- * @update-type: #auto
- */
-uint32_t uart_get_received_message_len( void )
-{
-    return (DEBUG_UART_BUFFER_SIZE - UART_RX_DMA_CH->CNDTR);
+    tx_path_statistics.transfers_count += 1;
 }
 
 /**
- * @brief
+ * @brief Returns CPU time spent on the TX path
  *
  * @update-type: #none
  */
-uint8_t* uart_get_receive_buffer( void )
+const uart_tx_path_statistics* uart_get_tx_path_statistics( void )
 {
-    return dma_buffer;
+    return &tx_path_statistics;
 }
 
 /**
- * @brief
+ * @brief Returns DWT cycle counter that is enabled in setup_uart(). Used by debug interface to measure TX block timeouts
  *
- * @update-type: #auto
+ * @update-type: #none
  */
-inline void uart_reset_rx_dma( void )
+uint32_t uart_get_cycle_count( void )
 {
-    UART_RX_DMA_CH->CCR &= ~DMA_CCR_EN; // Disable DMA.
-
-    UART_RX_DMA_CH->CNDTR = DEBUG_UART_BUFFER_SIZE; // Reset memory location
-    UART_RX_DMA_CH->CCR  |= DMA_CCR_MINC // Memory increment mode
-                        | DMA_CCR_EN;   // Enable DMA
+    return DWT->CYCCNT;
 }
 
+
 /**************************************************************************************************/
 /*                                                                                                */
 /*                                 Static functions implementations                               */
@@ -187,7 +230,8 @@ static inline void setup_uart_peripheral( const uint32_t desired_uart_baud_rate
     USART3->BRR = SYSTEM_CLOCK_FREQUENCY_HZ / desired_uart_baud_rate; // Baud rate for oversampling by 16
     USART3->CR1 |= USART_CR1_UE     // Start UART
 //                | USART_CR1_FIFOEN  // Enable FIFOs
-                | USART_CR1_RTOIE;  // Enable receiver timeout interrupt
+                | USART_CR1_RTOIE   // Enable receiver timeout interrupt
+                | USART_CR1_IDLEIE; // Enable idle line interrupt
 
     USART3->CR2 |= USART_CR2_RTOEN; // Enable receiver timeout;
     USART3->RTOR = 10; // number of bits before receiver timeout interrupt;
@@ -230,8 +274,12 @@ static inline uint16_t setup_uart_dma( void )
     UART_RX_DMA_CH->CPAR = (uint32_t)&(USART3->RDR);
     UART_RX_DMA_CH->CMAR = (uint32_t)dma_buffer;
     UART_RX_DMA_CH->CNDTR = DEBUG_UART_BUFFER_SIZE;     // Number of bytes to receive;
-    UART_RX_DMA_CH->CCR |= DMA_CCR_MINC;
+    UART_RX_DMA_CH->CCR |= DMA_CCR_MINC
+                        | DMA_CCR_CIRC      // DMA is never stopped, received bytes are handled behind it
+                        | DMA_CCR_HTIE      // Handle received bytes before DMA wraps around,
+                        | DMA_CCR_TCIE;     //  even if host never stops sending
     UART_RX_DMA_CH->CCR |= DMA_CCR_EN;              // Enable RX DMA channel
+    NVIC_EnableIRQ( DMA2_Channel1_IRQn ); // [#manual]
 
     // Set only peripheral address for TX
     UART_TX_DMA_CH->CPAR = (uint32_t)&(USART3->TDR);
@@ -243,6 +291,95 @@ static inline uint16_t setup_uart_dma( void )
 }
 
 
+/**
+ * @brief Hands all bytes written by RX DMA since the last call over to the debug protocol. Bytes are passed as one or two
+ *  spans, as the received data can wrap around the end of the ring.
+ *
+ * @note Must only be called from interrupts of the same priority, so that calls never preempt each other
+ *
+ * @update-type: #auto
+ */
+static void uart_handle_received_data( void )
+{
+    uint16_t write_index = DEBUG_UART_BUFFER_SIZE - UART_RX_DMA_CH->CNDTR;
+    if(write_index == DEBUG_UART_BUFFER_SIZE)
+    {
+        write_index = 0;
+    }
+
+    if(write_index == rx_read_index)
+    {
+        return;
+    }
+
+    if(write_index > rx_read_index)
+    {
+        debug_handle_rx(&dma_buffer[rx_read_index], write_index - rx_read_index);
+    }
+    else
+    {
+        debug_handle_rx(&dma_buffer[rx_read_index], DEBUG_UART_BUFFER_SIZE - rx_read_index);
+        debug_handle_rx(&dma_buffer[0], write_index);
+    }
+
+    rx_read_index = write_index;
+}
+
+
+#ifdef DEBUG_UART_TX_CIRCULAR_MODE
+/**
+ * @brief Fills half of the TX ring with the rest of the pending transfer and data pulled from the debug protocol.
+ *  Free space that is left is filled with DEBUG_UART_TX_FILL_BYTE.
+ *
+ * @update-type: #none
+ */
+static void uart_refill_tx_ring_half( uint8_t* half )
+{
+    uint32_t filled_length = 0;
+
+    if(tx_circular.pending_length != 0)
+    {
+        filled_length = tx_circular.pending_length;
+        if(filled_length > UART_TX_RING_HALF_SIZE)
+        {
+            filled_length = UART_TX_RING_HALF_SIZE;
+        }
+
+        memcpy(half, tx_circular.pending_message, filled_length);
+        tx_circular.pending_message += filled_length;
+        tx_circular.pending_length -= filled_length;
+    }
+
+    if(tx_circular.pending_length == 0)
+    {
+        filled_length += debug_itf_pull_tx_data(&half[filled_length], UART_TX_RING_HALF_SIZE - filled_length);
+    }
+
+    memset(&half[filled_length], DEBUG_UART_TX_FILL_BYTE, UART_TX_RING_HALF_SIZE - filled_length);
+
+    if(filled_length == 0)
+    {
+        tx_circular.idle_halves_count += 1;
+    }
+    else
+    {
+        tx_circular.idle_halves_count = 0;
+    }
+}
+
+/**
+ * @brief Stops circular TX DMA. Only fill bytes can be lost, as it is called when both halves of the ring have nothing else.
+ *
+ * @update-type: #auto
+ */
+static void uart_stop_circular_tx( void )
+{
+    UART_TX_DMA_CH->CCR &= ~(DMA_CCR_EN | DMA_CCR_CIRC | DMA_CCR_HTIE);
+    DMA2->IFCR = DMA_IFCR_CTCIF2 | DMA_IFCR_CHTIF2 | DMA_IFCR_CGIF2; // [#manual]
+}
+#endif /* DEBUG_UART_TX_CIRCULAR_MODE */
+
+
 /**************************************************************************************************/
 /*                                                                                                */
 /*                                        Interrupt handlers                                      */
@@ -254,22 +391,13 @@ static inline uint16_t setup_uart_dma( void )
  */
 void USART3_IRQHandler()
 {
-    // UART data receive sections
-    if( USART3->ISR & USART_ISR_RTOF ) // UART message received
+    // UART data receive sections. RX DMA keeps running, so only bytes received since the last event are handled
+    if( USART3->ISR & (USART_ISR_RTOF | USART_ISR_IDLE) ) // Host stopped sending
     {
-        // Read and do something with data received from DMA
-        const uint16_t received_size = uart_get_received_message_len();
-        uint8_t* received_buffer = uart_get_receive_buffer();
-
-        // Reset RX DMA after every timeout to make DMA write back from 0.
-        // Given that we work with pointers, this can cause first bytes of the bu ffer to be overwritten
-        // If a new message from master arrives right away. But behaviour like this is hard to effectively
-        // prevent, and therefore it will be considered as an error on the side of the master implementation.
-        uart_reset_rx_dma();
-
-        debug_handle_rx(received_buffer, received_size);
+        // Flags are cleared first, so bytes received while they are handled raise the event again
+        USART3->ICR = USART_ICR_RTOCF | USART_ICR_IDLECF;
 
-        USART3->ICR |= USART_ICR_RTOCF; // Clear the timeout interrupt flag
+        uart_handle_received_data();
     }
 
     // UART error handling section
@@ -293,19 +421,66 @@ void USART3_IRQHandler()
 }
 
 
+/**
+ * @brief debug UART RX DMA interrupt handler. Hands received bytes over every half of the ring, so that DMA never overwrites
+ *  bytes that weren't handled, even if the host sends without pauses.
+ */
+void DMA2_CH1_IRQHandler( void )
+{
+    if(DMA2->ISR & (DMA_ISR_HTIF1 | DMA_ISR_TCIF1))
+    {
+        DMA2->IFCR = DMA_IFCR_CHTIF1 | DMA_IFCR_CTCIF1;
+
+        uart_handle_received_data();
+    }
+}
+
+
 /**
  * @brief debug UART TX DMA interrupt handler
  */
 void DMA2_CH2_IRQHandler( void )
 {
-    if(DMA2->ISR & DMA_ISR_TCIF2)
+    const uint32_t interrupt_start_cycle = DWT->CYCCNT;
+
+#ifdef DEBUG_UART_TX_CIRCULAR_MODE
+    if(DMA2->ISR & DMA_ISR_HTIF2) // First half was sent, DMA is now sending the second one
     {
-        debug_handle_tx();
+        DMA2->IFCR = DMA_IFCR_CHTIF2;
+        uart_refill_tx_ring_half(&tx_ring[0]);
+    }
 
+    if(DMA2->ISR & DMA_ISR_TCIF2) // Second half was sent, DMA is now sending the first one
+    {
+        DMA2->IFCR = DMA_IFCR_CTCIF2;
+        uart_refill_tx_ring_half(&tx_ring[UART_TX_RING_HALF_SIZE]);
+    }
+
+    if(tx_circular.idle_halves_count >= 2)
+    {
+        uart_stop_circular_tx();
+
+        // Lets debug protocol know that TX is idle. It restarts TX right away if something was queued after the last refill
+        debug_handle_tx();
+    }
+#else
+    if(DMA2->ISR & DMA_ISR_TCIF2)
+    {
         // Clear full transfer complete, half transfer complete and global interrupt flags for DMA channel.
         //  Even though CGIFx will clear all other flags by itself, all 3 flags are cleared manually for possible
-        //  Compatibility reasons with other STM32 families
+        //  Compatibility reasons with other STM32 families.
+        //  Flags are cleared before the next transfer is started, so that its completion can't be missed.
         DMA2->IFCR = DMA_IFCR_CTCIF2 | DMA_IFCR_CHTIF2 | DMA_IFCR_CGIF2;
+
+        debug_handle_tx();
+    }
+#endif /* DEBUG_UART_TX_CIRCULAR_MODE */
+
+    const uint32_t interrupt_cycles = DWT->CYCCNT - interrupt_start_cycle;
+    tx_path_statistics.interrupt_cycles_total += interrupt_cycles;
+    if(interrupt_cycles > tx_path_statistics.interrupt_cycles_max)
+    {
+        tx_path_statistics.interrupt_cycles_max = interrupt_cycles;
     }
 }
 
@@ -17,12 +17,38 @@
 /*                                                                                                */
 /**************************************************************************************************/
 
-// The size of the UART RX software queue. The max possible length of a single received message must be smaller
-//  than this value.
+// The size of the UART RX ring. RX DMA writes into it in circular mode and received bytes are handled on UART idle line, receiver
+//  timeout, half transfer and transfer complete events. No byte is lost as long as these interrupts are handled before
+//  DMA writes half of the ring.
 #ifndef DEBUG_UART_BUFFER_SIZE
     #define DEBUG_UART_BUFFER_SIZE          (64U)   // Must not be smaller than 3 or bigger than 2^16-1
 #endif
 
+// Define DEBUG_UART_TX_CIRCULAR_MODE to run TX DMA in circular mode over a ring of DEBUG_UART_TX_RING_SIZE bytes. Every half of
+//  the ring is refilled with queued debug data on half transfer and transfer complete events, so UART never idles between
+//  messages while there is data to send. Free space is filled with DEBUG_UART_TX_FILL_BYTE, which the client must skip
+//  before every message. DMA is stopped when both halves contain only fill bytes.
+#ifndef DEBUG_UART_TX_RING_SIZE
+    #define DEBUG_UART_TX_RING_SIZE         (256U)  // Must be even and not bigger than 2^16-1
+#endif
+#ifndef DEBUG_UART_TX_FILL_BYTE
+    #define DEBUG_UART_TX_FILL_BYTE         (0x00U)
+#endif
+
+/**************************************************************************************************/
+/*                                                                                                */
+/*                                     Global types declarations                                  */
+/*                                                                                                */
+/**************************************************************************************************/
+
+// Time spent by CPU on the TX path. Measured in DWT clock cycles
+typedef struct uart_tx_path_statistics
+{
+    uint32_t interrupt_cycles_total; // All cycles spent in TX DMA interrupt, including start of the next transfer
+    uint32_t interrupt_cycles_max; // The longest single TX DMA interrupt
+    uint32_t transfers_count; // Number of started DMA transfers
+} uart_tx_path_statistics;
+
 /**************************************************************************************************/
 /*                                                                                                */
 /*                                  Global functions declarations                                 */
@@ -33,11 +59,8 @@ void setup_uart( uint32_t desired_uart_baud_rate );
 void setup_debug_uart_dma_interrupt( void );
 
 void uart_send_message_dma( const uint8_t *message, const uint32_t message_length );
-
-uint32_t uart_get_received_message_len( void );
-uint8_t* uart_get_receive_buffer( void );
-
-void uart_reset_rx_dma( void );
+const uart_tx_path_statistics* uart_get_tx_path_statistics( void );
+uint32_t uart_get_cycle_count( void );
 
 /**************************************************************************************************/
 /*                                                                                                */
@@ -49,6 +72,10 @@ void uart_reset_rx_dma( void );
     #error "DEBUG_UART_BUFFER_SIZE must be >2 and < 2^16-1 for DMA to work properly. Change DEBUG_UART_BUFFER_SIZE value accordingly"
 #endif
 
+#if (DEBUG_UART_TX_RING_SIZE % 2) != 0 || DEBUG_UART_TX_RING_SIZE > UINT16_MAX
+    #error "DEBUG_UART_TX_RING_SIZE must be even and < 2^16-1 for circular DMA to work properly. Change DEBUG_UART_TX_RING_SIZE value accordingly"
+#endif
+
 /**************************************************************************************************/
 /*                                                                                                */
 /*                          Full Defines template for _pif_derinitions.h                          */
@@ -64,6 +91,10 @@ void uart_reset_rx_dma( void );
 
 #define DEBUG_UART_BUFFER_SIZE                 (64U)
 
+#define DEBUG_UART_TX_CIRCULAR_MODE
+#define DEBUG_UART_TX_RING_SIZE                (256U)
+#define DEBUG_UART_TX_FILL_BYTE                (0x00U)
+
 #endif /* 0 */
 
 #endif /* DEVICE_DEBUG_PIF_H_ */
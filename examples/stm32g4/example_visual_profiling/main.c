@@ -1,4 +1,7 @@
 #include "debug_uart_pif.h"
+#include "debug_crc_pif.h"
+#include "../../../src/debug_lib/debug_memory/debug_memory.h"
+#include "../../../src/debug_lib/debug_watch/debug_watch.h"
 #include "profiling_pif.h"
 
 #include "utils_pif.h"
@@ -66,8 +69,24 @@ enum profiling_event_name_id_t
 debug_transport uart_transport =
 {
         .send = uart_send_message_dma,
+        .get_cycle_count = uart_get_cycle_count,
 };
 
+#ifdef DEBUG_ITF_RX_DEFERRED_MODE
+/**
+ * @brief Requests are handled in PendSV with the lowest priority, so that they never delay other interrupts
+ */
+void debug_itf_rx_job_queued_cbk( void )
+{
+    SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
+}
+
+void PendSV_Handler( void )
+{
+    debug_poll();
+}
+#endif /* DEBUG_ITF_RX_DEFERRED_MODE */
+
 /**************************************************************************************************/
 /*                                                                                                */
 /*                                         Main function                                          */
@@ -133,7 +152,18 @@ int main(void)
     setup_system_clock();
 
     setup_uart(500000);
+    setup_crc();
+    debug_crc_set_backend(&crc_peripheral_backend); // Frame CRC trailers are calculated by the CRC peripheral
     setup_debug_interface(&uart_transport);
+    // Variables and GPIOB registers can be looked at and changed live with peek and poke requests
+    debug_memory_add_region(SRAM1_BASE, SRAM1_SIZE_MAX, DEBUG_MEMORY_READ_WRITE, DEBUG_MEMORY_ANY_WIDTH);
+    debug_memory_add_region(GPIOB_BASE, sizeof(GPIO_TypeDef), DEBUG_MEMORY_READ_WRITE, DEBUG_MEMORY_32_BIT);
+    debug_memory_register_commands();
+    // Client can upload a watch list of variables instead of the profiling stream, once the profiling stream is unregistered
+    debug_watch_register_commands();
+#ifdef DEBUG_ITF_RX_DEFERRED_MODE
+    NVIC_SetPriority(PendSV_IRQn, (1UL << __NVIC_PRIO_BITS) - 1UL); // Lowest priority
+#endif
 
     setup_profiling_stream_tracing();
     setup_profiling_buffer_tracing();
@@ -200,6 +230,7 @@ int main(void)
         profiling_stream_trace_event_end(&profiling_all);
         GPIOB->BSRR = GPIO_BSRR_BR_0;
 
+        debug_watch_sample(); // A sample per loop iteration. Does nothing until a watch list is set
         dummy_delay_us(MSEC_TO_USEC(500));
     }
 }
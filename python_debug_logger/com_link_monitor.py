@@ -0,0 +1,48 @@
+# Prints live TX link utilization of the device. Used to tune queue lengths, stream sizes and baud rate
+
+import serial
+
+import hople_com_dbg_protocol as cdp
+
+# Import definitions for console coloring
+from helper_scripts import console_colors
+bcolors = console_colors.bcolors
+
+serial_port:serial.Serial = None
+
+
+def main():
+    baud_rate = 500000 #! Change baud rate here
+
+    try:
+        global serial_port
+        serial_port = serial.Serial(
+            port = "COM18", #! Change comport here
+            baudrate = baud_rate,
+            bytesize = serial.EIGHTBITS,
+            parity = serial.PARITY_NONE,
+            stopbits = serial.STOPBITS_ONE,
+            timeout = 0.1,
+        )
+        print(f'Connected to port {bcolors.OKBLUE}{serial_port.port}{bcolors.ENDC}')
+    except:
+        print(f'{bcolors.FAIL}Failed to open serial port!{bcolors.ENDC}')
+        serial_port = None
+        exit()
+
+    # make sure that connection is established before doing anything else
+    device_connected = cdp.establish_connection(serial_port)
+    if(device_connected == False):
+        print("Connection failed!")
+        return
+
+    cdp.read_tx_queue_statistics(serial_port)
+    cdp.read_tx_drop_statistics(serial_port)
+
+    cdp.monitor_link_utilization(serial_port, baud_rate, period_s = 1.0)
+
+    cdp.close_connection(serial_port)
+
+
+if __name__ == "__main__":
+    main()
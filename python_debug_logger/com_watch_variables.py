@@ -0,0 +1,63 @@
+import serial
+import argparse
+
+import hople_com_dbg_protocol as cdp
+
+# Import definitions for console coloring
+from helper_scripts import console_colors
+bcolors = console_colors.bcolors
+
+serial_port:serial.Serial = None
+
+parser = argparse.ArgumentParser(
+    description="""Samples firmware variables on the device and saves them into a .csv file inside logs/ folder.
+Variables are found by name in the firmware ELF file, so no stream has to be written into the firmware.""",
+)
+parser.add_argument("elf_file", type=str, help="Firmware ELF file built with debug info")
+parser.add_argument("variables", type=str, nargs="+", help='Variables to watch, like "counter", "motor.speed" or "samples[3]"')
+parser.add_argument("--entries-per-message", type=int, default=1, help="Samples sent in a single stream message")
+parser.add_argument("--sample-divider", type=int, default=1, help="Sample on every N-th debug_watch_sample() call")
+parser.add_argument("--duration", type=float, default=0, help="Logging duration in seconds. 0 logs until stream times out")
+
+
+def main():
+    """Prerequisites:
+     1. logs/ folder must exist inside the folder with this .py file;
+     2. pyelftools must be installed;
+     3. Firmware must call debug_memory_register_commands(), debug_watch_register_commands() and debug_watch_sample() periodically,
+        and allow reading of the watched variables with debug_memory_add_region(). No other stream must be registered;
+     4. COM port and baud rate inside the main function must correspond to USB-UART converter and the connected MCU.
+    """
+    arguments = parser.parse_args()
+
+    try:
+        global serial_port
+        serial_port = serial.Serial(
+            port = "COM18", #! Change comport here
+            baudrate = 500000, #! Change baud rate here
+            bytesize = serial.EIGHTBITS,
+            parity = serial.PARITY_NONE,
+            stopbits = serial.STOPBITS_ONE,
+            timeout = 0.1,
+        )
+        print(f'Connected to port {bcolors.OKBLUE}{serial_port.port}{bcolors.ENDC}')
+    except:
+        print(f'{bcolors.FAIL}Failed to open serial port!{bcolors.ENDC}')
+        serial_port = None
+        exit()
+
+    # make sure that connection is established before doing anything else
+    device_connected = cdp.establish_connection(serial_port)
+    if(device_connected == False):
+        print("Connection failed!")
+        return
+
+    if (cdp.watch_variables(serial_port, arguments.elf_file, arguments.variables, arguments.entries_per_message, arguments.sample_divider)):
+        cdp.save_streaming_data(serial_port, arguments.duration)
+        cdp.set_watch_list(serial_port, []) # Stop sampling
+
+    cdp.close_connection(serial_port)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,223 @@
+# Resolves firmware variables into addresses and debug data types, so they can be watched without changing the firmware.
+# Requires pyelftools (pip install pyelftools). Firmware must be built with debug info (-g) for types, struct members and arrays.
+
+import re
+
+from elftools.elf.elffile import ELFFile
+
+# Values of BUFFER_TYPE / DEBUG_DATA_TYPE
+F32_TYPE = 1
+I32_TYPE = 2
+U32_TYPE = 3
+I16_TYPE = 4
+U16_TYPE = 5
+U8_TYPE = 6
+
+# DWARF base type encodings
+DW_ATE_BOOLEAN = 0x02
+DW_ATE_FLOAT = 0x04
+DW_ATE_SIGNED = 0x05
+DW_ATE_SIGNED_CHAR = 0x06
+DW_ATE_UNSIGNED = 0x07
+DW_ATE_UNSIGNED_CHAR = 0x08
+
+DW_OP_ADDR = 0x03
+DW_OP_PLUS_UCONST = 0x23
+
+# Tags that don't change the layout of the type they refer to
+TRANSPARENT_TYPE_TAGS = ("DW_TAG_typedef", "DW_TAG_const_type", "DW_TAG_volatile_type", "DW_TAG_restrict_type", "DW_TAG_atomic_type")
+
+# Variable name followed by any number of .member and [index] parts, like "motor.currents[2].d"
+EXPRESSION_PART = re.compile(r"\.([A-Za-z_]\w*)|\[(\d+)\]")
+EXPRESSION_NAME = re.compile(r"[A-Za-z_]\w*")
+
+class ElfVariables:
+    """Variables of a firmware ELF file. Resolves expressions like "name", "name.member" or "name[3]" into
+    (address, data type, size) tuples. Only values that are 1, 2 or 4 bytes long can be resolved.
+
+    Signed 8 bit values are read as U8_TYPE, as the debug protocol has no signed 8 bit type.
+    """
+
+    def __init__(self, elf_path: str):
+        self.variables = {} # name -> (address, type DIE or None, size)
+        with open(elf_path, "rb") as elf_file:
+            elf = ELFFile(elf_file)
+            self._read_symbols(elf)
+            if (elf.has_dwarf_info()):
+                self._read_dwarf(elf)
+
+    def resolve(self, expression: str):
+        """Returns (address, data type, size) of the expression. Raises ValueError if it can't be resolved"""
+        name_match = EXPRESSION_NAME.match(expression)
+        if (name_match is None or name_match.group(0) not in self.variables):
+            raise ValueError(f"Variable of '{expression}' is not found")
+
+        address, type_die, size = self.variables[name_match.group(0)]
+        position = name_match.end()
+        while (position < len(expression)):
+            part = EXPRESSION_PART.match(expression, position)
+            if (part is None):
+                raise ValueError(f"Can't parse '{expression}' at position {position}")
+            if (type_die is None):
+                raise ValueError(f"'{expression}' needs debug info, but variable has none")
+
+            if (part.group(1) is not None):
+                offset, type_die = self._member(type_die, part.group(1), expression)
+            else:
+                offset, type_die = self._element(type_die, int(part.group(2)), expression)
+            address += offset
+            position = part.end()
+
+        if (type_die is None):
+            # Only symbol table is known, so value is read as unsigned
+            return address, self._data_type(DW_ATE_UNSIGNED, size, expression), size
+
+        type_die = self._strip(type_die)
+        size = type_die.attributes["DW_AT_byte_size"].value if "DW_AT_byte_size" in type_die.attributes else 0
+        if (type_die.tag == "DW_TAG_base_type"):
+            return address, self._data_type(type_die.attributes["DW_AT_encoding"].value, size, expression), size
+        if (type_die.tag in ("DW_TAG_enumeration_type", "DW_TAG_pointer_type")):
+            size = size if size != 0 else 4
+            return address, self._data_type(DW_ATE_UNSIGNED, size, expression), size
+        raise ValueError(f"'{expression}' is not a basic value. Select a member or an element of it")
+
+    ########################################
+
+    def _read_symbols(self, elf: ELFFile):
+        """Data objects of the symbol table. Used for variables without debug info"""
+        symbol_table = elf.get_section_by_name(".symtab")
+        if (symbol_table is None):
+            return
+
+        for symbol in symbol_table.iter_symbols():
+            if (symbol["st_info"]["type"] == "STT_OBJECT" and symbol.name != ""):
+                self.variables[symbol.name] = (symbol["st_value"], None, symbol["st_size"])
+
+    def _read_dwarf(self, elf: ELFFile):
+        """Variables with static storage and their types"""
+        for compile_unit in elf.get_dwarf_info().iter_CUs():
+            for die in compile_unit.iter_DIEs():
+                if (die.tag != "DW_TAG_variable" or "DW_AT_location" not in die.attributes):
+                    continue
+
+                location = die.attributes["DW_AT_location"].value
+                if (not isinstance(location, list) or len(location) < 2 or location[0] != DW_OP_ADDR):
+                    continue # Local variable or location list
+
+                declaration = die
+                if ("DW_AT_specification" in die.attributes):
+                    declaration = die.get_DIE_from_attribute("DW_AT_specification")
+                if ("DW_AT_name" not in declaration.attributes or "DW_AT_type" not in declaration.attributes):
+                    continue
+
+                name = declaration.attributes["DW_AT_name"].value.decode()
+                address = int.from_bytes(bytes(location[1:]), "little")
+                # Symbol table size is kept, as function static variables can share the name with a global one
+                if (name not in self.variables or self.variables[name][1] is None):
+                    self.variables[name] = (address, declaration.get_DIE_from_attribute("DW_AT_type"), 0)
+
+    def _strip(self, type_die):
+        while (type_die.tag in TRANSPARENT_TYPE_TAGS and "DW_AT_type" in type_die.attributes):
+            type_die = type_die.get_DIE_from_attribute("DW_AT_type")
+        return type_die
+
+    def _member(self, type_die, member_name: str, expression: str):
+        """Returns (offset, type) of the struct or union member"""
+        type_die = self._strip(type_die)
+        if (type_die.tag not in ("DW_TAG_structure_type", "DW_TAG_union_type")):
+            raise ValueError(f"'{expression}': .{member_name} is used on a value that is not a struct")
+
+        for member in type_die.iter_children():
+            if (member.tag != "DW_TAG_member" or "DW_AT_name" not in member.attributes):
+                continue
+            if (member.attributes["DW_AT_name"].value.decode() != member_name):
+                continue
+
+            offset = 0
+            if ("DW_AT_data_member_location" in member.attributes):
+                offset = member.attributes["DW_AT_data_member_location"].value
+                if (isinstance(offset, list)): # Older DWARF versions use DW_OP_plus_uconst expression
+                    offset = self._uleb128(offset[1:]) if (offset[0] == DW_OP_PLUS_UCONST) else 0
+            return offset, member.get_DIE_from_attribute("DW_AT_type")
+
+        raise ValueError(f"'{expression}': member {member_name} is not found")
+
+    def _element(self, type_die, index: int, expression: str):
+        """Returns (offset, type) of the array element. Multidimensional arrays take an index per dimension"""
+        type_die = self._strip(type_die)
+        dimensions = getattr(type_die, "remaining_dimensions", None)
+        if (dimensions is None):
+            if (type_die.tag != "DW_TAG_array_type"):
+                raise ValueError(f"'{expression}': [{index}] is used on a value that is not an array")
+            dimensions = [self._dimension_length(subrange) for subrange in type_die.iter_children()
+                          if subrange.tag == "DW_TAG_subrange_type"]
+            element_die = type_die.get_DIE_from_attribute("DW_AT_type")
+        else:
+            element_die = type_die.element_die
+
+        if (dimensions[0] is not None and index >= dimensions[0]):
+            raise ValueError(f"'{expression}': index {index} is out of array bounds {dimensions[0]}")
+
+        element_size = self._size(element_die)
+        for length in dimensions[1:]:
+            element_size *= length
+
+        if (len(dimensions) == 1):
+            return index * element_size, element_die
+        return index * element_size, ArrayDimensions(element_die, dimensions[1:])
+
+    def _dimension_length(self, subrange):
+        if ("DW_AT_count" in subrange.attributes):
+            return subrange.attributes["DW_AT_count"].value
+        if ("DW_AT_upper_bound" in subrange.attributes):
+            return subrange.attributes["DW_AT_upper_bound"].value + 1
+        return None # Flexible array
+
+    def _size(self, type_die):
+        if (isinstance(type_die, ArrayDimensions)):
+            size = self._size(type_die.element_die)
+            for length in type_die.remaining_dimensions:
+                size *= length
+            return size
+
+        type_die = self._strip(type_die)
+        if ("DW_AT_byte_size" in type_die.attributes):
+            return type_die.attributes["DW_AT_byte_size"].value
+        if (type_die.tag == "DW_TAG_array_type"):
+            size = self._size(type_die.get_DIE_from_attribute("DW_AT_type"))
+            for subrange in type_die.iter_children():
+                if (subrange.tag == "DW_TAG_subrange_type"):
+                    size *= self._dimension_length(subrange) or 0
+            return size
+        raise ValueError(f"Size of type {type_die.tag} is unknown")
+
+    def _data_type(self, encoding: int, size: int, expression: str):
+        if (encoding == DW_ATE_FLOAT and size == 4):
+            return F32_TYPE
+        if (encoding in (DW_ATE_SIGNED, DW_ATE_SIGNED_CHAR)):
+            signed_types = {4: I32_TYPE, 2: I16_TYPE, 1: U8_TYPE}
+            if (size in signed_types):
+                return signed_types[size]
+        if (encoding in (DW_ATE_UNSIGNED, DW_ATE_UNSIGNED_CHAR, DW_ATE_BOOLEAN)):
+            unsigned_types = {4: U32_TYPE, 2: U16_TYPE, 1: U8_TYPE}
+            if (size in unsigned_types):
+                return unsigned_types[size]
+        raise ValueError(f"'{expression}' has {size} byte type with encoding {encoding:#04x}, that can't be sent by debug protocol")
+
+    def _uleb128(self, data: list):
+        value = 0
+        for shift, byte in enumerate(data):
+            value |= (byte & 0x7F) << (7 * shift)
+            if ((byte & 0x80) == 0):
+                break
+        return value
+
+
+class ArrayDimensions:
+    """Inner dimensions of a multidimensional array that are left after the outer ones were indexed"""
+
+    def __init__(self, element_die, remaining_dimensions: list):
+        self.element_die = element_die
+        self.remaining_dimensions = remaining_dimensions
+        self.tag = "DW_TAG_array_type"
+        self.attributes = {}
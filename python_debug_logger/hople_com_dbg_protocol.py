@@ -8,6 +8,8 @@ import csv
 import os.path
 import io
 import json
+import binascii
+import zlib
 
 from enum import Enum
 
@@ -27,6 +29,9 @@ message_close_connection = bytearray(message_prefix + [0x02])
 message_keep_alive = bytearray(message_prefix + [0x03])
 
 message_read_error_log = bytearray(message_prefix + [0x08])
+message_read_link_telemetry = bytearray(message_prefix + [0x09])
+message_read_tx_queue_statistics = bytearray(message_prefix + [0x0A])
+message_read_tx_drop_statistics = bytearray(message_prefix + [0x0B])
 message_read_buffers_properties = bytearray(message_prefix + [0x10])
 message_read_debug_buffer = bytearray(message_prefix + [0x00])
 
@@ -36,6 +41,64 @@ message_stop_streaming = bytearray(message_prefix + [0x33])
 
 message_generic_request = bytearray(message_prefix + [0x40])
 
+# Requests with this bit set in the code carry u16 little endian payload length and the payload. Replies with payload use the same format
+payload_flag = 0x80
+generic_parameter_request_base_code = 0xC0
+set_frame_crc_code = 0x8C
+# Payload: u8 tag and the wrapped request without prefix. Every reply to it comes as: prefix, tagged_request_code, u16 length, u8 tag, reply
+tagged_request_code = 0x8D
+# Memory access. Only regions allowed on the device with debug_memory_add_region() can be accessed
+peek_memory_code = 0x8E # Payload: u32 address, u16 length. Replied with payload that holds memory content
+poke_memory_code = 0x8F # Payload: u32 address, data. Replied with ACK
+# Payload: u16 sample divider, u16 entries per message, then u32 address and u8 BUFFER_TYPE value of every entry. Replied with ACK
+set_watch_list_code = 0x90
+# Payload: u32 address and u16 length of every range. Replied with payload that holds all ranges one after another
+scatter_read_code = 0x91
+# Reads ranges of the last scatter read again. Replied with repeat_scatter_read_reply_code and payload that holds all ranges
+repeat_scatter_read_code = 0x0C
+repeat_scatter_read_reply_code = 0x95
+message_repeat_scatter_read = bytearray(message_prefix + [repeat_scatter_read_code])
+# Payload: u8 mode (0 - immediately, 1 - at device sync point), then optional scatter read ranges. Replied with payload:
+#  u32 capture cycles, u32 max capture cycles, content of all ranges copied at once
+snapshot_code = 0x92
+# Payload: u8 1 to freeze all registered buffers, 0 to unfreeze them. Replied with ACK
+freeze_buffers_code = 0x93
+# Trigger of debug buffers. Arm payload: u8 buffer index, u8 TRIGGER_CONDITION, u8 trigger mode, u16 post trigger samples,
+#  u32 level, u32 upper level. Replied with ACK
+trigger_arm_code = 0x94
+message_trigger_disarm = bytearray(message_prefix + [0x0D])
+message_trigger_status = bytearray(message_prefix + [0x0E]) # Replied with u8 TRIGGER_STATE, u16 post trigger samples, u32 captures count
+
+scatter_read_lengths = [] # Lengths of the last scatter read ranges, used to split replies to repeated reads
+
+
+
+class FRAME_CRC(Enum):
+    NONE = 0
+    CRC16 = 1 # CRC-16/CCITT-FALSE
+    CRC32 = 2 # CRC-32, same as zlib.crc32
+
+
+class TX_DROP_POLICY(Enum):
+    DROP_NEWEST = 0
+    DROP_OLDEST = 1
+    BLOCK = 2
+
+
+class TRIGGER_CONDITION(Enum):
+    ABOVE = 0
+    BELOW = 1
+    RISING_EDGE = 2
+    FALLING_EDGE = 3
+    ANY_EDGE = 4
+    OUTSIDE_WINDOW = 5 # Below level or above upper level
+
+
+class TRIGGER_STATE(Enum):
+    DISARMED = 0
+    ARMED = 1
+    TRIGGERED = 2 # Post trigger samples are recorded
+    CAPTURED = 3 # Buffers are frozen with the whole window
 
 
 class BUFFER_TYPE(Enum):
@@ -53,8 +116,276 @@ class BUFFER_TYPE(Enum):
 device_connection_is_established = False
 cyccnt_overflow_ticks = (1 << 32) - 1
 
+# Set to DEBUG_UART_TX_FILL_BYTE value when device UART TX DMA runs in circular mode (DEBUG_UART_TX_CIRCULAR_MODE).
+# Device sends these bytes between message groups whenever it has nothing else to send
+device_tx_fill_byte = None
+
+# Must match device frame CRC (DEBUG_ITF_FRAME_CRC_DEFAULT_MODE), or be changed with set_frame_crc(). Every request gets a trailer
+# and every device frame is checked. Frames with wrong CRC are dropped and counted in frame_crc_errors_count
+frame_crc_mode = FRAME_CRC.NONE
+frame_crc_errors_count = 0
+received_frame_start = b"" # Parts of the device frame that is being read, read with is_frame_end=False
+
+# Set to True when device uses COBS framing (DEBUG_ITF_COBS_FRAMING). Every frame in both directions is then COBS encoded and
+# followed by 0x00, so a lost or corrupted byte only breaks its own frame. Broken frames are counted in cobs_frame_errors_count
+cobs_framing = False
+cobs_frame_errors_count = 0
+received_cobs_frame = b"" # Not yet read bytes of the last decoded device frame
+
 ################################################################################
 
+def read_device_message(serial_port: serial.Serial, length: int, is_frame_end: bool = True):
+    """Reads first message of a device reply or a stream message, skipping fill bytes sent before it in circular TX mode.
+    Fill bytes are only sent between message groups, so messages that follow in the same group are read with read_next_message()
+
+    If frame CRC is used, is_frame_end must be False when only the beginning of a device frame is read.
+    With COBS framing the message is always read from the beginning of the next frame.
+    """
+    global received_cobs_frame
+
+    if (cobs_framing):
+        received_cobs_frame = b"" # Rest of the previous frame is not needed, so reading always starts in sync
+        return check_frame_crc(serial_port, read_device_bytes(serial_port, length), length, is_frame_end)
+
+    if (device_tx_fill_byte is None):
+        return check_frame_crc(serial_port, serial_port.read(length), length, is_frame_end)
+
+    first_byte = serial_port.read(1)
+    while (len(first_byte) == 1 and first_byte[0] == device_tx_fill_byte):
+        first_byte = serial_port.read(1)
+
+    if (len(first_byte) == 0):
+        return first_byte
+    return check_frame_crc(serial_port, first_byte + serial_port.read(length - 1), length, is_frame_end)
+
+########################################
+
+def read_next_message(serial_port: serial.Serial, length: int, is_frame_end: bool = True):
+    """Reads a message that follows another one in the same device reply, or the rest of a frame"""
+    return check_frame_crc(serial_port, read_device_bytes(serial_port, length), length, is_frame_end)
+
+########################################
+
+def read_device_bytes(serial_port: serial.Serial, length: int):
+    """Reads raw bytes, or bytes of decoded frames with COBS framing. With COBS framing a single read never spans two frames"""
+    global received_cobs_frame
+
+    if (cobs_framing == False):
+        return serial_port.read(length)
+
+    if (length == 0):
+        return b""
+
+    if (len(received_cobs_frame) == 0):
+        received_cobs_frame = read_cobs_frame(serial_port)
+
+    data = received_cobs_frame[:length]
+    received_cobs_frame = received_cobs_frame[length:]
+    return data
+
+########################################
+
+def read_cobs_frame(serial_port: serial.Serial):
+    """Reads and decodes the next COBS frame. Empty frames (like 0x00 fill bytes) are skipped.
+
+    Returns empty bytes on timeout or if the frame is broken
+    """
+    global cobs_frame_errors_count
+
+    while (True):
+        encoded_frame = serial_port.read_until(b"\x00")
+        if (len(encoded_frame) == 0 or encoded_frame[-1] != 0):
+            return b""
+        if (len(encoded_frame) > 1):
+            break
+
+    frame = cobs_decode(encoded_frame[:-1])
+    if (frame is None):
+        cobs_frame_errors_count += 1
+        print(f"{bcolors.WARNING}Broken COBS frame!{bcolors.ENDC} Frame of {len(encoded_frame)} bytes is dropped")
+        return b""
+    return frame
+
+########################################
+
+def cobs_encode(data: bytes):
+    """COBS encodes data. Result contains no 0x00 bytes, delimiter is not added"""
+    encoded = bytearray([0])
+    code_index = 0
+    code = 1
+    for byte in data:
+        if (byte != 0):
+            encoded.append(byte)
+            code += 1
+            if (code != 0xFF):
+                continue
+
+        # Block ends with 0x00, or is full
+        encoded[code_index] = code
+        code_index = len(encoded)
+        encoded.append(0)
+        code = 1
+
+    encoded[code_index] = code
+    return bytes(encoded)
+
+########################################
+
+def cobs_decode(data: bytes):
+    """Decodes COBS encoded data without delimiter. Returns None if data is not valid COBS"""
+    decoded = bytearray()
+    index = 0
+    while (index < len(data)):
+        code = data[index]
+        index += 1
+        if (code == 0 or index + code - 1 > len(data)):
+            return None
+
+        decoded += data[index:index + code - 1]
+        index += code - 1
+        if (code != 0xFF and index < len(data)):
+            decoded.append(0)
+    return bytes(decoded)
+
+########################################
+
+def encode_frame(request: bytes):
+    """Adds CRC trailer and COBS framing to a request, if they are used"""
+    frame = bytes(request) + frame_crc_trailer(request)
+    if (cobs_framing):
+        return cobs_encode(frame) + b"\x00"
+    return frame
+
+########################################
+
+def frame_crc_trailer(frame: bytes):
+    """Returns CRC trailer of the frame in the current frame_crc_mode. Empty if frame CRC is not used"""
+    if (frame_crc_mode == FRAME_CRC.CRC16):
+        return struct.pack("<H", binascii.crc_hqx(bytes(frame), 0xFFFF))
+    if (frame_crc_mode == FRAME_CRC.CRC32):
+        return struct.pack("<I", zlib.crc32(bytes(frame)))
+    return b""
+
+########################################
+
+def check_frame_crc(serial_port: serial.Serial, message: bytes, length: int, is_frame_end: bool):
+    """Reads CRC trailer after the end of a device frame and checks it against all parts of the frame.
+
+    Returns the message, or empty bytes if CRC doesn't match. Messages shorter than length (timeout) are returned as is.
+    """
+    global received_frame_start
+    global frame_crc_errors_count
+
+    if (frame_crc_mode == FRAME_CRC.NONE):
+        return message
+
+    if (len(message) != length):
+        received_frame_start = b""
+        return message
+
+    if (is_frame_end == False):
+        received_frame_start += bytes(message)
+        return message
+
+    frame = received_frame_start + bytes(message)
+    received_frame_start = b""
+
+    expected_trailer = frame_crc_trailer(frame)
+    trailer = read_device_bytes(serial_port, len(expected_trailer))
+    if (trailer != expected_trailer):
+        frame_crc_errors_count += 1
+        print(f"{bcolors.WARNING}Frame CRC mismatch!{bcolors.ENDC} Frame of {len(frame)} bytes is dropped")
+        return b""
+    return message
+
+########################################
+
+def write_request(serial_port: serial.Serial, request: bytes):
+    """Sends a single request followed by its CRC trailer if frame CRC is used"""
+    serial_port.write(encode_frame(request))
+
+########################################
+
+def encode_request(code: int, payload: bytes = b""):
+    """Encodes a request. Payload is only allowed for codes with payload_flag set, and these codes always carry payload length
+
+    Device rejects payloads longer than DEBUG_ITF_MAX_RX_PAYLOAD_SIZE with NACK.
+    """
+    if ((code & payload_flag) == 0):
+        if (len(payload) != 0):
+            raise ValueError(f"Request code {code:#04x} can't carry payload")
+        return bytearray(message_prefix + [code])
+
+    if (len(payload) > 0xFFFF):
+        raise ValueError(f"Payload of {len(payload)} bytes is too long")
+    return bytearray(message_prefix + [code]) + struct.pack("<H", len(payload)) + bytes(payload)
+
+########################################
+
+def encode_tagged_request(tag: int, request: bytes):
+    """Wraps an encoded request (prefix, code and, for codes with payload_flag, length and payload) into a tagged request"""
+    return encode_request(tagged_request_code, bytes([tag & 0xFF]) + bytes(request[2:]))
+
+########################################
+
+def read_tagged_reply(serial_port: serial.Serial):
+    """Reads the next reply to a tagged request. Replies to different tagged requests can come in any order.
+
+    Returns (tag, reply) tuple, or (None, b"") if the reply is wrong
+    """
+    header = read_device_message(serial_port, 6, is_frame_end=False)
+    if (len(header) != 6 or header[0] != message_prefix[0] or header[1] != message_prefix[1] or header[2] != tagged_request_code):
+        print(f"{bcolors.FAIL}Wrong reply to tagged request!{bcolors.ENDC}. Wrong header")
+        return None, b""
+
+    reply_length = struct.unpack("<H", header[3:5])[0] - 1
+    reply = read_next_message(serial_port, reply_length)
+    if (len(reply) != reply_length):
+        print(f"{bcolors.FAIL}Wrong reply to tagged request!{bcolors.ENDC}. Expected {reply_length} bytes, received {len(reply)}")
+        return None, b""
+
+    return header[5], reply
+
+########################################
+
+def read_payload_reply(serial_port: serial.Serial, code: int):
+    """Reads a reply with payload: prefix, code with payload_flag, u16 little endian length and payload.
+
+    Returns payload bytes, or None if the reply is wrong
+    """
+    header = read_device_bytes(serial_port, 5)
+    if (len(header) != 5):
+        print(f"{bcolors.FAIL}Wrong reply with payload!{bcolors.ENDC}. Wrong header length")
+        return None
+
+    if (header[0] != message_prefix[0] or header[1] != message_prefix[1] or header[2] != (code | payload_flag)):
+        print(f"{bcolors.FAIL}Wrong reply with payload!{bcolors.ENDC}. Wrong header content")
+        return None
+
+    payload_length = struct.unpack("<H", header[3:5])[0]
+    payload = read_device_bytes(serial_port, payload_length)
+    if (len(payload) != payload_length):
+        print(f"{bcolors.FAIL}Wrong reply with payload!{bcolors.ENDC}. Expected {payload_length} bytes, received {len(payload)}")
+        return None
+
+    # Header and payload are a single frame, so CRC trailer follows the payload
+    if (len(check_frame_crc(serial_port, header + payload, 5 + payload_length, True)) == 0):
+        return None
+
+    return payload
+
+########################################
+
+def send_requests(serial_port: serial.Serial, requests: list):
+    """Sends several requests with a single write, so that they don't wait for a round trip each.
+
+    Device parses the RX byte stream frame by frame, so requests can be sent back to back. Replies are sent in the same order
+    as requests, and must be read in that order.
+    """
+    serial_port.write(b"".join(encode_frame(request) for request in requests))
+
+########################################
+
 def establish_connection(serial_port: serial.Serial):
     """Used to communicate to target MCU that PC client wants to establish connection
     
@@ -67,8 +398,8 @@ def establish_connection(serial_port: serial.Serial):
     """
     global device_connection_is_established
 
-    serial_port.write(message_establish_connection)
-    device_reply = serial_port.read(3)
+    write_request(serial_port, message_establish_connection)
+    device_reply = read_device_message(serial_port, 3)
 
     if(len(device_reply) != 3):
         device_connection_is_established = False
@@ -95,17 +426,100 @@ def close_connection(serial_port: serial.Serial):
     if(device_connection_is_established == False):
         return
 
-    serial_port.write(message_close_connection)
-    device_reply = serial_port.read(3)
+    write_request(serial_port, message_close_connection)
+    device_reply = read_device_message(serial_port, 3)
     # we don't need to handle return, even if it is incorrect, we can't do much about it
 
     device_connection_is_established = False
 
 ########################################
 
-def save_all_buffers(serial_port: serial.Serial):
+def buffer_record_format(record_type: int):
+    """Returns (record size, struct unpack type) of the buffer record type"""
+    record_size = 1
+    unpack_type = ""
+    match record_type:
+        case BUFFER_TYPE.F32_BUFFER.value:
+            record_size = 4
+            unpack_type = "f"
+        case BUFFER_TYPE.U32_BUFFER.value:
+            record_size = 4
+            unpack_type = "I"
+        case BUFFER_TYPE.I32_BUFFER.value:
+            record_size = 4
+            unpack_type = "i"
+        case BUFFER_TYPE.U16_BUFFER.value:
+            record_size = 2
+            unpack_type = "H"
+        case BUFFER_TYPE.I16_BUFFER.value:
+            record_size = 2
+            unpack_type = "h"
+        case BUFFER_TYPE.U8_BUFFER.value:
+            record_size = 1
+            unpack_type = "B"
+
+    return record_size, unpack_type
+
+########################################
+
+def read_buffers_pipelined(serial_port: serial.Serial, buffers_count: int, buffers_length: int, max_requests_in_flight: int):
+    """Reads buffers with tagged requests, keeping up to max_requests_in_flight of them sent before their replies arrive.
+
+    Dump takes roughly one round trip plus transfer time instead of a round trip per buffer. Every request takes 2 control lane
+    messages for ACK and description and 1 bulk lane message for data (one more per message with frame CRC in pointer mode),
+    so device TX lanes must be able to hold replies of all requests in flight.
+
+    Returns a list of record lists, one per buffer, or None if any reply is wrong
+    """
+    logging_data = [None] * buffers_count
+    replies = {} # tag -> replies received so far. Buffer index is used as tag
+    next_buffer = 0
+    read_buffers_count = 0
+
+    while (read_buffers_count < buffers_count):
+        requests = []
+        while (next_buffer < buffers_count and len(replies) < max_requests_in_flight):
+            replies[next_buffer] = []
+            requests.append(encode_tagged_request(next_buffer, bytearray(message_prefix + [0x10 + (next_buffer + 1)])))
+            next_buffer += 1
+        if (len(requests) != 0):
+            send_requests(serial_port, requests)
+
+        tag, device_reply = read_tagged_reply(serial_port)
+        if (tag is None or tag not in replies):
+            print(f"{bcolors.FAIL}Wrong response to buffer read request!{bcolors.ENDC}. Unexpected tag")
+            return None
+
+        buffer_replies = replies[tag]
+        buffer_replies.append(device_reply)
+        if (len(buffer_replies) == 1 and device_reply != message_ack):
+            print(f"{bcolors.FAIL}Target declined read request for buffer {tag}!{bcolors.ENDC}")
+            return None
+
+        if (len(buffer_replies) == 2 and (len(device_reply) != 4 or device_reply[0] != message_prefix[0] or
+                                          device_reply[1] != message_prefix[1] or device_reply[2] != 0x10 + (tag + 1))):
+            print(f"{bcolors.FAIL}Wrong response to buffer read request!{bcolors.ENDC}. Wrong answer content")
+            return None
+
+        if (len(buffer_replies) == 3):
+            record_size, unpack_type = buffer_record_format(buffer_replies[1][3])
+            if (len(device_reply) != record_size * buffers_length):
+                print(f"{bcolors.FAIL}Wrong byte count read for buffer {tag}!{bcolors.ENDC}")
+                return None
+
+            logging_data[tag] = [value[0] for value in struct.iter_unpack(unpack_type, device_reply)]
+            del replies[tag]
+            read_buffers_count += 1
+
+    return logging_data
+
+########################################
+
+def save_all_buffers(serial_port: serial.Serial, max_requests_in_flight: int = 1):
     """Saves all registered debug files from device into a .csv file inside logs/ folder. Doesn't save anything if no buffers are registered inside the MCU
 
+    With max_requests_in_flight above 1 buffers are read with pipelined tagged requests, see read_buffers_pipelined()
+
     @NOTE logs/ folder must exist inside the folder with this .py file
     """
     global device_connection_is_established
@@ -116,8 +530,8 @@ def save_all_buffers(serial_port: serial.Serial):
         print(f"{bcolors.FAIL}Device connection is not established for save_all_buffers!{bcolors.ENDC}")
         return device_connection_is_established
 
-    serial_port.write(message_read_buffers_properties)
-    device_reply = serial_port.read(6)
+    write_request(serial_port, message_read_buffers_properties)
+    device_reply = read_device_message(serial_port, 6)
 
     if(len(device_reply) != 6):
         print(f"{bcolors.FAIL}Wrong response to read buffers properties request!{bcolors.ENDC}. Wrong answer length")
@@ -140,70 +554,56 @@ def save_all_buffers(serial_port: serial.Serial):
         print(f"{bcolors.OKBLUE}No active buffers are registered. Logging aborted{bcolors.ENDC}")
         return device_connection_is_established
 
-    logging_data = []
-    for i in range(number_of_registered_buffers):
-        message_read_debug_buffer[2] = 0x10 + (i + 1)
-        serial_port.write(message_read_debug_buffer)
-        device_reply = serial_port.read(3)
-        if(len(device_reply) != 3):
-            print(f"{bcolors.FAIL}Wrong response to buffer read request!{bcolors.ENDC}. Wrong answer length")
+    if (max_requests_in_flight > 1):
+        logging_data = read_buffers_pipelined(serial_port, number_of_registered_buffers, buffers_length, max_requests_in_flight)
+        if (logging_data is None):
             device_connection_is_established = False
             return device_connection_is_established
+    else:
+        logging_data = []
+        for i in range(number_of_registered_buffers):
+            message_read_debug_buffer[2] = 0x10 + (i + 1)
+            write_request(serial_port, message_read_debug_buffer)
+            device_reply = read_device_message(serial_port, 3)
+            if(len(device_reply) != 3):
+                print(f"{bcolors.FAIL}Wrong response to buffer read request!{bcolors.ENDC}. Wrong answer length")
+                device_connection_is_established = False
+                return device_connection_is_established
 
-        if(device_reply != message_ack):
-            print(f"{bcolors.FAIL}Target declined read request for buffer {i}!{bcolors.ENDC}")
-            device_connection_is_established = False
-            return device_connection_is_established
+            if(device_reply != message_ack):
+                print(f"{bcolors.FAIL}Target declined read request for buffer {i}!{bcolors.ENDC}")
+                device_connection_is_established = False
+                return device_connection_is_established
 
-        device_reply = serial_port.read(4)
-        if(len(device_reply) != 4):
-            print(f"{bcolors.FAIL}Wrong response to buffer read request!{bcolors.ENDC}. Wrong answer length for second message")
-            device_connection_is_established = False
-            return device_connection_is_established
+            device_reply = read_next_message(serial_port, 4)
+            if(len(device_reply) != 4):
+                print(f"{bcolors.FAIL}Wrong response to buffer read request!{bcolors.ENDC}. Wrong answer length for second message")
+                device_connection_is_established = False
+                return device_connection_is_established
 
-        if(device_reply[0] != message_prefix[0] or device_reply[1] != message_prefix[1] or device_reply[2] != message_read_debug_buffer[2]):
-            print(f"{bcolors.FAIL}Wrong response to buffer read request!{bcolors.ENDC}. Wrong answer content")
-            device_connection_is_established = False
-            return device_connection_is_established
+            if(device_reply[0] != message_prefix[0] or device_reply[1] != message_prefix[1] or device_reply[2] != message_read_debug_buffer[2]):
+                print(f"{bcolors.FAIL}Wrong response to buffer read request!{bcolors.ENDC}. Wrong answer content")
+                device_connection_is_established = False
+                return device_connection_is_established
         
-        record_type = device_reply[3]
-        record_size = 1
-        unpack_type = ""
-        match record_type:
-            case BUFFER_TYPE.F32_BUFFER.value:
-                record_size = 4
-                unpack_type = "f"
-            case BUFFER_TYPE.U32_BUFFER.value:
-                record_size = 4
-                unpack_type = "I"
-            case BUFFER_TYPE.I32_BUFFER.value:
-                record_size = 4
-                unpack_type = "i"
-            case BUFFER_TYPE.U16_BUFFER.value:
-                record_size = 2
-                unpack_type = "H"
-            case BUFFER_TYPE.I16_BUFFER.value:
-                record_size = 2
-                unpack_type = "h"
-            case BUFFER_TYPE.U8_BUFFER.value:
-                record_size = 1
-                unpack_type = "B"
+            record_type = device_reply[3]
+            record_size, unpack_type = buffer_record_format(record_type)
 
-        print(f"Buffer {i + 1} data. Record type: {bcolors.OKBLUE}{record_type}{bcolors.ENDC}, ", end="")
-        print(f"size: {bcolors.OKBLUE}{record_size}{bcolors.ENDC}, unpack type: {bcolors.OKBLUE}{unpack_type}{bcolors.ENDC}")
+            print(f"Buffer {i + 1} data. Record type: {bcolors.OKBLUE}{record_type}{bcolors.ENDC}, ", end="")
+            print(f"size: {bcolors.OKBLUE}{record_size}{bcolors.ENDC}, unpack type: {bcolors.OKBLUE}{unpack_type}{bcolors.ENDC}")
 
-        actual_data = serial_port.read( record_size * buffers_length )
+            actual_data = read_next_message(serial_port, record_size * buffers_length)
 
-        if(len(actual_data) != record_size * buffers_length ):
-            print(f"{bcolors.FAIL}Wrong byte count read for buffer {i}!{bcolors.ENDC}")
-            print(len(actual_data))
-            device_connection_is_established = False
-            return device_connection_is_established
+            if(len(actual_data) != record_size * buffers_length ):
+                print(f"{bcolors.FAIL}Wrong byte count read for buffer {i}!{bcolors.ENDC}")
+                print(len(actual_data))
+                device_connection_is_established = False
+                return device_connection_is_established
 
-        logging_data.append([])
+            logging_data.append([])
 
-        for index in range(buffers_length):
-            logging_data[i].append(struct.unpack(unpack_type, actual_data[record_size*index:record_size*(index+1)])[0])
+            for index in range(buffers_length):
+                logging_data[i].append(struct.unpack(unpack_type, actual_data[record_size*index:record_size*(index+1)])[0])
 
     # Add data to csv file
     save_path = "logs/"
@@ -240,8 +640,8 @@ def save_streaming_data(serial_port: serial.Serial, duration_s: float):
         print(f"{bcolors.FAIL}Device connection is not established for save_streaming_data!{bcolors.ENDC}")
         return device_connection_is_established
 
-    serial_port.write(message_start_streaming)
-    device_reply = serial_port.read(3)
+    write_request(serial_port, message_start_streaming)
+    device_reply = read_device_message(serial_port, 3)
 
     if(len(device_reply) != 3):
         print(f"{bcolors.FAIL}Wrong response to start streaming request!{bcolors.ENDC}. Wrong answer length")
@@ -259,7 +659,7 @@ def save_streaming_data(serial_port: serial.Serial, duration_s: float):
         return device_connection_is_established
 
     # read message description
-    device_reply = serial_port.read(13)
+    device_reply = read_next_message(serial_port, 13)
     if(len(device_reply) != 13):
         print(f"{bcolors.FAIL}Wrong response to start streaming request!{bcolors.ENDC}. Wrong answer length for second message")
         device_connection_is_established = False
@@ -285,7 +685,7 @@ def save_streaming_data(serial_port: serial.Serial, duration_s: float):
     if(stream_field_types_read_count < 3):
         stream_field_types_read_count = 3
 
-    device_reply = serial_port.read(stream_field_types_read_count)
+    device_reply = read_next_message(serial_port, stream_field_types_read_count)
     if(len(device_reply) != stream_field_types_read_count):
         print(f"{bcolors.FAIL}Wrong response to start streaming request!{bcolors.ENDC}. Wrong fields description reply")
         device_connection_is_established = False
@@ -368,18 +768,22 @@ def save_streaming_data(serial_port: serial.Serial, duration_s: float):
             # TODO make sure that if data is started to be received as a single message, it will be
             # fully received as expected by the Windows API, and that situation when even though the
             # whole message was sent only part of it was received is possible
-            device_reply = serial_port.read(expected_message_len)
+            device_reply = read_device_message(serial_port, expected_message_len)
             if (len(device_reply) == 0):
                 continue
 
+            if(len(device_reply) != expected_message_len and cobs_framing):
+                # Frame was broken by a lost byte. Next frame is read in sync, so only this message is lost
+                continue
+
             if(len(device_reply) != expected_message_len):
                 print(len(device_reply))
                 print(device_reply)
                 print(f"{bcolors.FAIL}Wrong stream message length!{bcolors.ENDC}. Stopping the stream and aborting")
 
                 file.close()
-                serial_port.write(message_stop_streaming)
-                device_reply = serial_port.read(3)
+                write_request(serial_port, message_stop_streaming)
+                device_reply = read_device_message(serial_port, 3)
 
                 device_connection_is_established = False
                 return device_connection_is_established
@@ -388,8 +792,8 @@ def save_streaming_data(serial_port: serial.Serial, duration_s: float):
                 print(f"{bcolors.FAIL}Wrong prefix in stream message!{bcolors.ENDC}. Stopping the stream and aborting")
 
                 file.close()
-                serial_port.write(message_stop_streaming)
-                device_reply = serial_port.read(3)    
+                write_request(serial_port, message_stop_streaming)
+                device_reply = read_device_message(serial_port, 3)    
 
                 device_connection_is_established = False
                 return device_connection_is_established
@@ -423,9 +827,13 @@ def save_streaming_data(serial_port: serial.Serial, duration_s: float):
             print(f"{bcolors.WARNING}Stream timeout has elapsed{bcolors.ENDC}. Closing the stream.")
     
         file.close()
-        serial_port.write(message_stop_streaming)
-        device_reply = serial_port.read(3)
+        write_request(serial_port, message_stop_streaming)
+        device_reply = read_device_message(serial_port, 3)
         print(f"Saved a total of {bcolors.OKBLUE}{number_of_saved_points}{bcolors.ENDC} points")
+        if (frame_crc_errors_count != 0):
+            print(f"{bcolors.WARNING}{frame_crc_errors_count}{bcolors.ENDC} frames with wrong CRC were dropped so far")
+        if (cobs_frame_errors_count != 0):
+            print(f"{bcolors.WARNING}{cobs_frame_errors_count}{bcolors.ENDC} broken COBS frames were dropped so far")
         return
 
     except:
@@ -433,13 +841,215 @@ def save_streaming_data(serial_port: serial.Serial, duration_s: float):
         time.sleep(0.01) #sleep in case PC was sending a command during exception
         
         file.close()
-        serial_port.write(message_stop_streaming)
-        device_reply = serial_port.read(3)    
+        write_request(serial_port, message_stop_streaming)
+        device_reply = read_device_message(serial_port, 3)    
         print("Unsubscribed from device stream!")
 
 
 ########################################
 
+def read_link_telemetry(serial_port: serial.Serial):
+    """Reads raw TX link counters of the device.
+
+    All counters are free running u32 values, so only differences between two reads make sense (see monitor_link_utilization).
+    Returns dictionary with counters, or None if the request failed.
+    """
+    global device_connection_is_established
+
+    if (device_connection_is_established == False):
+        print(f"{bcolors.FAIL}Device connection is not established for read_link_telemetry!{bcolors.ENDC}")
+        return None
+
+    write_request(serial_port, message_read_link_telemetry)
+    device_reply = read_device_message(serial_port, 27)
+
+    if(len(device_reply) != 27):
+        print(f"{bcolors.FAIL}Wrong response to read link telemetry request!{bcolors.ENDC}. Wrong answer length")
+        device_connection_is_established = False
+        return None
+
+    if(device_reply[0] != message_prefix[0] or device_reply[1] != message_prefix[1] or device_reply[2] != message_read_link_telemetry[2]):
+        print(f"{bcolors.FAIL}Wrong response to read link telemetry request!{bcolors.ENDC}. Wrong answer content")
+        device_connection_is_established = False
+        return None
+
+    sent_bytes, sent_messages, high_water_mark, overflows, busy_cycles, current_cycle = struct.unpack("<IIIIII", device_reply[3:27])
+    return {
+        "sent_bytes": sent_bytes,
+        "sent_messages": sent_messages,
+        "high_water_mark": high_water_mark,
+        "overflows": overflows,
+        "busy_cycles": busy_cycles,
+        "current_cycle": current_cycle,
+    }
+
+########################################
+
+def monitor_link_utilization(serial_port: serial.Serial, baud_rate: int, period_s: float = 1.0, duration_s: float = 0):
+    """Polls link telemetry every period_s seconds and prints live TX link utilization until duration_s elapses (0 - forever).
+
+    Line utilization is calculated from sent bytes and baud_rate (10 bits per byte). Busy time shows how much of the time TX DMA
+    had something to send, it is only available if device transport provides a cycle counter.
+    Telemetry requests and replies are counted too, so idle link never shows exactly 0.
+    """
+    previous_telemetry = read_link_telemetry(serial_port)
+    if (previous_telemetry == None):
+        return
+    previous_time = time.time()
+    monitor_start_time = previous_time
+
+    try:
+        while(duration_s == 0 or (time.time() - monitor_start_time) < duration_s):
+            time.sleep(period_s)
+
+            telemetry = read_link_telemetry(serial_port)
+            if (telemetry == None):
+                return
+            current_time = time.time()
+            elapsed_s = current_time - previous_time
+
+            # Counters are u32 and wrap around
+            sent_bytes = (telemetry["sent_bytes"] - previous_telemetry["sent_bytes"]) & 0xFFFFFFFF
+            sent_messages = (telemetry["sent_messages"] - previous_telemetry["sent_messages"]) & 0xFFFFFFFF
+            overflows = (telemetry["overflows"] - previous_telemetry["overflows"]) & 0xFFFFFFFF
+            busy_cycles = (telemetry["busy_cycles"] - previous_telemetry["busy_cycles"]) & 0xFFFFFFFF
+            elapsed_cycles = (telemetry["current_cycle"] - previous_telemetry["current_cycle"]) & 0xFFFFFFFF
+
+            line_utilization = 100 * sent_bytes * 10 / (baud_rate * elapsed_s)
+            print(f"TX {bcolors.OKBLUE}{sent_bytes / elapsed_s:9.0f}{bcolors.ENDC} B/s, ", end="")
+            print(f"{bcolors.OKBLUE}{sent_messages / elapsed_s:7.0f}{bcolors.ENDC} msg/s, ", end="")
+            print(f"line {bcolors.OKBLUE}{line_utilization:5.1f}{bcolors.ENDC} %, ", end="")
+            if (elapsed_cycles != 0):
+                print(f"DMA busy {bcolors.OKBLUE}{100 * busy_cycles / elapsed_cycles:5.1f}{bcolors.ENDC} %, ", end="")
+            print(f"high water mark {bcolors.OKBLUE}{telemetry['high_water_mark']}{bcolors.ENDC}, ", end="")
+            if (overflows != 0):
+                print(f"overflows {bcolors.FAIL}+{overflows}{bcolors.ENDC}")
+            else:
+                print(f"overflows {bcolors.OKBLUE}+0{bcolors.ENDC}")
+
+            previous_telemetry = telemetry
+            previous_time = current_time
+    except KeyboardInterrupt:
+        print("Link monitoring is stopped")
+
+########################################
+
+def read_tx_queue_statistics(serial_port: serial.Serial):
+    """Reads and prints usage statistics of every device TX priority lane.
+
+    Lane 0 is the control lane (replies to requests), lane 1 is the bulk lane (buffers and stream data).
+    Returns list of dictionaries with statistics of every lane, or None if the request failed.
+    """
+    global device_connection_is_established
+
+    if (device_connection_is_established == False):
+        print(f"{bcolors.FAIL}Device connection is not established for read_tx_queue_statistics!{bcolors.ENDC}")
+        return None
+
+    write_request(serial_port, message_read_tx_queue_statistics)
+    device_reply = read_device_message(serial_port, 5, is_frame_end=False)
+
+    if(len(device_reply) != 5):
+        print(f"{bcolors.FAIL}Wrong response to read TX queue statistics request!{bcolors.ENDC}. Wrong answer length")
+        device_connection_is_established = False
+        return None
+
+    if(device_reply[0] != message_prefix[0] or device_reply[1] != message_prefix[1] or device_reply[2] != message_read_tx_queue_statistics[2]):
+        print(f"{bcolors.FAIL}Wrong response to read TX queue statistics request!{bcolors.ENDC}. Wrong answer content")
+        device_connection_is_established = False
+        return None
+
+    lanes_count = device_reply[3]
+    depth_units = "bytes" if device_reply[4] == 1 else "messages"
+
+    device_reply = read_next_message(serial_port, 16 * lanes_count)
+    if(len(device_reply) != 16 * lanes_count):
+        print(f"{bcolors.FAIL}Wrong response to read TX queue statistics request!{bcolors.ENDC}. Wrong lanes data length")
+        device_connection_is_established = False
+        return None
+
+    lane_names = ["control", "bulk"]
+    lanes_statistics = []
+    for lane_id in range(lanes_count):
+        depth, high_water_mark, queued_messages, overflows = struct.unpack("IIII", device_reply[16*lane_id:16*(lane_id+1)])
+        lanes_statistics.append({
+            "depth": depth,
+            "high_water_mark": high_water_mark,
+            "queued_messages": queued_messages,
+            "overflows": overflows,
+        })
+
+        lane_name = lane_names[lane_id] if lane_id < len(lane_names) else str(lane_id)
+        print(f"TX lane {bcolors.OKBLUE}{lane_name}{bcolors.ENDC}: depth {bcolors.OKBLUE}{depth}{bcolors.ENDC} {depth_units}, ", end="")
+        print(f"high water mark {bcolors.OKBLUE}{high_water_mark}{bcolors.ENDC} {depth_units}, ", end="")
+        print(f"queued messages {bcolors.OKBLUE}{queued_messages}{bcolors.ENDC}, ", end="")
+        if(overflows != 0):
+            print(f"overflows {bcolors.FAIL}{overflows}{bcolors.ENDC}")
+        else:
+            print(f"overflows {bcolors.OKBLUE}{overflows}{bcolors.ENDC}")
+
+    return lanes_statistics
+
+########################################
+
+def read_tx_drop_statistics(serial_port: serial.Serial):
+    """Reads and prints drop policy and per-policy drop counters of every device TX priority lane.
+
+    Growing counters mean that device produces data faster than the link can send it.
+    Returns list of dictionaries with statistics of every lane, or None if the request failed.
+    """
+    global device_connection_is_established
+
+    if (device_connection_is_established == False):
+        print(f"{bcolors.FAIL}Device connection is not established for read_tx_drop_statistics!{bcolors.ENDC}")
+        return None
+
+    write_request(serial_port, message_read_tx_drop_statistics)
+    device_reply = read_device_message(serial_port, 4, is_frame_end=False)
+
+    if(len(device_reply) != 4):
+        print(f"{bcolors.FAIL}Wrong response to read TX drop statistics request!{bcolors.ENDC}. Wrong answer length")
+        device_connection_is_established = False
+        return None
+
+    if(device_reply[0] != message_prefix[0] or device_reply[1] != message_prefix[1] or device_reply[2] != message_read_tx_drop_statistics[2]):
+        print(f"{bcolors.FAIL}Wrong response to read TX drop statistics request!{bcolors.ENDC}. Wrong answer content")
+        device_connection_is_established = False
+        return None
+
+    lanes_count = device_reply[3]
+
+    device_reply = read_next_message(serial_port, 17 * lanes_count)
+    if(len(device_reply) != 17 * lanes_count):
+        print(f"{bcolors.FAIL}Wrong response to read TX drop statistics request!{bcolors.ENDC}. Wrong lanes data length")
+        device_connection_is_established = False
+        return None
+
+    lane_names = ["control", "bulk"]
+    lanes_statistics = []
+    for lane_id in range(lanes_count):
+        policy, block_timeout_cycles, dropped_newest, dropped_oldest, block_timeouts = struct.unpack("<BIIII", device_reply[17*lane_id:17*(lane_id+1)])
+        lanes_statistics.append({
+            "policy": TX_DROP_POLICY(policy),
+            "block_timeout_cycles": block_timeout_cycles,
+            "dropped_newest": dropped_newest,
+            "dropped_oldest": dropped_oldest,
+            "block_timeouts": block_timeouts,
+        })
+
+        lane_name = lane_names[lane_id] if lane_id < len(lane_names) else str(lane_id)
+        print(f"TX lane {bcolors.OKBLUE}{lane_name}{bcolors.ENDC}: policy {bcolors.OKBLUE}{TX_DROP_POLICY(policy).name}{bcolors.ENDC}, ", end="")
+        if(policy == TX_DROP_POLICY.BLOCK.value):
+            print(f"block timeout {bcolors.OKBLUE}{block_timeout_cycles}{bcolors.ENDC} cycles, ", end="")
+        dropped_color = bcolors.FAIL if (dropped_newest + dropped_oldest + block_timeouts) != 0 else bcolors.OKBLUE
+        print(f"dropped newest {dropped_color}{dropped_newest}{bcolors.ENDC}, ", end="")
+        print(f"dropped oldest {dropped_color}{dropped_oldest}{bcolors.ENDC}, ", end="")
+        print(f"block timeouts {dropped_color}{block_timeouts}{bcolors.ENDC}")
+
+    return lanes_statistics
+
+########################################
+
 def send_generic_request(serial_port: serial.Serial, request_number: int):
     global device_connection_is_established
 
@@ -457,8 +1067,8 @@ def send_generic_request(serial_port: serial.Serial, request_number: int):
     global message_generic_request
     message_generic_request[2] = 0x40 + request_number - 1
 
-    serial_port.write(message_generic_request)
-    device_reply = serial_port.read(3)
+    write_request(serial_port, message_generic_request)
+    device_reply = read_device_message(serial_port, 3)
 
     if(len(device_reply) != 3):
         print(f"{bcolors.FAIL}Wrong answer length for the response send_generic_request!{bcolors.ENDC}")
@@ -480,6 +1090,414 @@ def send_generic_request(serial_port: serial.Serial, request_number: int):
 
 ########################################
 
+def send_generic_parameter_request(serial_port: serial.Serial, request_number: int, payload: bytes, reply_expected: bool = False):
+    """Sends generic request with payload (like addresses, sizes, rates or thresholds) to the device.
+
+    Request number is from 1 to 16. On the device it calls debug_itf_handle_generic_parameter_request_cbk() with selector
+    request_number - 1. If reply_expected is set, reply with payload is read after ACK and its payload is returned.
+    """
+    global device_connection_is_established
+
+    if(request_number == 0 or request_number > 16):
+        print(f"{bcolors.FAIL}Wrong request number: {request_number}{bcolors.ENDC}. Only numbers from 1 to 16 are allowed! Aborting request")
+        return None
+
+    if (device_connection_is_established == False):
+        print(f"{bcolors.FAIL}Device connection is not established for send_generic_parameter_request!{bcolors.ENDC}")
+        return None
+
+    request_code = generic_parameter_request_base_code + request_number - 1
+    write_request(serial_port, encode_request(request_code, payload))
+    device_reply = read_device_message(serial_port, 3)
+
+    if(len(device_reply) != 3):
+        print(f"{bcolors.FAIL}Wrong answer length for the response send_generic_parameter_request!{bcolors.ENDC}")
+        device_connection_is_established = False
+        return None
+
+    if(device_reply == message_nack):
+        print(f"{bcolors.FAIL}Target declined generic parameter request {request_number}!{bcolors.ENDC} Payload may be too long")
+        return None
+
+    if(device_reply != message_ack):
+        print(f"{bcolors.FAIL}Target sent unknown responce for send_generic_parameter_request!{bcolors.ENDC}")
+        device_connection_is_established = False
+        return None
+
+    if (reply_expected == False):
+        return b""
+
+    return read_payload_reply(serial_port, request_code)
+
+########################################
+
+def read_memory_reply(serial_port: serial.Serial, code: int, request_name: str):
+    """Reads a reply with memory content, or NACK if device declined the read. Like read_payload_reply(), reply code is code with
+    payload_flag. Returns memory content, or None
+    """
+    global device_connection_is_established
+
+    device_reply = read_device_message(serial_port, 3, is_frame_end=False)
+    if (device_reply == message_nack):
+        read_next_message(serial_port, 0) # NACK is the whole frame
+        print(f"{bcolors.FAIL}Target declined {request_name}!{bcolors.ENDC} Range may be outside of allowed regions")
+        return None
+
+    if (len(device_reply) != 3 or device_reply[0] != message_prefix[0] or device_reply[1] != message_prefix[1] or device_reply[2] != (code | payload_flag)):
+        print(f"{bcolors.FAIL}Wrong response to {request_name}!{bcolors.ENDC}")
+        device_connection_is_established = False
+        return None
+
+    reply_length = read_next_message(serial_port, 2, is_frame_end=False)
+    if (len(reply_length) != 2):
+        print(f"{bcolors.FAIL}Wrong response to {request_name}!{bcolors.ENDC}. Wrong answer length")
+        device_connection_is_established = False
+        return None
+
+    data = read_next_message(serial_port, struct.unpack("<H", reply_length)[0])
+    if (len(data) != struct.unpack("<H", reply_length)[0]):
+        print(f"{bcolors.FAIL}Wrong response to {request_name}!{bcolors.ENDC}. Reply is too short")
+        device_connection_is_established = False
+        return None
+
+    return data
+
+########################################
+
+def peek_memory(serial_port: serial.Serial, address: int, length: int):
+    """Reads length bytes of device memory starting from address. Device must have debug_memory_register_commands() called.
+
+    Range must be inside a single region allowed on the device. Regions of peripheral registers can require address and length
+    to be multiple of their access width. Returns bytes, or None if request is declined or reply is wrong
+    """
+    global device_connection_is_established
+
+    if (device_connection_is_established == False):
+        print(f"{bcolors.FAIL}Device connection is not established for peek_memory!{bcolors.ENDC}")
+        return None
+
+    write_request(serial_port, encode_request(peek_memory_code, struct.pack("<IH", address, length)))
+    data = read_memory_reply(serial_port, peek_memory_code, "peek_memory")
+    if (data is not None and len(data) != length):
+        print(f"{bcolors.FAIL}Wrong response to peek_memory!{bcolors.ENDC}. Expected {length} bytes, received {len(data)}")
+        device_connection_is_established = False
+        return None
+
+    return data
+
+########################################
+
+def scatter_read(serial_port: serial.Serial, ranges: list):
+    """Reads many (address, length) ranges of device memory with a single request. Returns a list with content of every range,
+    or None on failure. Device keeps the ranges, so the same state can be polled again with repeat_scatter_read()
+    """
+    global scatter_read_lengths
+    global device_connection_is_established
+
+    if (device_connection_is_established == False):
+        print(f"{bcolors.FAIL}Device connection is not established for scatter_read!{bcolors.ENDC}")
+        return None
+
+    payload = b"".join(struct.pack("<IH", address, length) for address, length in ranges)
+    write_request(serial_port, encode_request(scatter_read_code, payload))
+    data = read_memory_reply(serial_port, scatter_read_code, "scatter_read")
+    if (data is None):
+        return None
+
+    scatter_read_lengths = [length for _, length in ranges]
+    return split_scatter_read(data)
+
+########################################
+
+def repeat_scatter_read(serial_port: serial.Serial):
+    """Reads the ranges of the last scatter_read() again with a 3 byte request. Returns a list with content of every range, or None"""
+    global device_connection_is_established
+
+    if (device_connection_is_established == False):
+        print(f"{bcolors.FAIL}Device connection is not established for repeat_scatter_read!{bcolors.ENDC}")
+        return None
+
+    write_request(serial_port, message_repeat_scatter_read)
+    data = read_memory_reply(serial_port, repeat_scatter_read_reply_code, "repeat_scatter_read")
+    if (data is None):
+        return None
+    return split_scatter_read(data)
+
+########################################
+
+def snapshot(serial_port: serial.Serial, ranges: list = None, at_sync_point: bool = False):
+    """Reads (address, length) ranges of device memory, all copied inside a single critical section, so values come from the
+    same moment. Without ranges the last scatter_read() or snapshot() ranges are used. With at_sync_point device copies them at
+    its next debug_memory_snapshot_sync_point() call, so that function must be called more often than serial timeout.
+
+    Returns (capture cycles, max capture cycles, list with content of every range), or None on failure
+    """
+    global scatter_read_lengths
+    global device_connection_is_established
+
+    if (device_connection_is_established == False):
+        print(f"{bcolors.FAIL}Device connection is not established for snapshot!{bcolors.ENDC}")
+        return None
+
+    payload = struct.pack("<B", 1 if at_sync_point else 0)
+    if (ranges is not None):
+        payload += b"".join(struct.pack("<IH", address, length) for address, length in ranges)
+    write_request(serial_port, encode_request(snapshot_code, payload))
+    data = read_memory_reply(serial_port, snapshot_code, "snapshot")
+    if (data is None):
+        return None
+    if (len(data) < 8):
+        print(f"{bcolors.FAIL}Wrong response to snapshot!{bcolors.ENDC}. Reply is too short")
+        device_connection_is_established = False
+        return None
+
+    if (ranges is not None):
+        scatter_read_lengths = [length for _, length in ranges]
+    capture_cycles, max_capture_cycles = struct.unpack("<II", data[:8])
+    values = split_scatter_read(data[8:])
+    if (values is None):
+        return None
+    return capture_cycles, max_capture_cycles, values
+
+########################################
+
+def split_scatter_read(data: bytes):
+    """Splits scatter read reply into ranges of the last scatter_read(). Returns None if reply length doesn't match"""
+    global device_connection_is_established
+
+    if (len(data) != sum(scatter_read_lengths)):
+        print(f"{bcolors.FAIL}Wrong response to scatter read!{bcolors.ENDC}. Expected {sum(scatter_read_lengths)} bytes, received {len(data)}")
+        device_connection_is_established = False
+        return None
+
+    ranges_data = []
+    offset = 0
+    for length in scatter_read_lengths:
+        ranges_data.append(data[offset:offset + length])
+        offset += length
+    return ranges_data
+
+########################################
+
+def poke_memory(serial_port: serial.Serial, address: int, data: bytes):
+    """Writes data into device memory starting from address. Same rules as for peek_memory() apply. Returns True if data was written"""
+    global device_connection_is_established
+
+    if (device_connection_is_established == False):
+        print(f"{bcolors.FAIL}Device connection is not established for poke_memory!{bcolors.ENDC}")
+        return False
+
+    write_request(serial_port, encode_request(poke_memory_code, struct.pack("<I", address) + bytes(data)))
+    device_reply = read_device_message(serial_port, 3)
+
+    if (device_reply == message_nack):
+        print(f"{bcolors.FAIL}Target declined poke of {len(data)} bytes at {address:#010x}!{bcolors.ENDC} Range may be outside of allowed regions")
+        return False
+
+    if (device_reply != message_ack):
+        print(f"{bcolors.FAIL}Wrong response to poke_memory!{bcolors.ENDC}")
+        device_connection_is_established = False
+        return False
+
+    return True
+
+########################################
+
+def peek_value(serial_port: serial.Serial, address: int, value_format: str = "<I"):
+    """Reads a single value of the struct format (like "<f" or "<h") from device memory. Returns None on failure"""
+    data = peek_memory(serial_port, address, struct.calcsize(value_format))
+    if (data is None):
+        return None
+    return struct.unpack(value_format, data)[0]
+
+########################################
+
+def poke_value(serial_port: serial.Serial, address: int, value, value_format: str = "<I"):
+    """Writes a single value of the struct format (like "<f" or "<h") into device memory. Returns True if value was written"""
+    return poke_memory(serial_port, address, struct.pack(value_format, value))
+
+########################################
+
+def set_watch_list(serial_port: serial.Serial, entries: list, entries_per_message: int = 1, sample_divider: int = 1):
+    """Uploads a watch list of (address, BUFFER_TYPE) entries. Device must have debug_watch_register_commands() called.
+
+    Device samples all entries on every sample_divider-th debug_watch_sample() call and sends entries_per_message samples per
+    stream message. Watch list becomes the active stream, so it is read with save_streaming_data(). Every entry must be inside
+    a readable debug_memory region. Empty list stops sampling. Returns True if device accepted the list
+    """
+    global device_connection_is_established
+
+    if (device_connection_is_established == False):
+        print(f"{bcolors.FAIL}Device connection is not established for set_watch_list!{bcolors.ENDC}")
+        return False
+
+    payload = struct.pack("<HH", sample_divider, entries_per_message)
+    for address, data_type in entries:
+        payload += struct.pack("<IB", address, data_type.value if isinstance(data_type, BUFFER_TYPE) else data_type)
+
+    write_request(serial_port, encode_request(set_watch_list_code, payload))
+    device_reply = read_device_message(serial_port, 3)
+
+    if (device_reply == message_nack):
+        print(f"{bcolors.FAIL}Target declined watch list!{bcolors.ENDC} Entries may be outside of allowed regions, or another stream is registered")
+        return False
+
+    if (device_reply != message_ack):
+        print(f"{bcolors.FAIL}Wrong response to set_watch_list!{bcolors.ENDC}")
+        device_connection_is_established = False
+        return False
+
+    return True
+
+########################################
+
+def watch_variables(serial_port: serial.Serial, elf_path: str, expressions: list, entries_per_message: int = 1, sample_divider: int = 1):
+    """Resolves variables like "name", "name.member" or "name[3]" from the firmware ELF file and uploads them as a watch list.
+
+    Requires pyelftools. Returns True if device accepted the list
+    """
+    from helper_scripts import elf_variables
+
+    variables = elf_variables.ElfVariables(elf_path)
+    entries = []
+    for expression in expressions:
+        try:
+            address, data_type, size = variables.resolve(expression)
+        except ValueError as error:
+            print(f"{bcolors.FAIL}Can't watch {expression}!{bcolors.ENDC} {error}")
+            return False
+        print(f"Watch {bcolors.OKBLUE}{expression}{bcolors.ENDC} at {address:#010x}, type: {BUFFER_TYPE(data_type).name}")
+        entries.append((address, data_type))
+
+    return set_watch_list(serial_port, entries, entries_per_message, sample_divider)
+
+########################################
+
+def set_frame_crc(serial_port: serial.Serial, mode: FRAME_CRC):
+    """Switches CRC trailers of all following frames in both directions. Device ACKs with the previous mode.
+
+    Must not be used while stream is active, as stream messages queued before the switch keep the previous trailer.
+    """
+    global frame_crc_mode
+    global device_connection_is_established
+
+    if (device_connection_is_established == False):
+        print(f"{bcolors.FAIL}Device connection is not established for set_frame_crc!{bcolors.ENDC}")
+        return False
+
+    write_request(serial_port, encode_request(set_frame_crc_code, bytes([mode.value])))
+    device_reply = read_device_message(serial_port, 3)
+
+    if(device_reply != message_ack):
+        print(f"{bcolors.FAIL}Target declined frame CRC {mode.name}!{bcolors.ENDC}")
+        return False
+
+    frame_crc_mode = mode
+    print(f"Frame CRC is set to {bcolors.OKBLUE}{mode.name}{bcolors.ENDC}")
+    return True
+
+########################################
+
+def freeze_buffers(serial_port: serial.Serial, freeze: bool = True):
+    """Freezes or unfreezes all registered debug buffers. Circular buffers keep overwriting the oldest values, so they should be
+    frozen before save_all_buffers() to read the last values before an event. Every single buffer is held by the target while it
+    is sent, so it is read in chronological order even when not frozen, but unfrozen buffers keep recording between the reads and
+    don't cover the same time window
+    """
+    global device_connection_is_established
+
+    if (device_connection_is_established == False):
+        print(f"{bcolors.FAIL}Device connection is not established for freeze_buffers!{bcolors.ENDC}")
+        return False
+
+    write_request(serial_port, encode_request(freeze_buffers_code, bytes([1 if freeze else 0])))
+    device_reply = read_device_message(serial_port, 3)
+
+    if(device_reply != message_ack):
+        print(f"{bcolors.FAIL}Target declined to {'freeze' if freeze else 'unfreeze'} buffers!{bcolors.ENDC}")
+        return False
+
+    return True
+
+########################################
+
+def pack_trigger_level(level, buffer_type: BUFFER_TYPE):
+    """Packs level as u32 bits of a value of the watched buffer type"""
+    if (buffer_type == BUFFER_TYPE.F32_BUFFER):
+        return struct.pack("<f", level)
+    if (buffer_type in (BUFFER_TYPE.I32_BUFFER, BUFFER_TYPE.I16_BUFFER)):
+        return struct.pack("<i", int(level))
+    return struct.pack("<I", int(level))
+
+########################################
+
+def trigger_arm(serial_port: serial.Serial, buffer_index: int, buffer_type: BUFFER_TYPE, condition: TRIGGER_CONDITION, level,
+                upper_level = 0, post_trigger_samples: int = 0, auto_rearm: bool = False):
+    """Arms the trigger on the registered buffer with buffer_index. All registered buffers are restarted as circular ones and
+    frozen when the window is captured: post_trigger_samples after the trigger sample and the rest before it.
+    trigger_disarm() gives every buffer back the mode it had before arming.
+
+    buffer_type must be the type of the watched buffer, so levels are compared as the same type on the device.
+    With auto_rearm device arms the trigger again on the first trigger_status() after all buffers were read
+    """
+    global device_connection_is_established
+
+    if (device_connection_is_established == False):
+        print(f"{bcolors.FAIL}Device connection is not established for trigger_arm!{bcolors.ENDC}")
+        return False
+
+    payload = struct.pack("<BBBH", buffer_index, condition.value, 1 if auto_rearm else 0, post_trigger_samples)
+    payload += pack_trigger_level(level, buffer_type) + pack_trigger_level(upper_level, buffer_type)
+    write_request(serial_port, encode_request(trigger_arm_code, payload))
+    device_reply = read_device_message(serial_port, 3)
+
+    if(device_reply != message_ack):
+        print(f"{bcolors.FAIL}Target declined trigger configuration!{bcolors.ENDC} Buffer index or post trigger samples may be wrong")
+        return False
+
+    return True
+
+########################################
+
+def trigger_disarm(serial_port: serial.Serial):
+    """Stops the trigger and restores the mode buffers had before arming. Values are kept, so a captured window can still be saved"""
+    global device_connection_is_established
+
+    if (device_connection_is_established == False):
+        print(f"{bcolors.FAIL}Device connection is not established for trigger_disarm!{bcolors.ENDC}")
+        return False
+
+    write_request(serial_port, message_trigger_disarm)
+    device_reply = read_device_message(serial_port, 3)
+    return device_reply == message_ack
+
+########################################
+
+def trigger_status(serial_port: serial.Serial):
+    """Returns (TRIGGER_STATE, post trigger samples, captures count), or None if the request failed.
+
+    When state is CAPTURED, save_all_buffers() saves the window. Trigger sample is buffers size - 1 - post trigger samples
+    """
+    global device_connection_is_established
+
+    if (device_connection_is_established == False):
+        print(f"{bcolors.FAIL}Device connection is not established for trigger_status!{bcolors.ENDC}")
+        return None
+
+    write_request(serial_port, message_trigger_status)
+    device_reply = read_device_message(serial_port, 10)
+
+    if(len(device_reply) != 10 or device_reply[0] != message_prefix[0] or device_reply[1] != message_prefix[1] or
+       device_reply[2] != message_trigger_status[2]):
+        print(f"{bcolors.FAIL}Wrong response to trigger status request!{bcolors.ENDC}")
+        device_connection_is_established = False
+        return None
+
+    state, post_trigger_samples, captures_count = struct.unpack("<BHI", device_reply[3:10])
+    return TRIGGER_STATE(state), post_trigger_samples, captures_count
+
+########################################
+
 def csv_to_json_trace_translate(
     csv_points_trace: io.TextIOWrapper,
     json_points_description: io.TextIOWrapper,
@@ -0,0 +1,57 @@
+// Description is in the end of the file
+#pragma once
+
+#ifndef DEBUG_CRC_H_
+#define DEBUG_CRC_H_
+
+#include <stdint.h>
+
+/**************************************************************************************************/
+/*                                                                                                */
+/*                                       Global definitions                                       */
+/*                                                                                                */
+/**************************************************************************************************/
+
+#define DEBUG_CRC16_INIT                        (0xFFFFU)
+#define DEBUG_CRC32_INIT                        (0xFFFFFFFFU)
+#define DEBUG_CRC32_FINAL_XOR                   (0xFFFFFFFFU)
+
+/**************************************************************************************************/
+/*                                                                                                */
+/*                                     Global types declarations                                  */
+/*                                                                                                */
+/**************************************************************************************************/
+
+// Functions that continue a CRC over more data. They get and return the same running value as debug_crc16_update() and
+//  debug_crc32_update(), so software and backend calls can be mixed. Any of them can be null pointer to use software version.
+typedef struct debug_crc_backend
+{
+    uint16_t (*crc16_update)( uint16_t crc, const uint8_t* data, uint32_t length );
+    uint32_t (*crc32_update)( uint32_t crc, const uint8_t* data, uint32_t length );
+} debug_crc_backend;
+
+/**************************************************************************************************/
+/*                                                                                                */
+/*                                  Global functions declarations                                 */
+/*                                                                                                */
+/**************************************************************************************************/
+
+void debug_crc_set_backend( const debug_crc_backend* backend );
+
+uint16_t debug_crc16_update( uint16_t crc, const uint8_t* data, uint32_t length );
+uint32_t debug_crc32_update( uint32_t crc, const uint8_t* data, uint32_t length );
+
+uint16_t debug_crc16_software_update( uint16_t crc, const uint8_t* data, uint32_t length );
+uint32_t debug_crc32_software_update( uint32_t crc, const uint8_t* data, uint32_t length );
+
+#endif /* DEBUG_CRC_H_ */
+
+/**
+ * CRCs used by the debug protocol frame trailers.
+ *
+ * CRC-16 is CRC-16/CCITT-FALSE: polynomial 0x1021, init 0xFFFF, no reflection, no final XOR. Same as binascii.crc_hqx(data, 0xFFFF).
+ * CRC-32 is IEEE 802.3 CRC: reflected polynomial 0xEDB88320, init and final XOR 0xFFFFFFFF. Same as zlib.crc32(data).
+ *
+ * Software versions need no hardware: CRC-16 uses a 512 byte table, CRC-32 uses slice-by-4 with 4 KiB of tables.
+ *  A backend (like the MCU CRC peripheral) can replace any of them with debug_crc_set_backend().
+ */
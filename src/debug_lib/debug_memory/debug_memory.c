@@ -0,0 +1,739 @@
+#include "../../debug_lib/debug_memory/debug_memory.h"
+#include "../../debug_lib/debug_port.h"
+
+/**************************************************************************************************/
+/*                                                                                                */
+/*                                     Static types declarations                                  */
+/*                                                                                                */
+/**************************************************************************************************/
+
+typedef struct debug_memory_region
+{
+    uintptr_t start;
+    uint32_t length;
+    uint8_t access; // DEBUG_MEMORY_ACCESS
+    uint8_t access_width; // DEBUG_MEMORY_ACCESS_WIDTH
+} debug_memory_region;
+
+/**************************************************************************************************/
+/*                                                                                                */
+/*                                  Static variables declarations                                 */
+/*                                                                                                */
+/**************************************************************************************************/
+
+static debug_memory_region memory_regions[DEBUG_MEMORY_MAX_REGIONS_COUNT];
+static volatile uint8_t memory_regions_count = 0; // Increased only after the new region is filled in
+
+#define DEBUG_MEMORY_MAX_READ_REPLY_LENGTH      ((DEBUG_MEMORY_MAX_PEEK_LENGTH > DEBUG_MEMORY_MAX_SCATTER_LENGTH) ? \
+                                                    DEBUG_MEMORY_MAX_PEEK_LENGTH : DEBUG_MEMORY_MAX_SCATTER_LENGTH)
+// Snapshot reply has capture cycles and max capture cycles before the memory content
+#define DEBUG_MEMORY_SNAPSHOT_HEADER_LENGTH     (8U)
+
+// Prefix, request code (it has payload flag), u16 - length, memory content. Reply is busy from the moment it is taken until its
+//  release callback is called, so a queued reply is never overwritten by a pipelined request
+static uint8_t read_replies[DEBUG_MEMORY_PEEK_BUFFERS_COUNT][5U + DEBUG_MEMORY_MAX_READ_REPLY_LENGTH];
+static volatile uint8_t read_reply_is_busy[DEBUG_MEMORY_PEEK_BUFFERS_COUNT];
+
+// Sync point can send a snapshot at any moment, so it has its own reply and never reuses a queued peek or scatter read reply.
+//  Reply is busy from capture until its release callback is called, and no new snapshot is captured until then
+static uint8_t snapshot_reply[5U + DEBUG_MEMORY_SNAPSHOT_HEADER_LENGTH + DEBUG_MEMORY_MAX_SCATTER_LENGTH];
+static volatile uint8_t snapshot_reply_is_busy = 0;
+
+// Descriptors of the last valid scatter read request. Checked when they are set, so snapshot only copies them
+static struct
+{
+    uintptr_t address;
+    uint16_t length;
+    DEBUG_MEMORY_ACCESS_WIDTH access_width;
+} scatter_descriptors[DEBUG_MEMORY_MAX_SCATTER_DESCRIPTORS_COUNT];
+static uint8_t scatter_descriptors_count = 0;
+static uint16_t scatter_length = 0; // Sum of all descriptor lengths
+
+// Snapshot request that waits for debug_memory_snapshot_sync_point(). Payload isn't needed for the reply, so it isn't kept
+static debug_itf_request snapshot_request;
+static volatile uint8_t snapshot_armed = 0;
+static uint32_t snapshot_max_cycles = 0;
+
+static uint8_t message_ack[3] = { 0xAA, 0x55, 0xAA };
+static uint8_t message_nack[3] = { 0xAA, 0x55, 0x55 };
+
+/**************************************************************************************************/
+/*                                                                                                */
+/*                                 Static functions declarations                                  */
+/*                                                                                                */
+/**************************************************************************************************/
+
+static const debug_memory_region* debug_memory_find_region( uintptr_t address, uint32_t length, DEBUG_MEMORY_ACCESS access );
+static uint32_t debug_memory_access_width( uint8_t access_width, uintptr_t address, uint32_t length_left );
+static uint32_t debug_memory_load( uintptr_t address, uint32_t width );
+static void debug_memory_store( uintptr_t address, uint32_t width, uint32_t value );
+static uint8_t* debug_memory_take_read_reply( uint8_t code, uint16_t length );
+static void debug_memory_read_reply_released( uint8_t* message );
+static void debug_memory_send_read_reply( const debug_itf_request* request, uint8_t* read_reply, uint16_t length );
+static pif_error_code debug_memory_set_scatter_descriptors( const uint8_t* payload, uint16_t payload_length );
+static uint16_t debug_memory_capture_snapshot( void );
+static void debug_memory_snapshot_reply_released( uint8_t* message );
+
+static void debug_memory_peek_handler( const debug_itf_request* request, void* context, debug_itf_reply_cbk reply );
+static void debug_memory_poke_handler( const debug_itf_request* request, void* context, debug_itf_reply_cbk reply );
+static void debug_memory_scatter_read_handler( const debug_itf_request* request, void* context, debug_itf_reply_cbk reply );
+static void debug_memory_snapshot_handler( const debug_itf_request* request, void* context, debug_itf_reply_cbk reply );
+
+/**************************************************************************************************/
+/*                                                                                                */
+/*                                 Global functions implementations                               */
+/*                                                                                                */
+/**************************************************************************************************/
+
+/**
+ * @brief Allows peek and poke requests inside [start, start + length). Regions are meant to be added once during start up
+ *
+ * @param access_width DEBUG_MEMORY_ANY_WIDTH for plain memory, or width every register in the region must be accessed with
+ * @return 0 if region was added, error code otherwise
+ */
+pif_error_code debug_memory_add_region( uintptr_t start, uint32_t length, DEBUG_MEMORY_ACCESS access,
+        DEBUG_MEMORY_ACCESS_WIDTH access_width )
+{
+    if(memory_regions_count >= DEBUG_MEMORY_MAX_REGIONS_COUNT)
+    {
+        return LOG_ERROR(6001); // No space for a new memory region. Increase DEBUG_MEMORY_MAX_REGIONS_COUNT
+    }
+
+    if(length == 0 || (UINTPTR_MAX - start) < (length - 1U) || (access & DEBUG_MEMORY_READ_WRITE) == 0 ||
+            (access_width != DEBUG_MEMORY_ANY_WIDTH && access_width != DEBUG_MEMORY_8_BIT &&
+             access_width != DEBUG_MEMORY_16_BIT && access_width != DEBUG_MEMORY_32_BIT) ||
+            (access_width != DEBUG_MEMORY_ANY_WIDTH && (start % access_width != 0 || length % access_width != 0)))
+    {
+        return LOG_ERROR(6002); // Invalid memory region
+    }
+
+    debug_memory_region* region = &memory_regions[memory_regions_count];
+    region->start = start;
+    region->length = length;
+    region->access = (uint8_t)access;
+    region->access_width = (uint8_t)access_width;
+
+    memory_regions_count += 1;
+    return 0;
+}
+
+
+/**
+ * @brief Removes all regions together with kept scatter read descriptors, as they were checked against the removed regions
+ */
+void debug_memory_remove_all_regions( void )
+{
+    const debug_port_critical_state critical_state = debug_port_enter_critical();
+    memory_regions_count = 0;
+    scatter_descriptors_count = 0;
+    scatter_length = 0;
+    debug_port_exit_critical(critical_state);
+}
+
+/**
+ * @brief Copies memory into data. Range must be inside a single readable region
+ *
+ * @return 0 if memory was read, error code otherwise
+ */
+pif_error_code debug_memory_read( uintptr_t address, uint8_t* data, uint32_t length )
+{
+    DEBUG_MEMORY_ACCESS_WIDTH access_width = DEBUG_MEMORY_ANY_WIDTH;
+    const pif_error_code check_error = debug_memory_check_read(address, length, &access_width);
+    if(check_error != 0)
+    {
+        return check_error;
+    }
+
+    debug_memory_copy(address, data, length, access_width);
+    return 0;
+}
+
+/**
+ * @brief Checks that range can be read, so it can be copied later with debug_memory_copy() without searching regions again
+ *
+ * @param access_width Access width of the region that contains the range. Must be passed to debug_memory_copy()
+ * @return 0 if range is inside a single readable region and matches its access width, error code otherwise
+ */
+pif_error_code debug_memory_check_read( uintptr_t address, uint32_t length, DEBUG_MEMORY_ACCESS_WIDTH* access_width )
+{
+    const debug_memory_region* region = debug_memory_find_region(address, length, DEBUG_MEMORY_READ);
+    if(region == (void*)(0))
+    {
+        return LOG_ERROR(6003); // Memory range is outside of readable regions
+    }
+
+    uint32_t offset = 0;
+    while(offset < length)
+    {
+        const uint32_t width = debug_memory_access_width(region->access_width, address + offset, length - offset);
+        if(width == 0)
+        {
+            return LOG_ERROR(6004); // Memory range doesn't match access width of the region
+        }
+        offset += width;
+    }
+
+    *access_width = (DEBUG_MEMORY_ACCESS_WIDTH)region->access_width;
+    return 0;
+}
+
+/**
+ * @brief Copies a range that was checked with debug_memory_check_read(). Doesn't search regions or log errors, so it is short
+ *  enough to be used inside a critical section
+ */
+void debug_memory_copy( uintptr_t address, uint8_t* data, uint32_t length, DEBUG_MEMORY_ACCESS_WIDTH access_width )
+{
+    uint32_t offset = 0;
+    while(offset < length)
+    {
+        const uint32_t width = debug_memory_access_width((uint8_t)access_width, address + offset, length - offset);
+        const uint32_t value = debug_memory_load(address + offset, width);
+        for(uint32_t i = 0; i < width; i++)
+        {
+            data[offset + i] = (uint8_t)(value >> (8U * i));
+        }
+        offset += width;
+    }
+}
+
+/**
+ * @brief Copies data into memory. Range must be inside a single writable region
+ *
+ * @return 0 if memory was written, error code otherwise
+ */
+pif_error_code debug_memory_write( uintptr_t address, const uint8_t* data, uint32_t length )
+{
+    const debug_memory_region* region = debug_memory_find_region(address, length, DEBUG_MEMORY_WRITE);
+    if(region == (void*)(0))
+    {
+        return LOG_ERROR(6003); // Memory range is outside of writable regions
+    }
+
+    uint32_t offset = 0;
+    while(offset < length)
+    {
+        const uint32_t width = debug_memory_access_width(region->access_width, address + offset, length - offset);
+        if(width == 0)
+        {
+            return LOG_ERROR(6004); // Memory range doesn't match access width of the region
+        }
+
+        uint32_t value = 0;
+        for(uint32_t i = 0; i < width; i++)
+        {
+            value |= (uint32_t)data[offset + i] << (8U * i);
+        }
+        debug_memory_store(address + offset, width, value);
+        offset += width;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Adds peek, poke, scatter read and snapshot requests to the debug interface
+ *
+ * @return 0 if all requests were registered, error code otherwise
+ */
+pif_error_code debug_memory_register_commands( void )
+{
+    const uint8_t codes[5] =
+    {
+        DEBUG_ITF_PEEK_MEMORY_Code, DEBUG_ITF_POKE_MEMORY_Code, DEBUG_ITF_SCATTER_READ_Code, DEBUG_ITF_REPEAT_SCATTER_READ_Code,
+        DEBUG_ITF_SNAPSHOT_Code,
+    };
+    const debug_itf_command_handler handlers[5] =
+    {
+        debug_memory_peek_handler, debug_memory_poke_handler, debug_memory_scatter_read_handler, debug_memory_scatter_read_handler,
+        debug_memory_snapshot_handler,
+    };
+
+    for(uint8_t i = 0; i < 5; i++)
+    {
+        const uint16_t register_error = debug_itf_register_command(codes[i], handlers[i], (void*)(0), (void*)(0));
+        if(register_error != 0)
+        {
+            return register_error;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Sync point of DEBUG_MEMORY_SNAPSHOT_AT_SYNC_POINT snapshots. Call it where all watched values are consistent, like at
+ *  the end of the control loop. Does nothing unless a snapshot request waits for it
+ */
+void debug_memory_snapshot_sync_point( void )
+{
+    if(snapshot_armed == 0)
+    {
+        return;
+    }
+
+    const debug_port_critical_state critical_state = debug_port_enter_critical();
+    const uint8_t armed = snapshot_armed;
+    const debug_itf_request request = snapshot_request;
+    snapshot_armed = 0;
+    debug_port_exit_critical(critical_state);
+
+    if(armed == 0)
+    {
+        return; // Taken by a sync point call from another context
+    }
+
+    const uint16_t reply_length = debug_memory_capture_snapshot();
+    if(reply_length == 0)
+    {
+        debug_itf_queue_request_reply(&request, message_nack, sizeof(message_nack));
+        return;
+    }
+
+    if(debug_itf_queue_request_owned_reply(&request, snapshot_reply, reply_length, debug_memory_snapshot_reply_released) != 0)
+    {
+        debug_memory_snapshot_reply_released(snapshot_reply);
+    }
+}
+
+/**************************************************************************************************/
+/*                                                                                                */
+/*                                 Static functions implementations                               */
+/*                                                                                                */
+/**************************************************************************************************/
+
+/**
+ * @brief Finds region with the given access that contains the whole range
+ *
+ * @return Region, or null pointer if there is none
+ */
+static const debug_memory_region* debug_memory_find_region( uintptr_t address, uint32_t length, DEBUG_MEMORY_ACCESS access )
+{
+    if(length == 0)
+    {
+        return (void*)(0);
+    }
+
+    const uint8_t regions_count = memory_regions_count;
+    for(uint8_t i = 0; i < regions_count; i++)
+    {
+        const debug_memory_region* region = &memory_regions[i];
+        if((region->access & access) == access && address >= region->start && length <= region->length &&
+                (address - region->start) <= (region->length - length))
+        {
+            return region;
+        }
+    }
+
+    return (void*)(0);
+}
+
+/**
+ * @brief Width of the next access. Plain memory is accessed with the widest aligned access that fits into the rest of the range
+ *
+ * @return Access width in bytes, or 0 if address or length doesn't match fixed width of the region
+ */
+static uint32_t debug_memory_access_width( uint8_t access_width, uintptr_t address, uint32_t length_left )
+{
+    if(access_width != DEBUG_MEMORY_ANY_WIDTH)
+    {
+        const uint32_t width = access_width;
+        return (address % width == 0 && length_left >= width) ? width : 0;
+    }
+
+    if(address % 4U == 0 && length_left >= 4U)
+    {
+        return 4U;
+    }
+    if(address % 2U == 0 && length_left >= 2U)
+    {
+        return 2U;
+    }
+    return 1U;
+}
+
+
+/**
+ * @brief Takes a free read reply buffer and fills in its header. Buffer stays busy until debug_memory_send_read_reply() queues it
+ *  and it is sent, or until it is given back with debug_memory_read_reply_released()
+ *
+ * @return Reply buffer, memory content is written after 5 header bytes. Null pointer if all replies are still queued
+ */
+static uint8_t* debug_memory_take_read_reply( uint8_t code, uint16_t length )
+{
+    const debug_port_critical_state critical_state = debug_port_enter_critical();
+    uint8_t reply_index = 0;
+    while(reply_index < DEBUG_MEMORY_PEEK_BUFFERS_COUNT && read_reply_is_busy[reply_index] != 0)
+    {
+        reply_index += 1;
+    }
+    if(reply_index < DEBUG_MEMORY_PEEK_BUFFERS_COUNT)
+    {
+        read_reply_is_busy[reply_index] = 1;
+    }
+    debug_port_exit_critical(critical_state);
+
+    if(reply_index == DEBUG_MEMORY_PEEK_BUFFERS_COUNT)
+    {
+        LOG_ERROR(6012); // All read replies are queued. Increase DEBUG_MEMORY_PEEK_BUFFERS_COUNT or send fewer requests in flight
+        return (void*)(0);
+    }
+
+    uint8_t* read_reply = read_replies[reply_index];
+    read_reply[0] = 0xAA;
+    read_reply[1] = 0x55;
+    read_reply[2] = code;
+    read_reply[3] = (uint8_t)(length & 0xFFU);
+    read_reply[4] = (uint8_t)(length >> 8);
+    return read_reply;
+}
+
+
+/**
+ * @brief Release callback of read replies. Called by debug interface when reply was sent or dropped
+ */
+static void debug_memory_read_reply_released( uint8_t* message )
+{
+    read_reply_is_busy[(message - &read_replies[0][0]) / sizeof(read_replies[0])] = 0;
+}
+
+
+/**
+ * @brief Queues a filled in read reply with its release callback. Reply is given back at once if it couldn't be queued
+ */
+static void debug_memory_send_read_reply( const debug_itf_request* request, uint8_t* read_reply, uint16_t length )
+{
+    if(debug_itf_queue_request_owned_reply(request, read_reply, 5U + length, debug_memory_read_reply_released) != 0)
+    {
+        debug_memory_read_reply_released(read_reply);
+    }
+}
+
+
+/**
+ * @brief Replaces kept scatter read descriptors. All descriptors are checked first, so a wrong request doesn't break
+ *  repeated reads. Payload: u32 - address and u16 - length of every descriptor
+ *
+ * @return 0 if descriptors were replaced, error code otherwise
+ */
+static pif_error_code debug_memory_set_scatter_descriptors( const uint8_t* payload, uint16_t payload_length )
+{
+    if(payload_length == 0 || payload_length % 6U != 0 || payload_length / 6U > DEBUG_MEMORY_MAX_SCATTER_DESCRIPTORS_COUNT)
+    {
+        return LOG_ERROR(6007); // Invalid scatter read request length
+    }
+
+    const uint8_t descriptors_count = (uint8_t)(payload_length / 6U);
+    uint32_t total_length = 0;
+    DEBUG_MEMORY_ACCESS_WIDTH access_widths[DEBUG_MEMORY_MAX_SCATTER_DESCRIPTORS_COUNT];
+    for(uint8_t i = 0; i < descriptors_count; i++)
+    {
+        const uint8_t* descriptor = &payload[6U * i];
+        const uintptr_t address = (uintptr_t)((uint32_t)descriptor[0] | ((uint32_t)descriptor[1] << 8) |
+                ((uint32_t)descriptor[2] << 16) | ((uint32_t)descriptor[3] << 24));
+        const uint16_t length = (uint16_t)(descriptor[4] | (descriptor[5] << 8));
+
+        total_length += length;
+        if(total_length > DEBUG_MEMORY_MAX_SCATTER_LENGTH)
+        {
+            return LOG_ERROR(6008); // Scatter read is too long. Increase DEBUG_MEMORY_MAX_SCATTER_LENGTH or split the request
+        }
+
+        const pif_error_code check_error = debug_memory_check_read(address, length, &access_widths[i]);
+        if(check_error != 0)
+        {
+            return check_error;
+        }
+    }
+
+    // Snapshot sync point can capture descriptors from another context, so they are replaced all at once
+    const debug_port_critical_state critical_state = debug_port_enter_critical();
+    for(uint8_t i = 0; i < descriptors_count; i++)
+    {
+        const uint8_t* descriptor = &payload[6U * i];
+        scatter_descriptors[i].address = (uintptr_t)((uint32_t)descriptor[0] | ((uint32_t)descriptor[1] << 8) |
+                ((uint32_t)descriptor[2] << 16) | ((uint32_t)descriptor[3] << 24));
+        scatter_descriptors[i].length = (uint16_t)(descriptor[4] | (descriptor[5] << 8));
+        scatter_descriptors[i].access_width = access_widths[i];
+    }
+    scatter_descriptors_count = descriptors_count;
+    scatter_length = (uint16_t)total_length;
+    debug_port_exit_critical(critical_state);
+
+    return 0;
+}
+
+/**
+ * @brief Copies all kept ranges into the snapshot reply inside a single critical section and measures the copy with transport
+ *  cycle counter. Ranges were checked when descriptors were set, so nothing but the copy is done with interrupts disabled.
+ *  Reply is marked busy, so it must be queued with debug_memory_snapshot_reply_released() as release callback
+ *
+ * @return Length of the whole reply message, or 0 if the previous snapshot is still queued or descriptors were removed together
+ *  with the regions
+ */
+static uint16_t debug_memory_capture_snapshot( void )
+{
+    uint8_t* data = &snapshot_reply[5U + DEBUG_MEMORY_SNAPSHOT_HEADER_LENGTH];
+
+    // Descriptors are read inside the critical section, as they can be replaced until it starts
+    const debug_port_critical_state critical_state = debug_port_enter_critical();
+    const uint8_t is_busy = snapshot_reply_is_busy;
+    const uint8_t descriptors_count = (is_busy == 0) ? scatter_descriptors_count : 0;
+    const uint16_t payload_length = (uint16_t)(DEBUG_MEMORY_SNAPSHOT_HEADER_LENGTH + scatter_length);
+    if(descriptors_count != 0)
+    {
+        snapshot_reply_is_busy = 1;
+    }
+    const uint32_t start_cycles = debug_itf_get_cycle_count();
+    for(uint8_t i = 0; i < descriptors_count; i++)
+    {
+        debug_memory_copy(scatter_descriptors[i].address, data, scatter_descriptors[i].length, scatter_descriptors[i].access_width);
+        data += scatter_descriptors[i].length;
+    }
+    const uint32_t capture_cycles = debug_itf_get_cycle_count() - start_cycles;
+    debug_port_exit_critical(critical_state);
+
+    if(is_busy != 0)
+    {
+        LOG_ERROR(6013); // Previous snapshot reply is still queued. Wait for it before requesting a new snapshot
+        return 0;
+    }
+
+    if(descriptors_count == 0)
+    {
+        LOG_ERROR(6011); // Regions were removed after snapshot was requested
+        return 0;
+    }
+
+    if(capture_cycles > snapshot_max_cycles)
+    {
+        snapshot_max_cycles = capture_cycles;
+    }
+    snapshot_reply[0] = 0xAA;
+    snapshot_reply[1] = 0x55;
+    snapshot_reply[2] = DEBUG_ITF_SNAPSHOT_Code;
+    snapshot_reply[3] = (uint8_t)(payload_length & 0xFFU);
+    snapshot_reply[4] = (uint8_t)(payload_length >> 8);
+    for(uint8_t i = 0; i < 4U; i++)
+    {
+        snapshot_reply[5U + i] = (uint8_t)(capture_cycles >> (8U * i));
+        snapshot_reply[9U + i] = (uint8_t)(snapshot_max_cycles >> (8U * i));
+    }
+
+    return (uint16_t)(5U + payload_length);
+}
+
+
+/**
+ * @brief Release callback of the snapshot reply. Called by debug interface when reply was sent or dropped
+ */
+static void debug_memory_snapshot_reply_released( uint8_t* message )
+{
+    (void)message;
+    snapshot_reply_is_busy = 0;
+}
+
+
+static uint32_t debug_memory_load( uintptr_t address, uint32_t width )
+{
+    switch(width)
+    {
+        case 4U:
+            return *(volatile const uint32_t*)address;
+        case 2U:
+            return *(volatile const uint16_t*)address;
+        default:
+            return *(volatile const uint8_t*)address;
+    }
+}
+
+
+static void debug_memory_store( uintptr_t address, uint32_t width, uint32_t value )
+{
+    switch(width)
+    {
+        case 4U:
+            *(volatile uint32_t*)address = value;
+            break;
+        case 2U:
+            *(volatile uint16_t*)address = (uint16_t)value;
+            break;
+        default:
+            *(volatile uint8_t*)address = (uint8_t)value;
+            break;
+    }
+}
+
+/*                                    Command handlers                                            */
+/**************************************************************************************************/
+
+/**
+ * @brief Replies with memory content. Payload: u32 - address, u16 - length
+ */
+static void debug_memory_peek_handler( const debug_itf_request* request, void* context, debug_itf_reply_cbk reply )
+{
+    (void)context;
+
+    if(request->payload_length != 6)
+    {
+        LOG_ERROR(6005); // Invalid peek request length
+        reply(message_nack, sizeof(message_nack));
+        return;
+    }
+
+    const uintptr_t address = (uintptr_t)((uint32_t)request->payload[0] | ((uint32_t)request->payload[1] << 8) |
+            ((uint32_t)request->payload[2] << 16) | ((uint32_t)request->payload[3] << 24));
+    const uint16_t length = (uint16_t)(request->payload[4] | (request->payload[5] << 8));
+    if(length > DEBUG_MEMORY_MAX_PEEK_LENGTH)
+    {
+        LOG_ERROR(6006); // Peek is too long. Increase DEBUG_MEMORY_MAX_PEEK_LENGTH or split the request
+        reply(message_nack, sizeof(message_nack));
+        return;
+    }
+
+    uint8_t* peek_reply = debug_memory_take_read_reply(DEBUG_ITF_PEEK_MEMORY_Code, length);
+    if(peek_reply == (void*)(0))
+    {
+        reply(message_nack, sizeof(message_nack));
+        return;
+    }
+
+    if(debug_memory_read(address, &peek_reply[5], length) != 0)
+    {
+        debug_memory_read_reply_released(peek_reply);
+        reply(message_nack, sizeof(message_nack));
+        return;
+    }
+
+    debug_memory_send_read_reply(request, peek_reply, length);
+}
+
+/**
+ * @brief Writes request data into memory and replies with ACK. Payload: u32 - address, data
+ */
+static void debug_memory_poke_handler( const debug_itf_request* request, void* context, debug_itf_reply_cbk reply )
+{
+    (void)context;
+
+    if(request->payload_length < 5)
+    {
+        LOG_ERROR(6005); // Invalid poke request length
+        reply(message_nack, sizeof(message_nack));
+        return;
+    }
+
+    const uintptr_t address = (uintptr_t)((uint32_t)request->payload[0] | ((uint32_t)request->payload[1] << 8) |
+            ((uint32_t)request->payload[2] << 16) | ((uint32_t)request->payload[3] << 24));
+    if(debug_memory_write(address, &request->payload[4], request->payload_length - 4U) != 0)
+    {
+        reply(message_nack, sizeof(message_nack));
+        return;
+    }
+
+    reply(message_ack, sizeof(message_ack));
+}
+
+/**
+ * @brief Replies with content of all ranges one after another. DEBUG_ITF_SCATTER_READ_Code payload: u32 - address and u16 - length
+ *  of every range. Descriptors are kept, so DEBUG_ITF_REPEAT_SCATTER_READ_Code reads the same ranges without payload
+ */
+static void debug_memory_scatter_read_handler( const debug_itf_request* request, void* context, debug_itf_reply_cbk reply )
+{
+    (void)context;
+
+    if(request->code == DEBUG_ITF_SCATTER_READ_Code)
+    {
+        if(debug_memory_set_scatter_descriptors(request->payload, request->payload_length) != 0)
+        {
+            reply(message_nack, sizeof(message_nack));
+            return;
+        }
+    }
+    else if(scatter_descriptors_count == 0)
+    {
+        LOG_ERROR(6009); // Scatter read is repeated before any valid scatter read
+        reply(message_nack, sizeof(message_nack));
+        return;
+    }
+
+    // Repeated read has its own reply code, so it can be told apart from a new one. Both codes have payload flag
+    const uint8_t reply_code = (request->code == DEBUG_ITF_SCATTER_READ_Code) ?
+            DEBUG_ITF_SCATTER_READ_Code : DEBUG_ITF_REPEAT_SCATTER_READ_REPLY_Code;
+    uint8_t* scatter_reply = debug_memory_take_read_reply(reply_code, scatter_length);
+    if(scatter_reply == (void*)(0))
+    {
+        reply(message_nack, sizeof(message_nack));
+        return;
+    }
+
+    uint8_t* data = &scatter_reply[5];
+    for(uint8_t i = 0; i < scatter_descriptors_count; i++)
+    {
+        if(debug_memory_read(scatter_descriptors[i].address, data, scatter_descriptors[i].length) != 0)
+        {
+            debug_memory_read_reply_released(scatter_reply);
+            reply(message_nack, sizeof(message_nack));
+            return;
+        }
+        data += scatter_descriptors[i].length;
+    }
+
+    debug_memory_send_read_reply(request, scatter_reply, scatter_length);
+}
+
+/**
+ * @brief Replies with content of all kept scatter read ranges copied in a single critical section. Payload: u8 -
+ *  DEBUG_MEMORY_SNAPSHOT_MODE, then optional descriptors like in DEBUG_ITF_SCATTER_READ_Code. In sync point mode reply is sent
+ *  by the next debug_memory_snapshot_sync_point() call, and a new request replaces the waiting one
+ */
+static void debug_memory_snapshot_handler( const debug_itf_request* request, void* context, debug_itf_reply_cbk reply )
+{
+    (void)context;
+
+    if(request->payload_length < 1 || (request->payload[0] != DEBUG_MEMORY_SNAPSHOT_IMMEDIATE &&
+            request->payload[0] != DEBUG_MEMORY_SNAPSHOT_AT_SYNC_POINT))
+    {
+        LOG_ERROR(6010); // Invalid snapshot request
+        reply(message_nack, sizeof(message_nack));
+        return;
+    }
+
+    if(request->payload_length > 1)
+    {
+        if(debug_memory_set_scatter_descriptors(&request->payload[1], request->payload_length - 1U) != 0)
+        {
+            reply(message_nack, sizeof(message_nack));
+            return;
+        }
+    }
+    else if(scatter_descriptors_count == 0)
+    {
+        LOG_ERROR(6009); // Snapshot is requested before any valid scatter read descriptors were set
+        reply(message_nack, sizeof(message_nack));
+        return;
+    }
+
+    if(request->payload[0] == DEBUG_MEMORY_SNAPSHOT_AT_SYNC_POINT)
+    {
+        const debug_port_critical_state critical_state = debug_port_enter_critical();
+        snapshot_request.code = request->code;
+        snapshot_request.is_tagged = request->is_tagged;
+        snapshot_request.tag = request->tag;
+        snapshot_request.payload = (void*)(0);
+        snapshot_request.payload_length = 0;
+        snapshot_armed = 1;
+        debug_port_exit_critical(critical_state);
+        return;
+    }
+
+    const uint16_t reply_length = debug_memory_capture_snapshot();
+    if(reply_length == 0)
+    {
+        reply(message_nack, sizeof(message_nack));
+        return;
+    }
+
+    if(debug_itf_queue_request_owned_reply(request, snapshot_reply, reply_length, debug_memory_snapshot_reply_released) != 0)
+    {
+        debug_memory_snapshot_reply_released(snapshot_reply);
+    }
+}
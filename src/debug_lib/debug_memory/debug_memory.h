@@ -0,0 +1,141 @@
+// Description is in the end of the file
+#pragma once
+
+#ifndef DEBUG_MEMORY_H_
+#define DEBUG_MEMORY_H_
+
+#include <stdint.h>
+#include "../../debug_lib/debug_utils.h"
+
+// Include only if file is available. It can overwrite file configuration definitions
+#if defined __has_include
+    #if __has_include( <device_definitions.h> )
+        #include "device_definitions.h"
+    #endif
+#endif
+
+/**************************************************************************************************/
+/*                                                                                                */
+/*                                  Default file configurations                                   */
+/*                                                                                                */
+/**************************************************************************************************/
+
+#ifndef DEBUG_MEMORY_MAX_REGIONS_COUNT
+    #define DEBUG_MEMORY_MAX_REGIONS_COUNT          (8U)
+#endif
+
+// Max number of bytes read by a single peek request
+#ifndef DEBUG_MEMORY_MAX_PEEK_LENGTH
+    #define DEBUG_MEMORY_MAX_PEEK_LENGTH            (64U)
+#endif
+
+// Max number of ranges and total number of bytes read by a single scatter read request
+#ifndef DEBUG_MEMORY_MAX_SCATTER_DESCRIPTORS_COUNT
+    #define DEBUG_MEMORY_MAX_SCATTER_DESCRIPTORS_COUNT  (16U)
+#endif
+#ifndef DEBUG_MEMORY_MAX_SCATTER_LENGTH
+    #define DEBUG_MEMORY_MAX_SCATTER_LENGTH         (128U)
+#endif
+
+// Number of peek and scatter read replies that can be queued at once. A buffer is busy until its reply is sent, and read requests
+//  that come while all of them are busy are answered with NACK
+#ifndef DEBUG_MEMORY_PEEK_BUFFERS_COUNT
+    #define DEBUG_MEMORY_PEEK_BUFFERS_COUNT         (2U)
+#endif
+
+/**************************************************************************************************/
+/*                                                                                                */
+/*                                     Global types declarations                                  */
+/*                                                                                                */
+/**************************************************************************************************/
+
+typedef enum DEBUG_MEMORY_ACCESS
+{
+    DEBUG_MEMORY_READ = 1,
+    DEBUG_MEMORY_WRITE = 2,
+    DEBUG_MEMORY_READ_WRITE = 3,
+}DEBUG_MEMORY_ACCESS;
+
+// Width of every single access inside a region. Peripheral registers usually must be accessed with their own width
+typedef enum DEBUG_MEMORY_ACCESS_WIDTH
+{
+    DEBUG_MEMORY_ANY_WIDTH = 0, // Plain memory. Copied with the widest aligned accesses
+    DEBUG_MEMORY_8_BIT = 1,
+    DEBUG_MEMORY_16_BIT = 2,
+    DEBUG_MEMORY_32_BIT = 4, // Address and length of every access must be multiple of the width
+}DEBUG_MEMORY_ACCESS_WIDTH;
+
+// Mode byte of DEBUG_ITF_SNAPSHOT_Code request
+typedef enum DEBUG_MEMORY_SNAPSHOT_MODE
+{
+    DEBUG_MEMORY_SNAPSHOT_IMMEDIATE = 0, // Ranges are captured while request is handled
+    DEBUG_MEMORY_SNAPSHOT_AT_SYNC_POINT = 1, // Ranges are captured by the next debug_memory_snapshot_sync_point() call
+}DEBUG_MEMORY_SNAPSHOT_MODE;
+
+/**************************************************************************************************/
+/*                                                                                                */
+/*                                  Global functions declarations                                 */
+/*                                                                                                */
+/**************************************************************************************************/
+
+pif_error_code debug_memory_add_region( uintptr_t start, uint32_t length, DEBUG_MEMORY_ACCESS access,
+        DEBUG_MEMORY_ACCESS_WIDTH access_width );
+void debug_memory_remove_all_regions( void );
+
+pif_error_code debug_memory_read( uintptr_t address, uint8_t* data, uint32_t length );
+pif_error_code debug_memory_write( uintptr_t address, const uint8_t* data, uint32_t length );
+pif_error_code debug_memory_check_read( uintptr_t address, uint32_t length, DEBUG_MEMORY_ACCESS_WIDTH* access_width );
+void debug_memory_copy( uintptr_t address, uint8_t* data, uint32_t length, DEBUG_MEMORY_ACCESS_WIDTH access_width );
+
+pif_error_code debug_memory_register_commands( void );
+void debug_memory_snapshot_sync_point( void );
+
+/**************************************************************************************************/
+/*                                                                                                */
+/*                                      Static error handing                                      */
+/*                                                                                                */
+/**************************************************************************************************/
+
+#if DEBUG_MEMORY_MAX_PEEK_LENGTH < 1 || DEBUG_MEMORY_MAX_PEEK_LENGTH > (UINT16_MAX - 5U)
+    #error "DEBUG_MEMORY_MAX_PEEK_LENGTH must be > 0 and fit into u16 reply length. Change DEBUG_MEMORY_MAX_PEEK_LENGTH value accordingly"
+#endif
+
+#if DEBUG_MEMORY_MAX_SCATTER_DESCRIPTORS_COUNT < 1 || DEBUG_MEMORY_MAX_SCATTER_DESCRIPTORS_COUNT > 255
+    #error "DEBUG_MEMORY_MAX_SCATTER_DESCRIPTORS_COUNT must be > 0 and < 256. Change DEBUG_MEMORY_MAX_SCATTER_DESCRIPTORS_COUNT value accordingly"
+#endif
+
+#if DEBUG_MEMORY_MAX_SCATTER_LENGTH < 1 || DEBUG_MEMORY_MAX_SCATTER_LENGTH > (UINT16_MAX - 5U)
+    #error "DEBUG_MEMORY_MAX_SCATTER_LENGTH must be > 0 and fit into u16 reply length. Change DEBUG_MEMORY_MAX_SCATTER_LENGTH value accordingly"
+#endif
+
+#if DEBUG_MEMORY_PEEK_BUFFERS_COUNT < 1
+    #error "DEBUG_MEMORY_PEEK_BUFFERS_COUNT must be > 0. Change DEBUG_MEMORY_PEEK_BUFFERS_COUNT value accordingly"
+#endif
+
+#endif /* DEBUG_MEMORY_H_ */
+
+/**
+ * Live access to device memory over the debug protocol, so a variable or a register can be looked at or changed without
+ *  registering it as a debug buffer or stream and reflashing.
+ *
+ * Only regions added with debug_memory_add_region() can be accessed, and a request must fit into a single region. Without
+ *  regions every request is declined. Regions with fixed access width (peripheral registers) are accessed only with that width.
+ *  Ranges that are copied often, or with interrupts disabled, are checked once with debug_memory_check_read() and copied with
+ *  debug_memory_copy(). Regions must not be removed while such checked ranges are still in use.
+ *
+ * debug_memory_register_commands() adds DEBUG_ITF_PEEK_MEMORY_Code and DEBUG_ITF_POKE_MEMORY_Code requests to the debug
+ *  interface. DEBUG_ITF_SCATTER_READ_Code reads many ranges with a single request and reply, and keeps the descriptors, so the
+ *  same ranges can be polled again with a 3 byte DEBUG_ITF_REPEAT_SCATTER_READ_Code request. Values are copied byte by byte
+ *  as they are stored in memory, so they are little endian on Cortex-M.
+ *
+ * Ranges read by a scatter read can be copied at different moments, e.g. current before and voltage after a control loop
+ *  iteration. DEBUG_ITF_SNAPSHOT_Code copies all kept ranges inside a single critical section, so they always come from the
+ *  same iteration. With DEBUG_MEMORY_SNAPSHOT_AT_SYNC_POINT the copy is made by the next debug_memory_snapshot_sync_point()
+ *  call instead, so the application picks the moment, like the end of the control loop. Copy length is limited by
+ *  DEBUG_MEMORY_MAX_SCATTER_LENGTH, which bounds the time interrupts are disabled. Time is measured with transport cycle
+ *  counter (DWT on Cortex-M) and sent with the snapshot together with the longest capture so far. Ranges are checked when the
+ *  request is accepted, so only the copy is done with interrupts disabled. Snapshot reply has its own buffer, so it never
+ *  overwrites a queued peek or scatter read reply. A snapshot requested while the previous snapshot reply is still queued is
+ *  declined with NACK, so client should wait for a snapshot reply before requesting the next one. Removing regions also removes
+ *  kept descriptors, so a waiting snapshot is then declined too.
+ */
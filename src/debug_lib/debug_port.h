@@ -0,0 +1,119 @@
+// Description is in the end of the file
+#pragma once
+
+#ifndef DEBUG_PORT_H_
+#define DEBUG_PORT_H_
+
+#include <stdint.h>
+
+// Include only if file is available. It can overwrite file configuration definitions
+#if defined __has_include
+    #if __has_include( <device_definitions.h> )
+        #include "device_definitions.h"
+    #endif
+#endif
+
+/**************************************************************************************************/
+/*                                                                                                */
+/*                                  Default file configurations                                   */
+/*                                                                                                */
+/**************************************************************************************************/
+
+// If defined, critical sections raise BASEPRI to this value instead of masking all interrupts with PRIMASK.
+//  Value is written to BASEPRI register as is, so it must already be shifted by (8 - __NVIC_PRIO_BITS).
+//  Interrupts with higher priority than this value keep running, so they MUST NOT use the debug interface.
+//#define DEBUG_PORT_CRITICAL_BASEPRI             (0x10U)
+
+/**************************************************************************************************/
+/*                                                                                                */
+/*                                     Global types declarations                                  */
+/*                                                                                                */
+/**************************************************************************************************/
+
+// Interrupt mask state saved on critical section entry and restored on exit
+typedef uint32_t debug_port_critical_state;
+
+/**************************************************************************************************/
+/*                                                                                                */
+/*                             Static inline functions implementations                            */
+/*                                                                                                */
+/**************************************************************************************************/
+
+#if defined(__ARM_ARCH_PROFILE) && (__ARM_ARCH_PROFILE == 'M')
+
+/**
+ * @brief Masks all interrupts that can use the debug interface. Sections can be nested, as previous state is returned.
+ */
+static inline debug_port_critical_state debug_port_enter_critical( void )
+{
+    debug_port_critical_state previous_state;
+#ifdef DEBUG_PORT_CRITICAL_BASEPRI
+    const uint32_t new_basepri = DEBUG_PORT_CRITICAL_BASEPRI;
+    __asm volatile ("mrs %0, basepri" : "=r" (previous_state) :: "memory");
+    __asm volatile ("msr basepri_max, %0" :: "r" (new_basepri) : "memory");
+#else
+    __asm volatile ("mrs %0, primask" : "=r" (previous_state) :: "memory");
+    __asm volatile ("cpsid i" ::: "memory");
+#endif
+    return previous_state;
+}
+
+/**
+ * @brief Restores interrupt mask saved by the matching debug_port_enter_critical() call
+ */
+static inline void debug_port_exit_critical( debug_port_critical_state previous_state )
+{
+#ifdef DEBUG_PORT_CRITICAL_BASEPRI
+    __asm volatile ("msr basepri, %0" :: "r" (previous_state) : "memory");
+#else
+    __asm volatile ("msr primask, %0" :: "r" (previous_state) : "memory");
+#endif
+}
+
+#else /* Not a Cortex-M target. Used to build and test the library on a PC */
+
+extern volatile uint8_t debug_port_host_lock;
+
+/**
+ * @brief Host implementation based on a spin lock. Unlike Cortex-M version sections MUST NOT be nested.
+ */
+static inline debug_port_critical_state debug_port_enter_critical( void )
+{
+    while(__atomic_test_and_set(&debug_port_host_lock, __ATOMIC_ACQUIRE))
+    {
+        // wait until other thread leaves critical section
+    }
+    return 0;
+}
+
+static inline void debug_port_exit_critical( debug_port_critical_state previous_state )
+{
+    (void)previous_state;
+    __atomic_clear(&debug_port_host_lock, __ATOMIC_RELEASE);
+}
+
+#endif /* __ARM_ARCH_PROFILE == 'M' */
+
+/**************************************************************************************************/
+/*                                                                                                */
+/*                                      Static error handing                                      */
+/*                                                                                                */
+/**************************************************************************************************/
+
+#if defined(DEBUG_PORT_CRITICAL_BASEPRI) && defined(__ARM_ARCH_6M__)
+    #error "BASEPRI is not available on ARMv6-M cores. Remove DEBUG_PORT_CRITICAL_BASEPRI definition"
+#endif
+
+#endif /* DEBUG_PORT_H_ */
+
+/**
+ * Small portability layer that hides how the debug library protects data shared between main loop code and interrupts.
+ *
+ * Debug interface functions can be called from the main loop and from any interrupt at the same time. All shared state is
+ *  only changed inside short critical sections. Time consuming parts (like starting a transfer) are done outside of them.
+ *
+ * On Cortex-M sections can be nested. Host build (used by tests in tests/host, where threads play the role of interrupts) uses
+ *  a single spin lock instead, which is not nestable: a thread that enters a section again, or a signal handler that
+ *  interrupts the owner and enters one, spins forever. Library code therefore never calls a function that enters a critical
+ *  section while it is inside one.
+ */
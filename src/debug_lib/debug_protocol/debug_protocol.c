@@ -1,6 +1,10 @@
 #include "../../debug_lib/debug_protocol/debug_protocol.h"
 
 #include "../../debug_lib/debug_utils.h"
+#include "../../debug_lib/debug_port.h"
+#include "../../debug_lib/debug_crc/debug_crc.h"
+
+#include <string.h>
 
 // todo implement data streaming
 
@@ -10,6 +14,26 @@
 /*                                                                                                */
 /**************************************************************************************************/
 
+/**
+ * Message given to the queue functions
+ */
+typedef struct debug_tx_message
+{
+    uint8_t* message;
+    uint32_t length;
+    debug_itf_message_release_cbk release_cbk; // Can be null pointer if message memory is never reused
+} debug_tx_message;
+
+// Most messages queued as a single group, including frame CRC trailer: tag header, two data spans and the trailer
+#define DEBUG_TX_MAX_GROUP_MESSAGES_COUNT       (4U)
+
+// Small per lane buffers (frame CRC trailers, tag headers). A buffer is taken before its group is queued and given back by its
+//  release callback, when it was sent or dropped. One more than lane can store, as the in flight message isn't in the lane any
+//  longer. If all of them are taken, lane is full anyway
+#define DEBUG_TX_LANE_POOL_LENGTH               (((DEBUG_ITF_TX_QUEUE_LENGTH > DEBUG_ITF_TX_CONTROL_QUEUE_LENGTH) ? \
+                                                    DEBUG_ITF_TX_QUEUE_LENGTH : DEBUG_ITF_TX_CONTROL_QUEUE_LENGTH) + 1U)
+
+#ifndef DEBUG_ITF_TX_RING_MODE
 /**
  * Type that stores length of the COM message and pointer to it. So that we can store multiple messages at
  *  the same time for complex communication methods
@@ -17,23 +41,126 @@
 typedef struct debug_tx_request
 {
     uint32_t length;
-    uint8_t* message;
+    uint8_t* message; // Moved forward when message is sent in chunks
+    uint8_t* message_start; // Pointer that was queued. Given to release_cbk
+    debug_itf_message_release_cbk release_cbk;
+    uint8_t group_messages_left; // Messages of its group from this one to the end of the group, so 1 in the last one
+    uint8_t is_group_start; // First message of a group that was queued by a single call
 } debug_tx_request;
 
 /**
- * queue of message that need to be sent using debug interface
+ * Queue of messages of a single priority lane
  */
-static struct
+typedef struct debug_tx_lane
 {
-    debug_tx_request requests[DEBUG_ITF_TX_QUEUE_LENGTH];
+    debug_tx_request* requests;
+    uint16_t capacity;
     uint16_t write_index;
     uint16_t read_index;
     uint16_t active_queue_size;
-    uint8_t tx_is_busy;
-} tx_queue;
+    uint8_t head_is_partially_sent; // Head message is longer than one transfer and only some of its chunks were sent
+    uint8_t drop_policy; // DEBUG_ITF_TX_DROP_POLICY
+    uint32_t block_timeout_cycles;
+    debug_itf_tx_lane_statistics statistics;
+} debug_tx_lane;
+
+#else /* DEBUG_ITF_TX_RING_MODE */
+/**
+ * Copy-in TX ring of a single priority lane. Producers (code that queues messages) only move reserve_index and write_index and
+ *  consumer (TX DMA interrupt) only moves read_index, all inside critical sections. Indexes are free running and wrapped with
+ *  size - 1 on access, so reserve_index - read_index is always the number of used bytes.
+ *
+ * Producer reserves space inside a critical section, copies its messages into it with interrupts enabled and commits them
+ *  inside another one. Producers of higher priority can reserve and commit in the meantime, so bytes up to reserve_index are
+ *  published by moving write_index only when the last open reservation is committed. Consumer only sends bytes up to write_index.
+ *
+ * Ring doesn't store message boundaries, but write_index is always at the end of the last queued message. Its value is saved
+ *  into boundary_index when lane is selected for sending, and lane isn't switched until all bytes up to it were sent.
+ *  Otherwise a message from another lane could be sent in the middle of a message from this lane.
+ */
+typedef struct debug_tx_lane
+{
+    uint8_t* data;
+    uint32_t size; // Must be a power of two
+    uint32_t reserve_index; // End of space reserved by producers
+    uint32_t write_index; // End of published bytes, which can be sent
+    uint32_t read_index;
+    uint32_t committed_messages_count; // Messages committed since write_index was published the last time
+    uint8_t open_reservations_count; // Producers that reserved space and haven't committed it yet
+    uint32_t boundary_index;
+    uint32_t messages_before_boundary; // Number of messages queued before boundary_index
+    uint32_t sent_messages_count; // Number of messages sent before the previous boundary
+    uint8_t drop_policy; // DEBUG_ITF_TX_DROP_POLICY
+    uint32_t block_timeout_cycles;
+    debug_itf_tx_lane_statistics statistics;
+} debug_tx_lane;
+#endif /* DEBUG_ITF_TX_RING_MODE */
+
+#ifndef DEBUG_ITF_TX_RING_MODE
+static debug_tx_request tx_control_lane_requests[DEBUG_ITF_TX_CONTROL_QUEUE_LENGTH];
+static debug_tx_request tx_bulk_lane_requests[DEBUG_ITF_TX_QUEUE_LENGTH];
+
+// Short messages are copied here to be sent as a single transfer. Only written when no transfer is active
+static uint8_t tx_staging_buffer[DEBUG_ITF_TX_STAGING_SIZE];
+#else
+static uint8_t tx_control_lane_ring[DEBUG_ITF_TX_CONTROL_RING_SIZE];
+static uint8_t tx_bulk_lane_ring[DEBUG_ITF_TX_RING_SIZE];
+#endif /* DEBUG_ITF_TX_RING_MODE */
+
+/**
+ * All messages that need to be sent using debug interface. Lanes are served in order of DEBUG_ITF_TX_LANE values,
+ *  so control replies never wait behind bulk data that wasn't started yet.
+ */
+static struct
+{
+    debug_tx_lane lanes[DEBUG_ITF_TX_LANES_COUNT];
+#ifdef DEBUG_ITF_TX_RING_MODE
+    uint32_t in_flight_length; // Number of bytes that were given to transport and are not released yet
+#else
+    debug_tx_request in_flight_request; // Message sent from its own memory, released when transport is done with it
+#endif
+    uint8_t active_lane; // Lane of the last started transfer
+    volatile uint8_t tx_is_busy;
+    uint32_t sent_bytes_count; // Bytes handed over to transport
+    uint32_t busy_cycles_count; // Cycles of finished busy periods
+    uint32_t busy_start_cycle; // Start of the current busy period
+} tx_queue =
+{
+#ifndef DEBUG_ITF_TX_RING_MODE
+    .lanes[DEBUG_ITF_TX_LANE_CONTROL] = { .requests = tx_control_lane_requests, .capacity = DEBUG_ITF_TX_CONTROL_QUEUE_LENGTH },
+    .lanes[DEBUG_ITF_TX_LANE_BULK] = { .requests = tx_bulk_lane_requests, .capacity = DEBUG_ITF_TX_QUEUE_LENGTH },
+#else
+    .lanes[DEBUG_ITF_TX_LANE_CONTROL] = { .data = tx_control_lane_ring, .size = DEBUG_ITF_TX_CONTROL_RING_SIZE },
+    .lanes[DEBUG_ITF_TX_LANE_BULK] = { .data = tx_bulk_lane_ring, .size = DEBUG_ITF_TX_RING_SIZE },
+#endif
+};
+
+/**
+ * States of the RX frame parser. Parser keeps its state between debug_handle_rx() calls, so frames can be split between
+ *  several received chunks and a single chunk can contain several frames.
+ */
+typedef enum DEBUG_RX_PARSER_STATE
+{
+    DEBUG_RX_WAIT_PREFIX_FIRST_BYTE = 0,
+    DEBUG_RX_WAIT_PREFIX_SECOND_BYTE,
+    DEBUG_RX_WAIT_CODE,
+    DEBUG_RX_WAIT_LENGTH_LOW_BYTE,
+    DEBUG_RX_WAIT_LENGTH_HIGH_BYTE,
+    DEBUG_RX_WAIT_PAYLOAD,
+    DEBUG_RX_SKIP_PAYLOAD, // Payload of a too long request is skipped to stay in sync with the byte stream
+    DEBUG_RX_WAIT_FRAME_CRC,
+}DEBUG_RX_PARSER_STATE;
 
 extern const debug_transport* active_transport;
 
+// Entry of the command table. Reply callback is null for commands that reply through the control lane
+typedef struct debug_itf_command
+{
+    debug_itf_command_handler handler;
+    void* context;
+    debug_itf_reply_cbk reply_cbk;
+} debug_itf_command;
+
 /**************************************************************************************************/
 /*                                                                                                */
 /*                                  Static variables declarations                                 */
@@ -43,6 +170,53 @@ extern const debug_transport* active_transport;
 // todo Not sure that connection establishing functionality is needed
 static uint8_t debug_connection_is_established = 0;
 
+static struct
+{
+    uint8_t state; // DEBUG_RX_PARSER_STATE
+    uint8_t is_skipping_bytes; // Bytes outside of frames are being skipped. Used to log a single error per skipped sequence
+    uint16_t payload_length;
+    uint16_t received_payload_length;
+    uint32_t skipped_bytes_left; // Payload and CRC bytes of a too long request
+    uint16_t frame_length; // Length of the complete frame without CRC, while its CRC is received
+    uint8_t received_crc_length;
+    uint8_t frame[5 + DEBUG_ITF_MAX_RX_PAYLOAD_SIZE + 4]; // Prefix, request code and, for requests with payload, length and payload.
+                                                          //  Followed by CRC trailer, if frame CRC is used
+} rx_parser;
+
+#ifdef DEBUG_ITF_COBS_FRAMING
+// State of the COBS decoder that runs in front of the RX frame parser
+static struct
+{
+    uint8_t block_bytes_left; // Data bytes left in the current block. 0 means the next byte is a code byte
+    uint8_t zero_is_pending; // Current block ends with 0x00, unless it is the last block of the frame
+} rx_cobs_decoder;
+#endif /* DEBUG_ITF_COBS_FRAMING */
+
+// DEBUG_ITF_FRAME_CRC used in both directions. Changed only between frames
+static volatile uint8_t frame_crc_mode = DEBUG_ITF_FRAME_CRC_DEFAULT_MODE;
+static uint8_t tx_frame_crc_trailers[DEBUG_ITF_TX_LANES_COUNT][DEBUG_TX_LANE_POOL_LENGTH][4];
+static volatile uint8_t tx_frame_crc_trailer_is_used[DEBUG_ITF_TX_LANES_COUNT][DEBUG_TX_LANE_POOL_LENGTH];
+
+#ifdef DEBUG_ITF_RX_DEFERRED_MODE
+// Received frames waiting for debug_poll(). Only RX interrupt moves write_index and only debug_poll() moves read_index.
+//  Indexes are free running and wrapped on access
+static struct
+{
+    struct
+    {
+        uint16_t length;
+        uint8_t frame[5 + DEBUG_ITF_MAX_RX_PAYLOAD_SIZE];
+    } jobs[DEBUG_ITF_RX_JOB_QUEUE_LENGTH];
+    volatile uint8_t write_index;
+    volatile uint8_t read_index;
+} rx_jobs;
+#endif /* DEBUG_ITF_RX_DEFERRED_MODE */
+
+// While not 0, queued messages are only stored and transmission is started by the last debug_itf_release_tx(). Used to
+//  gather all messages of a group (like all replies to a single request) before the first one is sent, so that they can be
+//  sent together. Counter is used, as groups can be queued from main loop and interrupts at the same time.
+static uint8_t tx_hold_count = 0;
+
 //* Predefined answers for different possible debug interface requests
 //* 0xAA 0x55 - prefix that must be present in all debug interface messages
 static uint8_t message_ack[3] = { 0xAA, 0x55, 0xAA };
@@ -53,6 +227,149 @@ static uint8_t message_buffer_description[4] = { 0xAA, 0x55, 0x00, 0x00 }; // u8
 static uint8_t message_stream_properties[13] = { 0xAA, 0x55, DEBUG_ITF_START_DATA_STREAMING_Code, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
                                                 // u8 - stream id, u8 - number of fields, u16 - entries per message, u32 - stream timeout in ms, u16 - bytes per message
 static uint8_t message_stream_message_start[3] = { 0xAA, 0x55, DEBUG_ITF_STREAM_MESSAGE_START_Code };
+static uint8_t message_tx_queue_statistics[5 + DEBUG_ITF_TX_LANES_COUNT * 16] = { 0xAA, 0x55, DEBUG_ITF_READ_TX_QUEUE_STATISTICS_Code };
+                                                // u8 - number of lanes, u8 - depth units (0 - messages, 1 - bytes), for every lane:
+                                                // u32 - current depth, u32 - high water mark, u32 - queued messages, u32 - overflows
+// Headers of replies with payload. Taken like small per lane buffers, and there is one more of them than control lane can store
+static uint8_t message_payload_reply_headers[DEBUG_ITF_TX_CONTROL_QUEUE_LENGTH + 1U][5];
+static volatile uint8_t payload_reply_header_is_used[DEBUG_ITF_TX_CONTROL_QUEUE_LENGTH + 1U];
+static uint8_t message_link_telemetry[27] = { 0xAA, 0x55, DEBUG_ITF_READ_LINK_TELEMETRY_Code };
+                                                // u32 - sent bytes, u32 - sent messages, u32 - high water mark, u32 - overflows,
+                                                // u32 - busy cycles, u32 - current cycle
+static uint8_t message_tx_drop_statistics[4 + DEBUG_ITF_TX_LANES_COUNT * 17] = { 0xAA, 0x55, DEBUG_ITF_READ_TX_DROP_STATISTICS_Code };
+                                                // u8 - number of lanes, for every lane: u8 - drop policy, u32 - block timeout in cycles,
+                                                // u32 - dropped newest, u32 - dropped oldest, u32 - block timeouts
+// Headers of replies to tagged requests: prefix, DEBUG_ITF_TAGGED_REQUEST_Code, u16 - length, u8 - tag
+static uint8_t message_tagged_reply_headers[DEBUG_ITF_TX_LANES_COUNT][DEBUG_TX_LANE_POOL_LENGTH][6];
+static volatile uint8_t tagged_reply_header_is_used[DEBUG_ITF_TX_LANES_COUNT][DEBUG_TX_LANE_POOL_LENGTH];
+static uint8_t handled_request_tag = 0; // Tag of the tagged request that is being handled. Requests are handled one at a time
+
+/**************************************************************************************************/
+/*                                                                                                */
+/*                                  Static functions declarations                                 */
+/*                                                                                                */
+/**************************************************************************************************/
+
+static void debug_itf_hold_tx( void );
+static void debug_itf_release_tx( void );
+static void debug_itf_queue_reply( uint8_t* message, uint32_t message_length );
+static uint16_t debug_itf_queue_lane_messages( DEBUG_ITF_TX_LANE lane_id, const debug_tx_message messages[], uint8_t messages_count );
+static uint16_t debug_itf_try_queue_lane_messages( debug_tx_lane* lane, const debug_tx_message messages[], uint8_t messages_count );
+static uint16_t debug_itf_block_until_queued( debug_tx_lane* lane, const debug_tx_message messages[], uint8_t messages_count );
+
+static void debug_parse_rx_byte( uint8_t received_byte );
+#ifdef DEBUG_ITF_COBS_FRAMING
+static void debug_decode_cobs_rx_byte( uint8_t received_byte );
+#endif
+static void debug_complete_rx_frame( uint16_t frame_length );
+static void debug_dispatch_rx_frame( uint16_t frame_length );
+static void debug_handle_rx_request( uint8_t* message, uint32_t message_length );
+static void debug_itf_dispatch_request( const debug_itf_request* request );
+static uint16_t debug_itf_queue_tagged_message( DEBUG_ITF_TX_LANE lane_id, uint8_t tag, uint8_t* message, uint32_t message_length );
+static uint16_t debug_itf_queue_tagged_messages( DEBUG_ITF_TX_LANE lane_id, uint8_t tag, const debug_tx_message messages[],
+        uint8_t messages_count );
+static uint16_t debug_itf_queue_request_data_spans( const debug_itf_request* request, uint8_t* first_span, uint32_t first_length,
+        uint8_t* second_span, uint32_t second_length, debug_itf_message_release_cbk release_cbk );
+static void debug_itf_buffer_read_released( uint8_t* message );
+static uint16_t debug_itf_queue_tagged_reply( uint8_t* message, uint32_t message_length );
+
+static void debug_itf_establish_connection_handler( const debug_itf_request* request, void* context, debug_itf_reply_cbk reply );
+static void debug_itf_close_connection_handler( const debug_itf_request* request, void* context, debug_itf_reply_cbk reply );
+static void debug_itf_keep_alive_handler( const debug_itf_request* request, void* context, debug_itf_reply_cbk reply );
+static void debug_itf_read_error_log_handler( const debug_itf_request* request, void* context, debug_itf_reply_cbk reply );
+static void debug_itf_read_link_telemetry_handler( const debug_itf_request* request, void* context, debug_itf_reply_cbk reply );
+static void debug_itf_read_tx_queue_statistics_handler( const debug_itf_request* request, void* context, debug_itf_reply_cbk reply );
+static void debug_itf_read_tx_drop_statistics_handler( const debug_itf_request* request, void* context, debug_itf_reply_cbk reply );
+static void debug_itf_read_buffers_properties_handler( const debug_itf_request* request, void* context, debug_itf_reply_cbk reply );
+static void debug_itf_read_buffer_handler( const debug_itf_request* request, void* context, debug_itf_reply_cbk reply );
+static void debug_itf_start_streaming_handler( const debug_itf_request* request, void* context, debug_itf_reply_cbk reply );
+static void debug_itf_stop_streaming_handler( const debug_itf_request* request, void* context, debug_itf_reply_cbk reply );
+static void debug_itf_generic_request_handler( const debug_itf_request* request, void* context, debug_itf_reply_cbk reply );
+static void debug_itf_generic_parameter_request_handler( const debug_itf_request* request, void* context, debug_itf_reply_cbk reply );
+static void debug_itf_set_frame_crc_handler( const debug_itf_request* request, void* context, debug_itf_reply_cbk reply );
+static void debug_itf_tagged_request_handler( const debug_itf_request* request, void* context, debug_itf_reply_cbk reply );
+static void debug_itf_freeze_buffers_handler( const debug_itf_request* request, void* context, debug_itf_reply_cbk reply );
+
+static uint32_t debug_itf_take_next_transfer( uint8_t** transfer_start, uint32_t max_length );
+static void debug_itf_release_in_flight( void );
+static void debug_itf_set_tx_busy( void );
+static void debug_itf_clear_tx_busy( void );
+static uint32_t debug_itf_lane_used_space( const debug_tx_lane* lane );
+static uint32_t debug_itf_lane_ready_space( const debug_tx_lane* lane );
+static uint32_t debug_itf_lane_sent_messages_count( const debug_tx_lane* lane );
+static uint32_t debug_itf_lane_total_space( const debug_tx_lane* lane );
+static uint32_t debug_itf_lane_required_space( const debug_tx_message messages[], uint8_t messages_count );
+#ifdef DEBUG_ITF_TX_RING_MODE
+#ifdef DEBUG_ITF_COBS_FRAMING
+static uint32_t debug_itf_cobs_encoded_length( const debug_tx_message messages[], uint8_t messages_count );
+#endif
+static uint32_t debug_itf_lane_reserve( debug_tx_lane* lane, uint32_t length );
+static void debug_itf_lane_write_group( debug_tx_lane* lane, uint32_t write_index, const debug_tx_message messages[],
+        uint8_t messages_count );
+static void debug_itf_lane_commit( debug_tx_lane* lane, const debug_tx_message messages[], uint8_t messages_count );
+#else
+static void debug_itf_lane_push_group( debug_tx_lane* lane, const debug_tx_message messages[], uint8_t messages_count );
+#endif
+static uint8_t debug_itf_lane_group_is_started( const debug_tx_lane* lane );
+static uint8_t debug_itf_lane_drop_oldest( debug_tx_lane* lane );
+#ifndef DEBUG_ITF_TX_RING_MODE
+static void debug_itf_release_request( const debug_tx_request* request );
+#endif
+static uint32_t debug_itf_lane_take( debug_tx_lane* lane, uint8_t** transfer_start, uint32_t max_length );
+
+static uint8_t debug_itf_take_pool_buffer( volatile uint8_t* buffer_is_used, uint8_t buffers_count );
+static void debug_itf_payload_reply_header_released( uint8_t* message );
+static void debug_itf_tagged_reply_header_released( uint8_t* message );
+static void debug_itf_frame_crc_trailer_released( uint8_t* message );
+static void debug_itf_put_u32( uint8_t* target, uint32_t value );
+static uint8_t debug_itf_frame_crc_length( uint8_t mode );
+static uint32_t debug_itf_frame_crc( uint8_t mode, const debug_tx_message messages[], uint8_t messages_count );
+static uint8_t debug_itf_make_frame_crc_trailer( DEBUG_ITF_TX_LANE lane_id, uint8_t mode, const debug_tx_message messages[],
+        uint8_t messages_count, debug_tx_message* trailer_message );
+
+/**************************************************************************************************/
+/*                                                                                                */
+/*                                      Command table                                             */
+/*                                                                                                */
+/**************************************************************************************************/
+
+// Handlers of all requests indexed by request code, so dispatch time doesn't depend on the number of commands. Built in commands
+//  are registered here, application commands are added with debug_itf_register_command(). Requests with empty entry are ignored.
+static debug_itf_command command_table[256] =
+{
+    [DEBUG_ITF_ESTABLISH_CONNECTION_Code] = { .handler = debug_itf_establish_connection_handler },
+    [DEBUG_ITF_CLOSE_CONNECTION_Code] = { .handler = debug_itf_close_connection_handler },
+    [DEBUG_ITF_KEEP_ALIVE_Code] = { .handler = debug_itf_keep_alive_handler },
+    [DEBUG_ITF_READ_ERROR_LOG_Code] = { .handler = debug_itf_read_error_log_handler },
+    [DEBUG_ITF_READ_LINK_TELEMETRY_Code] = { .handler = debug_itf_read_link_telemetry_handler },
+    [DEBUG_ITF_READ_TX_QUEUE_STATISTICS_Code] = { .handler = debug_itf_read_tx_queue_statistics_handler },
+    [DEBUG_ITF_READ_TX_DROP_STATISTICS_Code] = { .handler = debug_itf_read_tx_drop_statistics_handler },
+    [DEBUG_ITF_READ_BUFFERS_PROPERTIES_Code] = { .handler = debug_itf_read_buffers_properties_handler },
+    [DEBUG_ITF_READ_BUFFERS_PROPERTIES_Code + 1 ... DEBUG_ITF_READ_BUFFERS_PROPERTIES_Code + DEBUG_MAX_BUFFERS_COUNT] =
+        { .handler = debug_itf_read_buffer_handler },
+    [DEBUG_ITF_START_DATA_STREAMING_Code] = { .handler = debug_itf_start_streaming_handler },
+    [DEBUG_ITF_STOP_DATA_STREAMING_Code] = { .handler = debug_itf_stop_streaming_handler },
+    [DEBUG_ITF_GENERIC_REQUEST_BASE_Code ... DEBUG_ITF_GENERIC_REQUEST_BASE_Code + 15] =
+        { .handler = debug_itf_generic_request_handler },
+    [DEBUG_ITF_SET_FRAME_CRC_Code] = { .handler = debug_itf_set_frame_crc_handler },
+    [DEBUG_ITF_TAGGED_REQUEST_Code] = { .handler = debug_itf_tagged_request_handler },
+    [DEBUG_ITF_FREEZE_BUFFERS_Code] = { .handler = debug_itf_freeze_buffers_handler },
+    [DEBUG_ITF_GENERIC_PARAMETER_REQUEST_BASE_Code ... DEBUG_ITF_GENERIC_PARAMETER_REQUEST_BASE_Code + 15] =
+        { .handler = debug_itf_generic_parameter_request_handler },
+};
+
+// Generic requests are kept as weak callbacks, so applications that redefine them don't need to register anything
+static void (* const generic_request_callbacks[16])( void ) =
+{
+    debug_itf_handle_generic_request_1_cbk, debug_itf_handle_generic_request_2_cbk,
+    debug_itf_handle_generic_request_3_cbk, debug_itf_handle_generic_request_4_cbk,
+    debug_itf_handle_generic_request_5_cbk, debug_itf_handle_generic_request_6_cbk,
+    debug_itf_handle_generic_request_7_cbk, debug_itf_handle_generic_request_8_cbk,
+    debug_itf_handle_generic_request_9_cbk, debug_itf_handle_generic_request_10_cbk,
+    debug_itf_handle_generic_request_11_cbk, debug_itf_handle_generic_request_12_cbk,
+    debug_itf_handle_generic_request_13_cbk, debug_itf_handle_generic_request_14_cbk,
+    debug_itf_handle_generic_request_15_cbk, debug_itf_handle_generic_request_16_cbk,
+};
 
 /**************************************************************************************************/
 /*                                                                                                */
@@ -61,266 +378,388 @@ static uint8_t message_stream_message_start[3] = { 0xAA, 0x55, DEBUG_ITF_STREAM_
 /**************************************************************************************************/
 
 /**
- * @brief Sends new message using UART if queue is empty. Queues the message if TX is busy. Logs error if queue is full.
+ * @brief Queues the message into the bulk lane. Used for all big messages like buffers and stream data.
+ *
+ * @return 0 if message was queued, error code otherwise
+ */
+uint16_t debug_itf_queue_message(uint8_t* message, uint32_t message_length)
+{
+    return debug_itf_queue_lane_message(DEBUG_ITF_TX_LANE_BULK, message, message_length);
+}
+
+/**
+ * @brief Queues the message into the given lane and starts transmission if TX is idle. If lane is full, lane drop policy is
+ *  applied. Error is logged and returned if message was not queued, so producers can lower their rate.
+ *
+ * In DEBUG_ITF_TX_RING_MODE the message is copied, so it can be reused right after the function returns. Otherwise
+ *  message must live until it is sent.
+ * Can be called from main loop and from interrupts of any priority at the same time.
+ *
+ * @return 0 if message was queued, error code otherwise
  */
-void debug_itf_queue_message(uint8_t* message, uint32_t message_length)
+uint16_t debug_itf_queue_lane_message(DEBUG_ITF_TX_LANE lane_id, uint8_t* message, uint32_t message_length)
 {
+    return debug_itf_queue_lane_owned_message(lane_id, message, message_length, (void*)(0));
+}
 
-    if(tx_queue.write_index == tx_queue.read_index)
-    {
-        if (tx_queue.tx_is_busy == 0)
-        {
-            // There were no ongoing transaction, so we can send directly
-            tx_queue.tx_is_busy = 1;
+/**
+ * @brief Same as debug_itf_queue_lane_message(), but release_cbk is called with the message pointer as soon as message memory
+ *  is not needed any longer: after it was copied or after transport has finished sending it. Dropped messages are released too.
+ *  Callback is not called if error is returned, so caller still owns the message in that case.
+ *
+ * @return 0 if message was queued, error code otherwise
+ */
+uint16_t debug_itf_queue_lane_owned_message( DEBUG_ITF_TX_LANE lane_id, uint8_t* message, uint32_t message_length,
+        debug_itf_message_release_cbk release_cbk )
+{
+    const debug_tx_message queued_message = { .message = message, .length = message_length, .release_cbk = release_cbk };
+    return debug_itf_queue_lane_messages(lane_id, &queued_message, 1);
+}
 
-            active_transport->send(message, message_length);
-            return;
-        }
-        else if (tx_queue.active_queue_size == DEBUG_ITF_TX_QUEUE_LENGTH)
-        {
-            // This means that we are in overflow. Write index caught up to read index
-            LOG_ERROR(4214);
-            return; // In case of overflow we log error, but do not overwrite the queue.
-        }
+/**
+ * @brief Sets what lane does with new messages when it is full.
+ *
+ * With DEBUG_ITF_TX_BLOCK the caller spins for up to block_timeout_cycles of transport get_cycle_count(). Space is only freed by
+ *  TX interrupt, so the policy must not be used by code that runs with higher priority than it, or while TX is on hold. In
+ *  DEBUG_ITF_TX_RING_MODE bytes are only sent after all producers that copy into the lane have committed, so the caller must
+ *  not preempt another producer of the same lane either.
+ *
+ * @return 0 on success, error code if lane or policy is not valid
+ */
+uint16_t debug_itf_set_tx_lane_drop_policy( DEBUG_ITF_TX_LANE lane_id, DEBUG_ITF_TX_DROP_POLICY policy, uint32_t block_timeout_cycles )
+{
+    if(lane_id >= DEBUG_ITF_TX_LANES_COUNT)
+    {
+        LOG_ERROR(4216); // Unknown TX lane
+        return 4216;
     }
 
-    // Add message to the TX queue
-    tx_queue.requests[tx_queue.write_index].length = message_length;
-    tx_queue.requests[tx_queue.write_index].message = message;
+    if(policy > DEBUG_ITF_TX_BLOCK)
+    {
+        LOG_ERROR(4218); // Unknown drop policy
+        return 4218;
+    }
 
-    tx_queue.active_queue_size += 1;
-    tx_queue.write_index += 1;
-    if(tx_queue.write_index == DEBUG_ITF_TX_QUEUE_LENGTH)
+    if(policy == DEBUG_ITF_TX_BLOCK && active_transport->get_cycle_count == (void*)(0))
     {
-        tx_queue.write_index = 0;
+        LOG_ERROR(4219); // Transport can't measure block timeout
+        return 4219;
     }
+
+    const debug_port_critical_state critical_state = debug_port_enter_critical();
+    tx_queue.lanes[lane_id].drop_policy = policy;
+    tx_queue.lanes[lane_id].block_timeout_cycles = block_timeout_cycles;
+    debug_port_exit_critical(critical_state);
+
+    return 0;
 }
 
 /**
- * @brief Sends next message if available from the queue. Resets communication if no message is available.
+ * @brief Releases the finished transfer and sends the next one if available. Resets communication if no message is available.
  *
  * @note This function must be called in the TX DMA TCIF interrupt handler, because the function expects
  *  to be called right after previous message was fully sent.
  */
 void debug_itf_update_message_queue( void )
 {
-    const uint32_t queue_length_is_zero = (tx_queue.write_index == tx_queue.read_index);
-    if(queue_length_is_zero && tx_queue.active_queue_size == 0)
+    const debug_port_critical_state critical_state = debug_port_enter_critical();
+
+    debug_itf_release_in_flight();
+
+    uint8_t* transfer_start = (void*)(0);
+    const uint32_t transfer_length = debug_itf_take_next_transfer(&transfer_start, DEBUG_ITF_MAX_TRANSFER_SIZE);
+    if(transfer_length == 0)
     {
-        // If code interrupted here with an interrupt that will queue new message, message will not be sent
-        tx_queue.tx_is_busy = 0;
-        return;
+        // Busy flag is cleared inside the critical section, so a message queued right after this will start a new transfer by itself
+        debug_itf_clear_tx_busy();
     }
 
-    uint32_t read_index = tx_queue.read_index;
-    active_transport->send(tx_queue.requests[read_index].message, tx_queue.requests[read_index].length);
+    debug_port_exit_critical(critical_state);
 
-    read_index += 1;
-    if ( read_index == DEBUG_ITF_TX_QUEUE_LENGTH )
+    if(transfer_length != 0)
     {
-        read_index = 0;
+        active_transport->send(transfer_start, transfer_length);
     }
-
-    tx_queue.read_index = read_index;
-    tx_queue.active_queue_size -= 1;
 }
 
 /**
- * @brief handles all debug inteface RX requests.
+ * @brief Copies up to max_length queued bytes into target memory and releases them. Used by transports that send data
+ *  from their own memory (like circular DMA), instead of sending every transfer given to send() directly.
+ *
+ * Transfer that was given to send() is released too, so transport must copy it before calling this function. Transport keeps
+ *  TX busy while it pulls the data, and must call debug_handle_tx() when it stops, so that TX can be restarted by new messages.
+ * Nothing is returned while messages are on hold, so a group of messages is never split by the time transport has to wait.
  *
+ * @return number of copied bytes
+ */
+uint32_t debug_itf_pull_tx_data( uint8_t* target, uint32_t max_length )
+{
+    uint32_t copied_length = 0;
+
+    const debug_port_critical_state critical_state = debug_port_enter_critical();
+
+    debug_itf_release_in_flight();
+
+    while(tx_hold_count == 0 && copied_length < max_length)
+    {
+        uint8_t* transfer_start;
+        const uint32_t transfer_length = debug_itf_take_next_transfer(&transfer_start, max_length - copied_length);
+        if(transfer_length == 0)
+        {
+            break;
+        }
+
+        memcpy(&target[copied_length], transfer_start, transfer_length);
+        copied_length += transfer_length;
+
+        debug_itf_release_in_flight();
+    }
+
+    debug_port_exit_critical(critical_state);
+
+    return copied_length;
+}
+
+/**
+ * @brief Returns usage statistics of the TX lane. Returns null pointer for unknown lane.
+ */
+const debug_itf_tx_lane_statistics* debug_itf_get_tx_lane_statistics( DEBUG_ITF_TX_LANE lane_id )
+{
+    if(lane_id >= DEBUG_ITF_TX_LANES_COUNT)
+    {
+        return (void*)(0);
+    }
+
+    return &tx_queue.lanes[lane_id].statistics;
+}
+
+/**
+ * @brief Returns transport cycle count, or 0 if transport can't count cycles
+ */
+uint32_t debug_itf_get_cycle_count( void )
+{
+    if(active_transport->get_cycle_count == (void*)(0))
+    {
+        return 0;
+    }
+
+    return active_transport->get_cycle_count();
+}
+
+/**
+ * @brief Queues a reply with payload into the control lane: 0xAA 0x55 code length_low length_high payload.
+ *  DEBUG_ITF_PAYLOAD_FLAG is always set in the sent code.
  *
- * Current implementation doesn't support multiple requests sent as a single UART message, each request needs to be sent separately one by one.
+ * Header and payload are queued together. Payload must live until it is sent, unless DEBUG_ITF_TX_RING_MODE is used.
+ *  In DEBUG_ITF_TX_RING_MODE header and payload must fit into DEBUG_ITF_TX_CONTROL_RING_SIZE.
  *
- * todo Write a documentation for the protocol and link documentation in this comment
+ * @return 0 if reply was queued, error code otherwise
  */
-void debug_handle_rx(uint8_t* message, uint32_t message_length)
+uint16_t debug_itf_queue_payload_reply( uint8_t code, uint8_t* payload, uint16_t payload_length )
 {
-	if(message_length <= 2)
-	{
-        LOG_ERROR(3221); // Invalid message length
-        debug_itf_queue_message(message_nack, sizeof(message_nack));
-        return;
-	}
+    const uint8_t header_index = debug_itf_take_pool_buffer(payload_reply_header_is_used, sizeof(payload_reply_header_is_used));
+    if(header_index == sizeof(payload_reply_header_is_used))
+    {
+        LOG_ERROR(4214); // All headers are queued, so control lane is full
+        return 4214;
+    }
 
-	if(message[0] != 0xAA || message[1] != 0x55)
-	{
-		LOG_ERROR(3222); // Invalid message prefix. Message is not a part of debug protocol, or buffer doesn't store the beginning of the message.
-        debug_itf_queue_message(message_nack, sizeof(message_nack));
-        return;
-	}
+    uint8_t* header = message_payload_reply_headers[header_index];
+    header[0] = 0xAA;
+    header[1] = 0x55;
+    header[2] = code | DEBUG_ITF_PAYLOAD_FLAG;
+    header[3] = (uint8_t)(payload_length & 0xFFU);
+    header[4] = (uint8_t)(payload_length >> 8);
 
+    const debug_tx_message messages[2] =
+    {
+        { .message = header, .length = 5, .release_cbk = debug_itf_payload_reply_header_released },
+        { .message = payload, .length = payload_length },
+    };
 
-	if(message_length == 3) // one byte requests
-	{
-		if( message[2] == DEBUG_ITF_ESTABLISH_CONNECTION_Code )
-		{
-			debug_connection_is_established = 1;
-			debug_itf_queue_message(message_ack, sizeof(message_ack));
-			return;
-		}
-
-		if( message[2] == DEBUG_ITF_CLOSE_CONNECTION_Code )
-		{
-			debug_connection_is_established = 0;
-			debug_itf_queue_message(message_ack, sizeof(message_ack));
-			return;
-		}
-
-		if( message[2] == DEBUG_ITF_KEEP_ALIVE_Code )
-		{
-			if(debug_connection_is_established == 0)
-			{
-				// NACK keep alive if connection wasn't established. Can help to find unintentional MCU reset
-				debug_itf_queue_message(message_nack, sizeof(message_nack));
-			}
-			else
-			{
-				debug_itf_queue_message(message_ack, sizeof(message_ack));
-			}
-			return;
-		}
-
-		if( message[2] == DEBUG_ITF_READ_ERROR_LOG_Code )
-		{
-			// Write error log depth to bytes 4 and 5 of the error log
-			uint16_t* value_ptr = (uint16_t*)(&message_error_log_properties[3]);
-			*value_ptr = DEBUG_ERROR_LOG_DEPTH;
-
-			message_error_log_properties[5] = DEBUG_ERROR_LOG_VERSION;
-			debug_itf_queue_message(message_error_log_properties, sizeof(message_error_log_properties));
-
-			// Send error log
-			debug_itf_queue_message((uint8_t*)debug_get_error_log_ptr(), sizeof(debug_error_log));
-			return;
-		}
-		if( message[2] == DEBUG_ITF_READ_BUFFERS_PROPERTIES_Code )
-		{
-			debug_com_buffers* buffers = debug_get_com_buffer();
-			message_buffers_properties[3] = buffers->next_free_buffer_index;
-			uint16_t* value_ptr = (uint16_t*)(&message_buffers_properties[4]);
-			*value_ptr = DEBUG_BUFFER_SIZE; // Number of points in a buffer
-			debug_itf_queue_message(message_buffers_properties, sizeof(message_buffers_properties));
-			buffers->read_requests_count += 1;
-			return;
-		}
-
-		// Read one of available buffers
-		if ( message[2] > DEBUG_ITF_READ_BUFFERS_PROPERTIES_Code && message[2] <= (DEBUG_ITF_READ_BUFFERS_PROPERTIES_Code + DEBUG_MAX_BUFFERS_COUNT) )
-		{
-			uint8_t requested_index = message[2] - DEBUG_ITF_READ_BUFFERS_PROPERTIES_Code - 1;
-			debug_com_buffers* buffers = debug_get_com_buffer();
-			if( requested_index > buffers->next_free_buffer_index )
-			{
-				debug_itf_queue_message(message_nack, sizeof(message_nack));
-			}
-			debug_itf_queue_message(message_ack, sizeof(message_ack));
-
-			uint8_t buffer_type = buffers->buffers_types[requested_index];
-			uint8_t* buffer_pointer = (uint8_t*)(buffers->buffers_values[requested_index]);
-
-			uint16_t data_size = DEBUG_BUFFER_SIZE;
-
-			message_buffer_description[2] = message[2];
-			message_buffer_description[3] = buffer_type;
-			debug_itf_queue_message(message_buffer_description, sizeof(message_buffer_description));
-
-			if( buffer_type == F32_Type || buffer_type == I32_Type || buffer_type == U32_Type )
-			{
-				data_size *= 4;
-			}
-			else if( buffer_type == I16_Type || buffer_type == U16_Type )
-			{
-				data_size *= 2;
-			}
-
-			// Send buffer description first and than buffer itself
-			debug_itf_queue_message(buffer_pointer, data_size);
-			return;
-		}
-
-		if( message[2] == DEBUG_ITF_START_DATA_STREAMING_Code )
-		{
-            debug_itf_queue_message(message_ack, sizeof(message_ack));
-            debug_com_stream* active_stream = debug_get_active_com_stream();
-            if(active_stream == (void*)(0))
-            {
-                message_stream_properties[3] = 0; // Stream id 0 is forbidden, client should treat it as no stream is registered
-                debug_itf_queue_message(message_stream_properties, sizeof(message_stream_properties));
-                return;
-            }
-            else
-            {
-                message_stream_properties[3] = active_stream->id;
-                message_stream_properties[4] = active_stream->entry_fields_count;
+    const uint16_t queue_error = debug_itf_queue_lane_messages(DEBUG_ITF_TX_LANE_CONTROL, messages, (payload_length == 0) ? 1 : 2);
+    if(queue_error != 0)
+    {
+        debug_itf_payload_reply_header_released(header);
+    }
+    return queue_error;
+}
 
-                uint16_t* u16_value_ptr = (uint16_t*)(&message_stream_properties[5]);
-                *u16_value_ptr = active_stream->entries_per_message_count;
+/**
+ * @brief Queues reply to a request into the control lane. Default reply callback of registered commands
+ *
+ * @return 0 if reply was queued, error code otherwise
+ */
+uint16_t debug_itf_queue_reply_message( uint8_t* message, uint32_t message_length )
+{
+    return debug_itf_queue_lane_message(DEBUG_ITF_TX_LANE_CONTROL, message, message_length);
+}
+
+/**
+ * @brief Queues reply to a request after its handler has returned, like when the reply waits for an application event. Only
+ *  code and tag of the request are used, so a copy of the request without payload can be kept until then.
+ *
+ * @return 0 if reply was queued, error code otherwise
+ */
+uint16_t debug_itf_queue_request_reply( const debug_itf_request* request, uint8_t* message, uint32_t message_length )
+{
+    return debug_itf_queue_request_owned_reply(request, message, message_length, (void*)(0));
+}
 
-                uint32_t *u32_value_ptr = (uint32_t*)(&message_stream_properties[7]);
-                *u32_value_ptr = active_stream->timeout_ms;
+/**
+ * @brief Same as debug_itf_queue_request_reply(), but release_cbk is called like in debug_itf_queue_lane_owned_message(), so a
+ *  reply buffer can be marked busy until it is sent. Callback is not called if error is returned.
+ *
+ * @return 0 if reply was queued, error code otherwise
+ */
+uint16_t debug_itf_queue_request_owned_reply( const debug_itf_request* request, uint8_t* message, uint32_t message_length,
+        debug_itf_message_release_cbk release_cbk )
+{
+    if(request->is_tagged != 0)
+    {
+        const debug_tx_message tagged_message = { .message = message, .length = message_length, .release_cbk = release_cbk };
+        return debug_itf_queue_tagged_messages(DEBUG_ITF_TX_LANE_CONTROL, request->tag, &tagged_message, 1);
+    }
+    return debug_itf_queue_lane_owned_message(DEBUG_ITF_TX_LANE_CONTROL, message, message_length, release_cbk);
+}
 
-                u16_value_ptr = (uint16_t*)(&message_stream_properties[11]);
-                *u16_value_ptr = active_stream->message_byte_size;
+/**
+ * @brief Queues data sent in reply to a request (like buffer content) into the bulk lane. Data of tagged requests is sent with
+ *  the tag header, so it can be matched to the request. Data must live until it is sent, unless DEBUG_ITF_TX_RING_MODE is used.
+ *
+ * @return 0 if data was queued, error code otherwise
+ */
+uint16_t debug_itf_queue_request_data( const debug_itf_request* request, uint8_t* message, uint32_t message_length )
+{
+    if(request->is_tagged != 0)
+    {
+        return debug_itf_queue_tagged_message(DEBUG_ITF_TX_LANE_BULK, request->tag, message, message_length);
+    }
+    return debug_itf_queue_message(message, message_length);
+}
 
-                debug_itf_queue_message(message_stream_properties, sizeof(message_stream_properties));
-            }
+/**
+ * @brief Sets CRC trailer used for all following frames in both directions. Messages that are already queued keep the trailer they
+ *  were queued with. Should only be changed when client doesn't wait for data, like when stream is stopped.
+ *
+ * @return 0 on success, error code if mode is unknown
+ */
+uint16_t debug_itf_set_frame_crc( DEBUG_ITF_FRAME_CRC mode )
+{
+    if(mode > DEBUG_ITF_FRAME_CRC_32)
+    {
+        LOG_ERROR(3228); // Unknown frame CRC mode
+        return 3228;
+    }
 
-            if(active_stream->entry_fields_count >= 3)
-            {
-                debug_itf_queue_message(active_stream->entry_fields_types, active_stream->entry_fields_count);
-            }
-            else
-            {
-                // Send at least 3 bytes to not brick the DMA interrupt. This situation is supposed to be handled on the client as well
-                debug_itf_queue_message(active_stream->entry_fields_types, 3);
-            }
+    frame_crc_mode = mode;
+    return 0;
+}
 
-            active_stream->is_active = 1;
-			return;
-		}
+/**
+ * @brief Registers handler of requests with the given code. Code must not be used by a built in or another registered command.
+ *
+ * Requests with DEBUG_ITF_PAYLOAD_FLAG set in the code carry payload. Context is passed to handler as is. If reply_cbk is null,
+ *  replies are queued into the control lane with debug_itf_queue_reply_message().
+ *
+ * @return 0 if handler was registered, error code otherwise
+ */
+uint16_t debug_itf_register_command( uint8_t code, debug_itf_command_handler handler, void* context, debug_itf_reply_cbk reply_cbk )
+{
+    if(handler == (void*)(0))
+    {
+        LOG_ERROR(3225); // Command handler is not set
+        return 3225;
+    }
 
-		if( message[2] == DEBUG_ITF_STOP_DATA_STREAMING_Code )
-		{
-            debug_com_stream* active_stream = debug_get_active_com_stream();
-		    active_stream->is_active = 0;
+    uint16_t error_code = 0;
+    const debug_port_critical_state critical_state = debug_port_enter_critical();
+    if(command_table[code].handler != (void*)(0))
+    {
+        error_code = 3226;
+    }
+    else
+    {
+        command_table[code].context = context;
+        command_table[code].reply_cbk = reply_cbk;
+        command_table[code].handler = handler;
+    }
+    debug_port_exit_critical(critical_state);
 
-            debug_itf_queue_message(message_ack, sizeof(message_ack));
+    if(error_code != 0)
+    {
+        LOG_ERROR(3226); // Command code is already used. Unregister previous handler first
+    }
+    return error_code;
+}
 
-		    return;
-		}
+/**
+ * @brief Removes handler of the given code, so requests with it are ignored. Built in commands can be removed as well
+ */
+void debug_itf_unregister_command( uint8_t code )
+{
+    const debug_port_critical_state critical_state = debug_port_enter_critical();
+    command_table[code].handler = (void*)(0);
+    command_table[code].context = (void*)(0);
+    command_table[code].reply_cbk = (void*)(0);
+    debug_port_exit_critical(critical_state);
+}
 
-		// Call one of the generic functions
-		if( message[2] >= DEBUG_ITF_GENERIC_REQUEST_BASE_Code && message[2] < DEBUG_ITF_GENERIC_REQUEST_BASE_Code + 16)
-		{
-		    debug_itf_queue_message(message_ack, sizeof(message_ack));
+/**
+ * @brief Copies counters of the whole TX link into telemetry
+ */
+void debug_itf_get_link_telemetry( debug_itf_link_telemetry* telemetry )
+{
+    const debug_port_critical_state critical_state = debug_port_enter_critical();
 
-		    uint8_t selector = message[2] - DEBUG_ITF_GENERIC_REQUEST_BASE_Code;
+    telemetry->sent_bytes_count = tx_queue.sent_bytes_count;
+    telemetry->sent_messages_count = 0;
+    telemetry->high_water_mark = 0;
+    telemetry->overflows_count = 0;
+    for(uint8_t lane_id = 0; lane_id < DEBUG_ITF_TX_LANES_COUNT; lane_id++)
+    {
+        const debug_tx_lane* lane = &tx_queue.lanes[lane_id];
+        telemetry->sent_messages_count += debug_itf_lane_sent_messages_count(lane);
+        telemetry->overflows_count += lane->statistics.overflows_count;
+        if(lane->statistics.high_water_mark > telemetry->high_water_mark)
+        {
+            telemetry->high_water_mark = lane->statistics.high_water_mark;
+        }
+    }
 
-		    switch(selector)
-		    {
-		    case 0: debug_itf_handle_generic_request_1_cbk(); break;
-		    case 1: debug_itf_handle_generic_request_2_cbk(); break;
-		    case 2: debug_itf_handle_generic_request_3_cbk(); break;
-		    case 3: debug_itf_handle_generic_request_4_cbk(); break;
-		    case 4: debug_itf_handle_generic_request_5_cbk(); break;
-		    case 5: debug_itf_handle_generic_request_6_cbk(); break;
-		    case 6: debug_itf_handle_generic_request_7_cbk(); break;
-		    case 7: debug_itf_handle_generic_request_8_cbk(); break;
-		    case 8: debug_itf_handle_generic_request_9_cbk(); break;
-		    case 9: debug_itf_handle_generic_request_10_cbk(); break;
-		    case 10: debug_itf_handle_generic_request_11_cbk(); break;
-		    case 11: debug_itf_handle_generic_request_12_cbk(); break;
-		    case 12: debug_itf_handle_generic_request_13_cbk(); break;
-		    case 13: debug_itf_handle_generic_request_14_cbk(); break;
-		    case 14: debug_itf_handle_generic_request_15_cbk(); break;
-		    case 15: debug_itf_handle_generic_request_16_cbk(); break;
-		    }
+    telemetry->current_cycle = debug_itf_get_cycle_count();
+    telemetry->busy_cycles_count = tx_queue.busy_cycles_count;
+    if(tx_queue.tx_is_busy != 0)
+    {
+        telemetry->busy_cycles_count += telemetry->current_cycle - tx_queue.busy_start_cycle;
+    }
 
-		    return;
-		}
+    debug_port_exit_critical(critical_state);
+}
+/**
+ * @brief handles all debug inteface RX requests.
+ *
+ * Received bytes can be any part of the RX byte stream. Frames are found by 0xAA 0x55 prefix, so a single call can contain several
+ *  requests sent one after another, and a request can be split between several calls. Bytes outside of frames are skipped.
+ * TX is put on hold while the received bytes are handled, so all short replies to all requests can be sent as a single transfer.
+ * Parser state is not protected, so the function must always be called from the same context (like UART RX interrupt).
+ *
+ * todo Write a documentation for the protocol and link documentation in this comment
+ */
+void debug_handle_rx(uint8_t* message, uint32_t message_length)
+{
+    debug_itf_hold_tx();
 
+    for(uint32_t i = 0; i < message_length; i++)
+    {
+#ifdef DEBUG_ITF_COBS_FRAMING
+        debug_decode_cobs_rx_byte(message[i]);
+#else
+        debug_parse_rx_byte(message[i]);
+#endif
+    }
 
-	} /* message_length == 3 */
+    debug_itf_release_tx();
 }
 
 
@@ -330,27 +769,1650 @@ void debug_handle_tx(void)
 }
 
 
-void debug_update_com_stream( void )
+/**
+ * @brief Handles all requests queued by debug_handle_rx() in DEBUG_ITF_RX_DEFERRED_MODE. Does nothing in other modes.
+ *
+ * Must be called from a single low priority context, like main loop or PendSV interrupt. Replies to all handled requests
+ *  are sent as a single group.
+ */
+void debug_poll( void )
+{
+#ifdef DEBUG_ITF_RX_DEFERRED_MODE
+    if(rx_jobs.read_index == rx_jobs.write_index)
+    {
+        return;
+    }
+
+    debug_itf_hold_tx();
+
+    while(rx_jobs.read_index != rx_jobs.write_index)
+    {
+        const uint8_t job_index = rx_jobs.read_index & (DEBUG_ITF_RX_JOB_QUEUE_LENGTH - 1U);
+        debug_handle_rx_request(rx_jobs.jobs[job_index].frame, rx_jobs.jobs[job_index].length);
+
+        // Job is freed only after it was handled, as the request is handled in place
+        rx_jobs.read_index += 1;
+    }
+
+    debug_itf_release_tx();
+#endif
+}
+
+
+/**
+ * @brief Queues the current message of the active stream. Does nothing if stream is not active.
+ *
+ * @return 0 if message was queued, 4220 if stream is not active (not logged), other error code if message was dropped
+ */
+pif_error_code debug_update_com_stream( void )
 {
     debug_com_stream* active_stream = debug_get_active_com_stream();
     if(active_stream == (void*)(0))
     {
-        return;
+        return 4220; // No stream is subscribed to
     }
 
     if(active_stream->is_active == 0)
     {
-        return;
+        return 4220; // No stream is subscribed to
     }
 
-    debug_itf_queue_message(message_stream_message_start, sizeof(message_stream_message_start));
-    debug_itf_queue_message(active_stream->message, active_stream->message_byte_size);
+    // Header and data are queued together, so either both or none of them are sent
+    const debug_tx_message messages[2] =
+    {
+        { .message = message_stream_message_start, .length = sizeof(message_stream_message_start) },
+        { .message = active_stream->message, .length = active_stream->message_byte_size, .release_cbk = active_stream->message_released_cbk },
+    };
+
+    return debug_itf_queue_lane_messages(DEBUG_ITF_TX_LANE_BULK, messages, 2);
 }
 
 
+/**************************************************************************************************/
+/*                                                                                                */
+/*                                  Static functions definitions                                  */
+/*                                                                                                */
+/**************************************************************************************************/
 
-// Weak empty definitions for all generic requests. All these functions are intended to be redefined in application code
-__attribute__((weak)) void debug_itf_handle_generic_request_1_cbk( void ) {}
+/**
+ * @brief Stops new transfers from being started by debug_itf_queue_message()
+ */
+static void debug_itf_hold_tx( void )
+{
+    const debug_port_critical_state critical_state = debug_port_enter_critical();
+    tx_hold_count += 1;
+    debug_port_exit_critical(critical_state);
+}
+
+/**
+ * @brief Allows transfers to be started again after the last release and starts sending messages queued during hold if TX is idle
+ */
+static void debug_itf_release_tx( void )
+{
+    const debug_port_critical_state critical_state = debug_port_enter_critical();
+
+    tx_hold_count -= 1;
+
+    uint8_t transfer_must_be_started = 0;
+    if(tx_hold_count == 0 && tx_queue.tx_is_busy == 0)
+    {
+        debug_itf_set_tx_busy();
+        transfer_must_be_started = 1;
+    }
+
+    debug_port_exit_critical(critical_state);
+
+    if(transfer_must_be_started != 0)
+    {
+        debug_itf_update_message_queue(); // Clears busy flag by itself if nothing was queued
+    }
+}
+
+
+/**
+ * @brief Queues reply to a request into the control lane
+ */
+static void debug_itf_queue_reply( uint8_t* message, uint32_t message_length )
+{
+    debug_itf_queue_reply_message(message, message_length);
+}
+
+
+/**
+ * @brief Queues all messages into the lane, so that they are sent one after another. If they don't fit, none of them is queued
+ *  and lane drop policy is applied. Logs and returns error if messages were not queued.
+ */
+static uint16_t debug_itf_queue_lane_messages( DEBUG_ITF_TX_LANE lane_id, const debug_tx_message messages[], uint8_t messages_count )
+{
+    if(lane_id >= DEBUG_ITF_TX_LANES_COUNT)
+    {
+        LOG_ERROR(4216); // Unknown TX lane
+        return 4216;
+    }
+
+    debug_tx_lane* lane = &tx_queue.lanes[lane_id];
+
+    // CRC is calculated before anything is locked, as messages can be long
+    debug_tx_message framed_messages[DEBUG_TX_MAX_GROUP_MESSAGES_COUNT];
+    const uint8_t crc_mode = frame_crc_mode;
+    uint16_t queue_error = 0;
+    if(crc_mode != DEBUG_ITF_FRAME_CRC_NONE)
+    {
+        memcpy(framed_messages, messages, messages_count * sizeof(debug_tx_message));
+        if(debug_itf_make_frame_crc_trailer(lane_id, crc_mode, messages, messages_count, &framed_messages[messages_count]) == 0)
+        {
+            queue_error = 4214; // All trailers of the lane are queued, so lane is full
+        }
+        messages = framed_messages;
+        messages_count += 1;
+    }
+
+    if(queue_error == 0)
+    {
+        queue_error = debug_itf_try_queue_lane_messages(lane, messages, messages_count);
+    }
+    if(queue_error == 4214 && lane->drop_policy == DEBUG_ITF_TX_BLOCK)
+    {
+        queue_error = debug_itf_block_until_queued(lane, messages, messages_count);
+    }
+
+    if(queue_error == 0)
+    {
+        return 0;
+    }
+
+    if(crc_mode != DEBUG_ITF_FRAME_CRC_NONE && messages[messages_count - 1U].message != (void*)(0))
+    {
+        debug_itf_frame_crc_trailer_released(messages[messages_count - 1U].message); // Trailer wasn't queued
+    }
+
+    const debug_port_critical_state critical_state = debug_port_enter_critical();
+    lane->statistics.overflows_count += 1;
+    if(queue_error == 4217)
+    {
+        lane->statistics.block_timeouts_count += 1;
+    }
+    else
+    {
+        lane->statistics.dropped_newest_count += 1;
+    }
+    debug_port_exit_critical(critical_state);
+
+    LOG_ERROR(queue_error); // In case of overflow we log error, but do not overwrite the queue
+    return queue_error;
+}
+
+
+/**
+ * @brief Pushes all messages into the lane if they fit, dropping oldest ones first if lane policy allows it.
+ *  Starts transmission if TX is idle and not on hold.
+ *
+ * @return 0 on success, 4214 if lane is full, 4215 if messages can never fit into the lane
+ */
+static uint16_t debug_itf_try_queue_lane_messages( debug_tx_lane* lane, const debug_tx_message messages[], uint8_t messages_count )
+{
+    const uint32_t required_space = debug_itf_lane_required_space(messages, messages_count);
+    if(required_space > debug_itf_lane_total_space(lane))
+    {
+        return 4215; // Messages can never fit into the lane
+    }
+
+    debug_port_critical_state critical_state = debug_port_enter_critical();
+
+    while(debug_itf_lane_total_space(lane) - debug_itf_lane_used_space(lane) < required_space)
+    {
+        const uint8_t dropped_count = (lane->drop_policy == DEBUG_ITF_TX_DROP_OLDEST) ? debug_itf_lane_drop_oldest(lane) : 0;
+        if(dropped_count == 0)
+        {
+            debug_port_exit_critical(critical_state);
+            return 4214; // Lane overflow
+        }
+
+        lane->statistics.overflows_count += 1;
+        lane->statistics.dropped_oldest_count += dropped_count;
+    }
+
+#ifdef DEBUG_ITF_TX_RING_MODE
+    // Only space is reserved with interrupts disabled. Messages are copied (or COBS encoded) with interrupts enabled and published
+    //  by the commit, so time with interrupts disabled doesn't grow with message length
+    const uint32_t reserved_index = debug_itf_lane_reserve(lane, required_space);
+    debug_port_exit_critical(critical_state);
+
+    debug_itf_lane_write_group(lane, reserved_index, messages, messages_count);
+
+    critical_state = debug_port_enter_critical();
+    debug_itf_lane_commit(lane, messages, messages_count);
+#else
+    debug_itf_lane_push_group(lane, messages, messages_count);
+#endif
+
+    const uint32_t used_space = debug_itf_lane_used_space(lane);
+    if(used_space > lane->statistics.high_water_mark)
+    {
+        lane->statistics.high_water_mark = used_space;
+    }
+
+    uint8_t* transfer_start = (void*)(0);
+    uint32_t transfer_length = 0;
+    if(tx_queue.tx_is_busy == 0 && tx_hold_count == 0)
+    {
+        // There were no ongoing transaction, so we can send directly. Busy flag is already set, so no other
+        //  caller can start a transfer until this one is finished.
+        debug_itf_set_tx_busy();
+        transfer_length = debug_itf_take_next_transfer(&transfer_start, DEBUG_ITF_MAX_TRANSFER_SIZE);
+        if(transfer_length == 0)
+        {
+            debug_itf_clear_tx_busy(); // Preempted producer has an open reservation, so it starts the transfer by its commit
+        }
+    }
+
+    debug_port_exit_critical(critical_state);
+
+    if(transfer_length != 0)
+    {
+        active_transport->send(transfer_start, transfer_length);
+    }
+
+    return 0;
+}
+
+
+/**
+ * @brief Retries to queue the messages until TX frees enough space or lane block timeout elapses
+ *
+ * @return 0 on success, 4217 on timeout, other error code if messages can never be queued
+ */
+static uint16_t debug_itf_block_until_queued( debug_tx_lane* lane, const debug_tx_message messages[], uint8_t messages_count )
+{
+    const uint32_t block_start_cycle = active_transport->get_cycle_count();
+
+    do
+    {
+        const uint16_t queue_error = debug_itf_try_queue_lane_messages(lane, messages, messages_count);
+        if(queue_error != 4214)
+        {
+            return queue_error;
+        }
+    } while(active_transport->get_cycle_count() - block_start_cycle < lane->block_timeout_cycles);
+
+    return 4217; // TX didn't free enough space before block timeout
+}
+
+
+/**
+ * @brief Feeds a single received byte into the RX frame parser and handles the request when its frame is complete
+ */
+static void debug_parse_rx_byte( uint8_t received_byte )
+{
+    switch(rx_parser.state)
+    {
+    case DEBUG_RX_WAIT_PREFIX_FIRST_BYTE:
+        if(received_byte == 0xAA)
+        {
+            rx_parser.frame[0] = received_byte;
+            rx_parser.state = DEBUG_RX_WAIT_PREFIX_SECOND_BYTE;
+            rx_parser.is_skipping_bytes = 0;
+        }
+        else if(rx_parser.is_skipping_bytes == 0)
+        {
+            LOG_ERROR(3222); // Invalid message prefix. Bytes are not a part of debug protocol and are skipped until the next prefix
+            rx_parser.is_skipping_bytes = 1;
+        }
+        break;
+
+    case DEBUG_RX_WAIT_PREFIX_SECOND_BYTE:
+        if(received_byte == 0x55)
+        {
+            rx_parser.frame[1] = received_byte;
+            rx_parser.state = DEBUG_RX_WAIT_CODE;
+        }
+        else if(received_byte != 0xAA) // 0xAA can be the first byte of the actual prefix, so we keep waiting for 0x55
+        {
+            LOG_ERROR(3222); // Invalid message prefix
+            rx_parser.state = DEBUG_RX_WAIT_PREFIX_FIRST_BYTE;
+            rx_parser.is_skipping_bytes = 1;
+        }
+        break;
+
+    case DEBUG_RX_WAIT_CODE:
+        rx_parser.frame[2] = received_byte;
+        if((received_byte & DEBUG_ITF_PAYLOAD_FLAG) != 0)
+        {
+            rx_parser.state = DEBUG_RX_WAIT_LENGTH_LOW_BYTE;
+            break;
+        }
+
+        rx_parser.state = DEBUG_RX_WAIT_PREFIX_FIRST_BYTE;
+        debug_complete_rx_frame(3);
+        break;
+
+    case DEBUG_RX_WAIT_LENGTH_LOW_BYTE:
+        rx_parser.frame[3] = received_byte;
+        rx_parser.state = DEBUG_RX_WAIT_LENGTH_HIGH_BYTE;
+        break;
+
+    case DEBUG_RX_WAIT_LENGTH_HIGH_BYTE:
+        rx_parser.frame[4] = received_byte;
+        rx_parser.payload_length = (uint16_t)(rx_parser.frame[3] | (rx_parser.frame[4] << 8));
+        rx_parser.received_payload_length = 0;
+
+        if(rx_parser.payload_length > DEBUG_ITF_MAX_RX_PAYLOAD_SIZE)
+        {
+            LOG_ERROR(3223); // Request payload is too long
+            debug_itf_queue_reply(message_nack, sizeof(message_nack));
+            rx_parser.skipped_bytes_left = (uint32_t)rx_parser.payload_length + debug_itf_frame_crc_length(frame_crc_mode);
+            rx_parser.state = DEBUG_RX_SKIP_PAYLOAD;
+        }
+        else if(rx_parser.payload_length == 0)
+        {
+            rx_parser.state = DEBUG_RX_WAIT_PREFIX_FIRST_BYTE;
+            debug_complete_rx_frame(5);
+        }
+        else
+        {
+            rx_parser.state = DEBUG_RX_WAIT_PAYLOAD;
+        }
+        break;
+
+    case DEBUG_RX_WAIT_PAYLOAD:
+        rx_parser.frame[5 + rx_parser.received_payload_length] = received_byte;
+        rx_parser.received_payload_length += 1;
+        if(rx_parser.received_payload_length == rx_parser.payload_length)
+        {
+            rx_parser.state = DEBUG_RX_WAIT_PREFIX_FIRST_BYTE;
+            debug_complete_rx_frame(5 + rx_parser.payload_length);
+        }
+        break;
+
+    case DEBUG_RX_SKIP_PAYLOAD:
+        rx_parser.skipped_bytes_left -= 1;
+        if(rx_parser.skipped_bytes_left == 0)
+        {
+            rx_parser.state = DEBUG_RX_WAIT_PREFIX_FIRST_BYTE;
+        }
+        break;
+
+    case DEBUG_RX_WAIT_FRAME_CRC:
+    {
+        rx_parser.frame[rx_parser.frame_length + rx_parser.received_crc_length] = received_byte;
+        rx_parser.received_crc_length += 1;
+
+        const uint8_t crc_mode = frame_crc_mode;
+        const uint8_t crc_length = debug_itf_frame_crc_length(crc_mode);
+        if(rx_parser.received_crc_length < crc_length)
+        {
+            break;
+        }
+
+        rx_parser.state = DEBUG_RX_WAIT_PREFIX_FIRST_BYTE;
+
+        const debug_tx_message frame = { .message = rx_parser.frame, .length = rx_parser.frame_length };
+        const uint32_t expected_crc = debug_itf_frame_crc(crc_mode, &frame, 1);
+        uint32_t received_crc = 0;
+        memcpy(&received_crc, &rx_parser.frame[rx_parser.frame_length], crc_length);
+        if(received_crc != expected_crc)
+        {
+            LOG_ERROR(3227); // Request frame CRC mismatch. Request is not handled
+            debug_itf_queue_reply(message_nack, sizeof(message_nack));
+            break;
+        }
+
+        debug_dispatch_rx_frame(rx_parser.frame_length);
+        break;
+    }
+
+    default:
+        rx_parser.state = DEBUG_RX_WAIT_PREFIX_FIRST_BYTE;
+        break;
+    }
+}
+
+
+#ifdef DEBUG_ITF_COBS_FRAMING
+/**
+ * @brief Decodes a single received COBS byte and feeds decoded bytes into the RX frame parser.
+ *
+ * On 0x00 delimiter the frame must be complete. Otherwise it was broken by a lost or corrupted byte, and the parser starts over,
+ *  so the next frame is parsed correctly.
+ */
+static void debug_decode_cobs_rx_byte( uint8_t received_byte )
+{
+    if(received_byte == 0x00)
+    {
+        if(rx_cobs_decoder.block_bytes_left != 0 || rx_parser.state != DEBUG_RX_WAIT_PREFIX_FIRST_BYTE)
+        {
+            LOG_ERROR(3229); // Broken COBS frame. Partially received request is dropped
+            rx_parser.state = DEBUG_RX_WAIT_PREFIX_FIRST_BYTE;
+        }
+        rx_cobs_decoder.block_bytes_left = 0;
+        rx_cobs_decoder.zero_is_pending = 0; // Last block has no 0x00 at its end
+        return;
+    }
+
+    if(rx_cobs_decoder.block_bytes_left == 0)
+    {
+        // Code byte. It also means that the previous block wasn't the last one, so its 0x00 is real data
+        if(rx_cobs_decoder.zero_is_pending != 0)
+        {
+            debug_parse_rx_byte(0x00);
+        }
+        rx_cobs_decoder.block_bytes_left = received_byte - 1U;
+        rx_cobs_decoder.zero_is_pending = (received_byte != 0xFFU) ? 1U : 0U; // Full block is not followed by 0x00
+        return;
+    }
+
+    rx_cobs_decoder.block_bytes_left -= 1;
+    debug_parse_rx_byte(received_byte);
+}
+#endif /* DEBUG_ITF_COBS_FRAMING */
+
+
+/**
+ * @brief Dispatches the complete frame stored in the parser, or starts waiting for its CRC trailer if frame CRC is used
+ */
+static void debug_complete_rx_frame( uint16_t frame_length )
+{
+    if(frame_crc_mode == DEBUG_ITF_FRAME_CRC_NONE)
+    {
+        debug_dispatch_rx_frame(frame_length);
+        return;
+    }
+
+    rx_parser.frame_length = frame_length;
+    rx_parser.received_crc_length = 0;
+    rx_parser.state = DEBUG_RX_WAIT_FRAME_CRC;
+}
+
+
+/**
+ * @brief Handles the complete frame stored in the parser right away, or queues it for debug_poll() in DEBUG_ITF_RX_DEFERRED_MODE
+ */
+static void debug_dispatch_rx_frame( uint16_t frame_length )
+{
+#ifdef DEBUG_ITF_RX_DEFERRED_MODE
+    const uint8_t write_index = rx_jobs.write_index;
+    if((uint8_t)(write_index - rx_jobs.read_index) == DEBUG_ITF_RX_JOB_QUEUE_LENGTH)
+    {
+        LOG_ERROR(3224); // RX job queue overflow. Request is dropped
+        return;
+    }
+
+    const uint8_t job_index = write_index & (DEBUG_ITF_RX_JOB_QUEUE_LENGTH - 1U);
+    memcpy(rx_jobs.jobs[job_index].frame, rx_parser.frame, frame_length);
+    rx_jobs.jobs[job_index].length = frame_length;
+    rx_jobs.write_index = write_index + 1;
+
+    debug_itf_rx_job_queued_cbk();
+#else
+    debug_handle_rx_request(rx_parser.frame, frame_length);
+#endif
+}
+
+
+/**
+ * @brief Checks a single request and passes it to the handler registered for its code
+ */
+static void debug_handle_rx_request(uint8_t* message, uint32_t message_length)
+{
+	if(message_length <= 2)
+	{
+        LOG_ERROR(3221); // Invalid message length
+        debug_itf_queue_reply(message_nack, sizeof(message_nack));
+        return;
+	}
+
+	if(message[0] != 0xAA || message[1] != 0x55)
+	{
+		LOG_ERROR(3222); // Invalid message prefix. Message is not a part of debug protocol, or buffer doesn't store the beginning of the message.
+        debug_itf_queue_reply(message_nack, sizeof(message_nack));
+        return;
+	}
+
+    debug_itf_request request = { .code = message[2], .payload = (void*)(0), .payload_length = 0, .is_tagged = 0, .tag = 0 };
+    if((request.code & DEBUG_ITF_PAYLOAD_FLAG) != 0)
+    {
+        if(message_length < 5)
+        {
+            LOG_ERROR(3221); // Invalid message length. Payload length is missing
+            debug_itf_queue_reply(message_nack, sizeof(message_nack));
+            return;
+        }
+        request.payload = &message[5];
+        request.payload_length = (uint16_t)(message[3] | (message[4] << 8));
+    }
+    else if(message_length != 3)
+    {
+        return; // One byte request followed by unexpected bytes. Ignored as before
+    }
+
+    debug_itf_dispatch_request(&request);
+}
+
+/**
+ * @brief Passes the request to the handler registered for its code. Unknown requests are ignored
+ */
+static void debug_itf_dispatch_request( const debug_itf_request* request )
+{
+    // Entry is copied, so it can be changed from another context while handler runs
+    const debug_port_critical_state critical_state = debug_port_enter_critical();
+    const debug_itf_command command = command_table[request->code];
+    debug_port_exit_critical(critical_state);
+
+    if(command.handler == (void*)(0))
+    {
+        return; // Unknown request
+    }
+
+    debug_itf_reply_cbk reply = (command.reply_cbk != (void*)(0)) ? command.reply_cbk : debug_itf_queue_reply_message;
+    if(request->is_tagged != 0)
+    {
+        handled_request_tag = request->tag;
+        reply = debug_itf_queue_tagged_reply;
+    }
+
+    command.handler(request, command.context, reply);
+}
+
+/**
+ * @brief Queues the message after a tag header as a single group: 0xAA 0x55 0x8D length_low length_high tag message
+ *
+ * @return 0 if message was queued, error code otherwise
+ */
+static uint16_t debug_itf_queue_tagged_message( DEBUG_ITF_TX_LANE lane_id, uint8_t tag, uint8_t* message, uint32_t message_length )
+{
+    const debug_tx_message tagged_message = { .message = message, .length = message_length };
+    return debug_itf_queue_tagged_messages(lane_id, tag, &tagged_message, 1);
+}
+
+/**
+ * @brief Queues messages after a single tag header as one group, so client receives them as a single tagged reply
+ *
+ * @return 0 if messages were queued, error code otherwise
+ */
+static uint16_t debug_itf_queue_tagged_messages( DEBUG_ITF_TX_LANE lane_id, uint8_t tag, const debug_tx_message messages[],
+        uint8_t messages_count )
+{
+    if(lane_id >= DEBUG_ITF_TX_LANES_COUNT)
+    {
+        LOG_ERROR(4216); // Unknown TX lane
+        return 4216;
+    }
+
+    uint32_t messages_length = 0;
+    for(uint8_t i = 0; i < messages_count; i++)
+    {
+        messages_length += messages[i].length;
+    }
+    if(messages_length > UINT16_MAX - 1U)
+    {
+        LOG_ERROR(4215); // Message is too long for the tag header length field
+        return 4215;
+    }
+
+    const uint8_t header_index = debug_itf_take_pool_buffer(tagged_reply_header_is_used[lane_id], DEBUG_TX_LANE_POOL_LENGTH);
+    if(header_index == DEBUG_TX_LANE_POOL_LENGTH)
+    {
+        LOG_ERROR(4214); // All tag headers of the lane are queued, so lane is full
+        return 4214;
+    }
+
+    uint8_t* header = message_tagged_reply_headers[lane_id][header_index];
+    const uint16_t tagged_length = (uint16_t)(messages_length + 1U);
+    header[0] = 0xAA;
+    header[1] = 0x55;
+    header[2] = DEBUG_ITF_TAGGED_REQUEST_Code;
+    header[3] = (uint8_t)(tagged_length & 0xFFU);
+    header[4] = (uint8_t)(tagged_length >> 8);
+    header[5] = tag;
+
+    // One message is left for frame CRC trailer
+    debug_tx_message tagged_messages[DEBUG_TX_MAX_GROUP_MESSAGES_COUNT - 1U];
+    tagged_messages[0] = (debug_tx_message){ .message = header, .length = sizeof(message_tagged_reply_headers[0][0]),
+            .release_cbk = debug_itf_tagged_reply_header_released };
+    for(uint8_t i = 0; i < messages_count; i++)
+    {
+        tagged_messages[1U + i] = messages[i];
+    }
+
+    const uint16_t queue_error = debug_itf_queue_lane_messages(lane_id, tagged_messages, (uint8_t)(messages_count + 1U));
+    if(queue_error != 0)
+    {
+        debug_itf_tagged_reply_header_released(header);
+    }
+    return queue_error;
+}
+
+/**
+ * @brief Queues request data that is stored in two parts, like a wrapped circular buffer, as a single message of the bulk lane.
+ *  Second part is left out if its length is 0. release_cbk is called with the pointer of the last part when data was sent
+ *
+ * @return 0 if data was queued, error code otherwise
+ */
+static uint16_t debug_itf_queue_request_data_spans( const debug_itf_request* request, uint8_t* first_span, uint32_t first_length,
+        uint8_t* second_span, uint32_t second_length, debug_itf_message_release_cbk release_cbk )
+{
+    debug_tx_message spans[2] =
+    {
+        { .message = first_span, .length = first_length, .release_cbk = release_cbk },
+        { .message = second_span, .length = second_length, .release_cbk = release_cbk },
+    };
+    const uint8_t spans_count = (second_length != 0) ? 2U : 1U;
+    if(spans_count == 2U)
+    {
+        spans[0].release_cbk = (void*)(0);
+    }
+
+    if(request->is_tagged != 0)
+    {
+        return debug_itf_queue_tagged_messages(DEBUG_ITF_TX_LANE_BULK, request->tag, spans, spans_count);
+    }
+    return debug_itf_queue_lane_messages(DEBUG_ITF_TX_LANE_BULK, spans, spans_count);
+}
+
+/**
+ * @brief Releases the read hold of the buffer whose values start at the message. Called inside critical section
+ */
+static void debug_itf_buffer_read_released( uint8_t* message )
+{
+    const debug_com_buffers* buffers = debug_get_com_buffer();
+    for(uint8_t i = 0; i < buffers->next_free_buffer_index; i++)
+    {
+        if(buffers->buffers_values[i] == (void*)message)
+        {
+            debug_get_buffer_state(message, (DEBUG_DATA_TYPE)buffers->buffers_types[i])->read_holds_count -= 1;
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Reply callback of tagged requests. Uses the tag of the request that is being handled
+ */
+static uint16_t debug_itf_queue_tagged_reply( uint8_t* message, uint32_t message_length )
+{
+    return debug_itf_queue_tagged_message(DEBUG_ITF_TX_LANE_CONTROL, handled_request_tag, message, message_length);
+}
+
+/**
+ * @brief Built in command handlers. All of them are registered in command_table
+ */
+static void debug_itf_establish_connection_handler( const debug_itf_request* request, void* context, debug_itf_reply_cbk reply )
+{
+    (void)request;
+    (void)context;
+    debug_connection_is_established = 1;
+    reply(message_ack, sizeof(message_ack));
+}
+
+static void debug_itf_close_connection_handler( const debug_itf_request* request, void* context, debug_itf_reply_cbk reply )
+{
+    (void)request;
+    (void)context;
+    debug_connection_is_established = 0;
+    reply(message_ack, sizeof(message_ack));
+}
+
+static void debug_itf_keep_alive_handler( const debug_itf_request* request, void* context, debug_itf_reply_cbk reply )
+{
+    (void)request;
+    (void)context;
+    if(debug_connection_is_established == 0)
+    {
+        // NACK keep alive if connection wasn't established. Can help to find unintentional MCU reset
+        reply(message_nack, sizeof(message_nack));
+    }
+    else
+    {
+        reply(message_ack, sizeof(message_ack));
+    }
+}
+
+static void debug_itf_read_error_log_handler( const debug_itf_request* request, void* context, debug_itf_reply_cbk reply )
+{
+    (void)context;
+
+    // Write error log depth to bytes 4 and 5 of the error log
+    uint16_t* value_ptr = (uint16_t*)(&message_error_log_properties[3]);
+    *value_ptr = DEBUG_ERROR_LOG_DEPTH;
+
+    message_error_log_properties[5] = DEBUG_ERROR_LOG_VERSION;
+    reply(message_error_log_properties, sizeof(message_error_log_properties));
+
+    // Send error log
+    debug_itf_queue_request_data(request, (uint8_t*)debug_get_error_log_ptr(), sizeof(debug_error_log));
+}
+
+static void debug_itf_read_link_telemetry_handler( const debug_itf_request* request, void* context, debug_itf_reply_cbk reply )
+{
+    (void)request;
+    (void)context;
+
+    debug_itf_link_telemetry telemetry;
+    debug_itf_get_link_telemetry(&telemetry);
+
+    debug_itf_put_u32(&message_link_telemetry[3], telemetry.sent_bytes_count);
+    debug_itf_put_u32(&message_link_telemetry[7], telemetry.sent_messages_count);
+    debug_itf_put_u32(&message_link_telemetry[11], telemetry.high_water_mark);
+    debug_itf_put_u32(&message_link_telemetry[15], telemetry.overflows_count);
+    debug_itf_put_u32(&message_link_telemetry[19], telemetry.busy_cycles_count);
+    debug_itf_put_u32(&message_link_telemetry[23], telemetry.current_cycle);
+    reply(message_link_telemetry, sizeof(message_link_telemetry));
+}
+
+static void debug_itf_read_tx_queue_statistics_handler( const debug_itf_request* request, void* context, debug_itf_reply_cbk reply )
+{
+    (void)request;
+    (void)context;
+
+    message_tx_queue_statistics[3] = DEBUG_ITF_TX_LANES_COUNT;
+#ifdef DEBUG_ITF_TX_RING_MODE
+    message_tx_queue_statistics[4] = 1; // Queue depth is counted in bytes
+#else
+    message_tx_queue_statistics[4] = 0; // Queue depth is counted in messages
+#endif
+    for(uint8_t lane_id = 0; lane_id < DEBUG_ITF_TX_LANES_COUNT; lane_id++)
+    {
+        const debug_tx_lane* lane = &tx_queue.lanes[lane_id];
+        uint8_t* lane_fields = &message_tx_queue_statistics[5 + lane_id * 16];
+
+        debug_itf_put_u32(&lane_fields[0], debug_itf_lane_used_space(lane));
+        debug_itf_put_u32(&lane_fields[4], lane->statistics.high_water_mark);
+        debug_itf_put_u32(&lane_fields[8], lane->statistics.queued_messages_count);
+        debug_itf_put_u32(&lane_fields[12], lane->statistics.overflows_count);
+    }
+    reply(message_tx_queue_statistics, sizeof(message_tx_queue_statistics));
+}
+
+static void debug_itf_read_tx_drop_statistics_handler( const debug_itf_request* request, void* context, debug_itf_reply_cbk reply )
+{
+    (void)request;
+    (void)context;
+
+    message_tx_drop_statistics[3] = DEBUG_ITF_TX_LANES_COUNT;
+    for(uint8_t lane_id = 0; lane_id < DEBUG_ITF_TX_LANES_COUNT; lane_id++)
+    {
+        const debug_tx_lane* lane = &tx_queue.lanes[lane_id];
+        uint8_t* lane_fields = &message_tx_drop_statistics[4 + lane_id * 17];
+
+        lane_fields[0] = lane->drop_policy;
+        debug_itf_put_u32(&lane_fields[1], lane->block_timeout_cycles);
+        debug_itf_put_u32(&lane_fields[5], lane->statistics.dropped_newest_count);
+        debug_itf_put_u32(&lane_fields[9], lane->statistics.dropped_oldest_count);
+        debug_itf_put_u32(&lane_fields[13], lane->statistics.block_timeouts_count);
+    }
+    reply(message_tx_drop_statistics, sizeof(message_tx_drop_statistics));
+}
+
+static void debug_itf_read_buffers_properties_handler( const debug_itf_request* request, void* context, debug_itf_reply_cbk reply )
+{
+    (void)request;
+    (void)context;
+
+    debug_com_buffers* buffers = debug_get_com_buffer();
+    message_buffers_properties[3] = buffers->next_free_buffer_index;
+    uint16_t* value_ptr = (uint16_t*)(&message_buffers_properties[4]);
+    *value_ptr = DEBUG_BUFFER_SIZE; // Number of points in a buffer
+    reply(message_buffers_properties, sizeof(message_buffers_properties));
+    buffers->read_requests_count += 1;
+}
+
+/**
+ * @brief Reads one of available buffers. Registered for all codes after DEBUG_ITF_READ_BUFFERS_PROPERTIES_Code
+ */
+static void debug_itf_read_buffer_handler( const debug_itf_request* request, void* context, debug_itf_reply_cbk reply )
+{
+    (void)context;
+
+    uint8_t requested_index = request->code - DEBUG_ITF_READ_BUFFERS_PROPERTIES_Code - 1;
+    debug_com_buffers* buffers = debug_get_com_buffer();
+    if( requested_index >= buffers->next_free_buffer_index )
+    {
+        reply(message_nack, sizeof(message_nack)); // Buffer isn't registered
+        return;
+    }
+    reply(message_ack, sizeof(message_ack));
+    buffers->read_buffers_mask |= (1UL << requested_index);
+
+    uint8_t buffer_type = buffers->buffers_types[requested_index];
+    uint8_t* buffer_pointer = (uint8_t*)(buffers->buffers_values[requested_index]);
+
+    uint32_t data_size = DEBUG_BUFFER_SIZE;
+
+    message_buffer_description[2] = request->code;
+    message_buffer_description[3] = buffer_type;
+    reply(message_buffer_description, sizeof(message_buffer_description));
+
+    uint32_t value_size = 1;
+    if( buffer_type == F32_Type || buffer_type == I32_Type || buffer_type == U32_Type )
+    {
+        value_size = 4;
+    }
+    else if( buffer_type == I16_Type || buffer_type == U16_Type )
+    {
+        value_size = 2;
+    }
+    data_size *= value_size;
+
+    // Send buffer description first and than buffer itself. Values of a wrapped circular buffer are sent from the oldest one.
+    //  Circular buffer is held until its memory is released, so it isn't overwritten while it is sent in pointer TX mode. Linear
+    //  buffer only writes values after the ones that are sent, so it is not held and recording continues without a gap
+    debug_buffer_state* state = debug_get_buffer_state(buffer_pointer, (DEBUG_DATA_TYPE)buffer_type);
+    if(state == (void*)(0))
+    {
+        return;
+    }
+    debug_port_critical_state critical_state = debug_port_enter_critical();
+    const uint8_t is_held = (state->is_circular != 0) ? 1U : 0U;
+    state->read_holds_count += is_held;
+    const uint32_t oldest_offset = debug_get_buffer_oldest_index(state) * value_size;
+    debug_port_exit_critical(critical_state);
+
+    const uint16_t queue_error = debug_itf_queue_request_data_spans(request, &buffer_pointer[oldest_offset],
+            data_size - oldest_offset, buffer_pointer, oldest_offset, (is_held != 0) ? debug_itf_buffer_read_released : (void*)(0));
+    if(queue_error != 0 && is_held != 0)
+    {
+        critical_state = debug_port_enter_critical();
+        state->read_holds_count -= 1; // Data isn't sent, so it is never released
+        debug_port_exit_critical(critical_state);
+    }
+}
+
+static void debug_itf_start_streaming_handler( const debug_itf_request* request, void* context, debug_itf_reply_cbk reply )
+{
+    (void)request;
+    (void)context;
+
+    reply(message_ack, sizeof(message_ack));
+    debug_com_stream* active_stream = debug_get_active_com_stream();
+    if(active_stream == (void*)(0))
+    {
+        message_stream_properties[3] = 0; // Stream id 0 is forbidden, client should treat it as no stream is registered
+        reply(message_stream_properties, sizeof(message_stream_properties));
+        return;
+    }
+
+    message_stream_properties[3] = active_stream->id;
+    message_stream_properties[4] = active_stream->entry_fields_count;
+
+    uint16_t* u16_value_ptr = (uint16_t*)(&message_stream_properties[5]);
+    *u16_value_ptr = active_stream->entries_per_message_count;
+
+    uint32_t *u32_value_ptr = (uint32_t*)(&message_stream_properties[7]);
+    *u32_value_ptr = active_stream->timeout_ms;
+
+    u16_value_ptr = (uint16_t*)(&message_stream_properties[11]);
+    *u16_value_ptr = active_stream->message_byte_size;
+
+    reply(message_stream_properties, sizeof(message_stream_properties));
+
+    if(active_stream->entry_fields_count >= 3)
+    {
+        reply(active_stream->entry_fields_types, active_stream->entry_fields_count);
+    }
+    else
+    {
+        // Send at least 3 bytes to not brick the DMA interrupt. This situation is supposed to be handled on the client as well
+        reply(active_stream->entry_fields_types, 3);
+    }
+
+    active_stream->is_active = 1;
+}
+
+static void debug_itf_stop_streaming_handler( const debug_itf_request* request, void* context, debug_itf_reply_cbk reply )
+{
+    (void)request;
+    (void)context;
+
+    debug_com_stream* active_stream = debug_get_active_com_stream();
+    active_stream->is_active = 0;
+
+    reply(message_ack, sizeof(message_ack));
+}
+
+/**
+ * @brief Calls one of the 16 generic weak callbacks
+ */
+static void debug_itf_generic_request_handler( const debug_itf_request* request, void* context, debug_itf_reply_cbk reply )
+{
+    (void)context;
+
+    reply(message_ack, sizeof(message_ack));
+    generic_request_callbacks[request->code - DEBUG_ITF_GENERIC_REQUEST_BASE_Code]();
+}
+
+/**
+ * @brief Switches frame CRC after ACK is queued, so ACK still uses the CRC the request was sent with
+ */
+static void debug_itf_set_frame_crc_handler( const debug_itf_request* request, void* context, debug_itf_reply_cbk reply )
+{
+    (void)context;
+
+    if(request->payload_length != 1 || request->payload[0] > DEBUG_ITF_FRAME_CRC_32)
+    {
+        LOG_ERROR(3228); // Unknown frame CRC mode
+        reply(message_nack, sizeof(message_nack));
+        return;
+    }
+
+    reply(message_ack, sizeof(message_ack));
+    debug_itf_set_frame_crc((DEBUG_ITF_FRAME_CRC)request->payload[0]);
+}
+
+/**
+ * @brief Freezes or unfreezes all registered buffers, so circular buffers can be read without being overwritten
+ */
+static void debug_itf_freeze_buffers_handler( const debug_itf_request* request, void* context, debug_itf_reply_cbk reply )
+{
+    (void)context;
+
+    if(request->payload_length != 1 || request->payload[0] > 1)
+    {
+        LOG_ERROR(3231); // Invalid freeze buffers request
+        reply(message_nack, sizeof(message_nack));
+        return;
+    }
+
+    if(request->payload[0] != 0)
+    {
+        debug_freeze_all_com_buffers();
+    }
+    else
+    {
+        debug_unfreeze_all_com_buffers();
+    }
+    reply(message_ack, sizeof(message_ack));
+}
+
+/**
+ * @brief Unwraps the tagged request and dispatches it, so that all its replies get the tag header. Tagged requests can't be nested
+ */
+static void debug_itf_tagged_request_handler( const debug_itf_request* request, void* context, debug_itf_reply_cbk reply )
+{
+    (void)context;
+
+    if(request->payload_length < 2 || request->payload[1] == DEBUG_ITF_TAGGED_REQUEST_Code)
+    {
+        LOG_ERROR(3230); // Invalid tagged request
+        reply(message_nack, sizeof(message_nack));
+        return;
+    }
+
+    debug_itf_request tagged_request =
+    {
+        .code = request->payload[1],
+        .payload = (void*)(0),
+        .payload_length = 0,
+        .is_tagged = 1,
+        .tag = request->payload[0],
+    };
+
+    if((tagged_request.code & DEBUG_ITF_PAYLOAD_FLAG) != 0)
+    {
+        const uint16_t wrapped_payload_length = (request->payload_length >= 4) ?
+                (uint16_t)(request->payload[2] | (request->payload[3] << 8)) : 0;
+        if(request->payload_length < 4 || wrapped_payload_length != request->payload_length - 4U)
+        {
+            LOG_ERROR(3230); // Invalid tagged request. Wrapped payload length doesn't match
+            reply(message_nack, sizeof(message_nack));
+            return;
+        }
+        tagged_request.payload = &request->payload[4];
+        tagged_request.payload_length = wrapped_payload_length;
+    }
+    else if(request->payload_length != 2)
+    {
+        LOG_ERROR(3230); // Invalid tagged request. Request without payload flag is followed by other bytes
+        reply(message_nack, sizeof(message_nack));
+        return;
+    }
+
+    debug_itf_dispatch_request(&tagged_request);
+}
+
+/**
+ * @brief Passes payload of one of the 16 generic parameter requests to the weak callback
+ */
+static void debug_itf_generic_parameter_request_handler( const debug_itf_request* request, void* context, debug_itf_reply_cbk reply )
+{
+    (void)context;
+
+    reply(message_ack, sizeof(message_ack));
+    debug_itf_handle_generic_parameter_request_cbk(request->code - DEBUG_ITF_GENERIC_PARAMETER_REQUEST_BASE_Code,
+            request->payload, request->payload_length);
+}
+
+/**
+ * @brief Selects the lane that must be served next and takes the next transfer from it. Must be called inside critical section.
+ *
+ * @return transfer length, 0 if all lanes are empty. Transfer start is written into transfer_start
+ */
+static uint32_t debug_itf_take_next_transfer( uint8_t** transfer_start, uint32_t max_length )
+{
+    uint32_t transfer_length = 0;
+
+    debug_tx_lane* active_lane = &tx_queue.lanes[tx_queue.active_lane];
+    if(debug_itf_lane_group_is_started(active_lane) != 0)
+    {
+        // Last group of the active lane is not fully sent yet, so another lane can't be sent in the middle of it
+        transfer_length = debug_itf_lane_take(active_lane, transfer_start, max_length);
+    }
+    else
+    {
+        for(uint8_t lane_id = 0; lane_id < DEBUG_ITF_TX_LANES_COUNT; lane_id++)
+        {
+            debug_tx_lane* lane = &tx_queue.lanes[lane_id];
+            if(debug_itf_lane_ready_space(lane) != 0)
+            {
+                tx_queue.active_lane = lane_id;
+#ifdef DEBUG_ITF_TX_RING_MODE
+                // Previous boundary was reached, so all messages queued before it are sent
+                lane->boundary_index = lane->write_index;
+                lane->sent_messages_count = lane->messages_before_boundary;
+                lane->messages_before_boundary = lane->statistics.queued_messages_count;
+#endif
+                transfer_length = debug_itf_lane_take(lane, transfer_start, max_length);
+                break;
+            }
+        }
+    }
+
+    tx_queue.sent_bytes_count += transfer_length;
+    return transfer_length;
+}
+
+/**
+ * @brief Marks TX as busy and starts measuring busy time. Must be called inside critical section.
+ */
+static void debug_itf_set_tx_busy( void )
+{
+    tx_queue.tx_is_busy = 1;
+    tx_queue.busy_start_cycle = debug_itf_get_cycle_count();
+}
+
+/**
+ * @brief Marks TX as idle and adds busy time to telemetry. Must be called inside critical section.
+ */
+static void debug_itf_clear_tx_busy( void )
+{
+    tx_queue.tx_is_busy = 0;
+    tx_queue.busy_cycles_count += debug_itf_get_cycle_count() - tx_queue.busy_start_cycle;
+}
+
+/**
+ * @brief Releases the last taken transfer after transport has sent or copied it. Must be called inside critical section.
+ */
+static void debug_itf_release_in_flight( void )
+{
+#ifdef DEBUG_ITF_TX_RING_MODE
+    tx_queue.lanes[tx_queue.active_lane].read_index += tx_queue.in_flight_length;
+    tx_queue.in_flight_length = 0;
+#else
+    debug_itf_release_request(&tx_queue.in_flight_request);
+    tx_queue.in_flight_request.release_cbk = (void*)(0);
+#endif
+}
+
+#ifdef DEBUG_ITF_TX_RING_MODE
+
+/**
+ * @brief Returns number of bytes queued or reserved in the lane ring
+ */
+static uint32_t debug_itf_lane_used_space( const debug_tx_lane* lane )
+{
+    return lane->reserve_index - lane->read_index;
+}
+
+/**
+ * @brief Returns number of published bytes that can be sent. Reserved bytes that weren't committed yet are not counted
+ */
+static uint32_t debug_itf_lane_ready_space( const debug_tx_lane* lane )
+{
+    return lane->write_index - lane->read_index;
+}
+
+/**
+ * @brief Returns number of messages that were fully taken from the lane ring.
+ *
+ * Ring doesn't store message boundaries, so messages are only counted as sent when the lane boundary is reached.
+ */
+static uint32_t debug_itf_lane_sent_messages_count( const debug_tx_lane* lane )
+{
+    if(lane->read_index == lane->boundary_index)
+    {
+        return lane->messages_before_boundary;
+    }
+
+    return lane->sent_messages_count;
+}
+
+/**
+ * @brief Returns size of the lane ring in bytes
+ */
+static uint32_t debug_itf_lane_total_space( const debug_tx_lane* lane )
+{
+    return lane->size;
+}
+
+/**
+ * @brief Returns number of ring bytes needed to store all messages
+ */
+static uint32_t debug_itf_lane_required_space( const debug_tx_message messages[], uint8_t messages_count )
+{
+#ifdef DEBUG_ITF_COBS_FRAMING
+    return debug_itf_cobs_encoded_length(messages, messages_count);
+#else
+    uint32_t required_space = 0;
+    for(uint8_t i = 0; i < messages_count; i++)
+    {
+        required_space += messages[i].length;
+    }
+    return required_space;
+#endif
+}
+
+#ifdef DEBUG_ITF_COBS_FRAMING
+/**
+ * @brief Returns exact length of all messages COBS encoded as a single frame with its delimiter. Space is reserved before the
+ *  frame is encoded, so it must match debug_itf_lane_write_group() byte for byte
+ */
+static uint32_t debug_itf_cobs_encoded_length( const debug_tx_message messages[], uint8_t messages_count )
+{
+    uint32_t encoded_length = 1; // First code byte
+    uint8_t code = 1;
+    for(uint8_t i = 0; i < messages_count; i++)
+    {
+        const uint8_t* message = messages[i].message;
+        for(uint32_t j = 0; j < messages[i].length; j++)
+        {
+            if(message[j] != 0x00)
+            {
+                encoded_length += 1;
+                code += 1;
+                if(code != 0xFFU)
+                {
+                    continue;
+                }
+            }
+
+            // Block ends with 0x00, or is full, so the next one starts with its own code byte
+            encoded_length += 1;
+            code = 1;
+        }
+    }
+
+    return encoded_length + 1U; // Delimiter
+}
+#endif /* DEBUG_ITF_COBS_FRAMING */
+
+/**
+ * @brief Reserves length bytes at the end of the lane ring. Caller must check that they fit and must commit them with
+ *  debug_itf_lane_commit(). Must be called inside critical section.
+ *
+ * @return Ring index of the reserved space
+ */
+static uint32_t debug_itf_lane_reserve( debug_tx_lane* lane, uint32_t length )
+{
+    const uint32_t reserved_index = lane->reserve_index;
+    lane->reserve_index = reserved_index + length;
+    lane->open_reservations_count += 1;
+    return reserved_index;
+}
+
+#ifndef DEBUG_ITF_COBS_FRAMING
+/**
+ * @brief Copies all messages one after another into space reserved by debug_itf_lane_reserve(). Nothing but the caller writes
+ *  the reserved space and consumer doesn't read it before it is committed, so it is called with interrupts enabled.
+ */
+static void debug_itf_lane_write_group( debug_tx_lane* lane, uint32_t write_index, const debug_tx_message messages[],
+        uint8_t messages_count )
+{
+    for(uint8_t i = 0; i < messages_count; i++)
+    {
+        const uint8_t* message = messages[i].message;
+        const uint32_t message_length = messages[i].length;
+
+        const uint32_t write_offset = write_index & (lane->size - 1U);
+        uint32_t first_part_length = lane->size - write_offset;
+        if(first_part_length > message_length)
+        {
+            first_part_length = message_length;
+        }
+
+        memcpy(&lane->data[write_offset], message, first_part_length);
+        memcpy(&lane->data[0], message + first_part_length, message_length - first_part_length);
+
+        write_index += message_length;
+    }
+}
+
+#else /* DEBUG_ITF_COBS_FRAMING */
+/**
+ * @brief COBS encodes all messages as a single frame into space reserved by debug_itf_lane_reserve() and adds 0x00 delimiter.
+ *  Code byte of every block is written when the block ends, which is possible as reserved space isn't sent before it is
+ *  committed. Like the plain copy, it is called with interrupts enabled.
+ */
+static void debug_itf_lane_write_group( debug_tx_lane* lane, uint32_t write_index, const debug_tx_message messages[],
+        uint8_t messages_count )
+{
+    const uint32_t index_mask = lane->size - 1U;
+    uint32_t code_index = write_index;
+    write_index += 1;
+    uint8_t code = 1;
+
+    for(uint8_t i = 0; i < messages_count; i++)
+    {
+        const uint8_t* message = messages[i].message;
+        for(uint32_t j = 0; j < messages[i].length; j++)
+        {
+            if(message[j] != 0x00)
+            {
+                lane->data[write_index & index_mask] = message[j];
+                write_index += 1;
+                code += 1;
+                if(code != 0xFFU)
+                {
+                    continue;
+                }
+            }
+
+            // Block ends with 0x00, or is full
+            lane->data[code_index & index_mask] = code;
+            code_index = write_index;
+            write_index += 1;
+            code = 1;
+        }
+    }
+
+    lane->data[code_index & index_mask] = code;
+    lane->data[write_index & index_mask] = 0x00;
+}
+#endif /* DEBUG_ITF_COBS_FRAMING */
+
+/**
+ * @brief Commits the reservation the messages were written into and releases them. Bytes of all reservations are published
+ *  when the last open one is committed, as a reservation of a preempted producer can be before them. Must be called inside
+ *  critical section.
+ */
+static void debug_itf_lane_commit( debug_tx_lane* lane, const debug_tx_message messages[], uint8_t messages_count )
+{
+    for(uint8_t i = 0; i < messages_count; i++)
+    {
+        if(messages[i].release_cbk != (void*)(0))
+        {
+            messages[i].release_cbk(messages[i].message);
+        }
+    }
+
+    lane->committed_messages_count += messages_count;
+    lane->open_reservations_count -= 1;
+    if(lane->open_reservations_count == 0)
+    {
+        lane->write_index = lane->reserve_index;
+        lane->statistics.queued_messages_count += lane->committed_messages_count;
+        lane->committed_messages_count = 0;
+    }
+}
+
+/**
+ * @brief Returns 1 if some bytes of the lane were taken, but not all bytes up to the lane boundary. Must be called inside
+ *  critical section.
+ */
+static uint8_t debug_itf_lane_group_is_started( const debug_tx_lane* lane )
+{
+    return (lane->read_index != lane->boundary_index) ? 1U : 0U;
+}
+
+/**
+ * @brief Ring doesn't store message boundaries, so it can't drop a single message. DEBUG_ITF_TX_DROP_OLDEST works as DEBUG_ITF_TX_DROP_NEWEST.
+ *
+ * @return 0, as nothing is dropped
+ */
+static uint8_t debug_itf_lane_drop_oldest( debug_tx_lane* lane )
+{
+    (void)lane;
+    return 0;
+}
+
+/**
+ * @brief Marks the largest contiguous span of queued bytes as in flight. Lane must not be empty. Must be called inside critical section.
+ *
+ * Span ends at the lane boundary, at the end of the ring memory or after max_length bytes. In the last two
+ *  cases the rest is sent by the next call.
+ *
+ * @return span length. Span start is written into transfer_start
+ */
+static uint32_t debug_itf_lane_take( debug_tx_lane* lane, uint8_t** transfer_start, uint32_t max_length )
+{
+    const uint32_t read_index = lane->read_index;
+    const uint32_t read_offset = read_index & (lane->size - 1U);
+
+    uint32_t span_length = lane->boundary_index - read_index;
+    if(span_length > lane->size - read_offset)
+    {
+        span_length = lane->size - read_offset;
+    }
+    if(span_length > max_length)
+    {
+        span_length = max_length;
+    }
+
+    tx_queue.in_flight_length = span_length;
+    *transfer_start = &lane->data[read_offset];
+
+    return span_length;
+}
+
+#else /* DEBUG_ITF_TX_RING_MODE */
+
+/**
+ * @brief Returns number of messages queued in the lane
+ */
+static uint32_t debug_itf_lane_used_space( const debug_tx_lane* lane )
+{
+    return lane->active_queue_size;
+}
+
+/**
+ * @brief Returns number of messages that can be sent. All queued messages can, as they are queued whole inside critical section
+ */
+static uint32_t debug_itf_lane_ready_space( const debug_tx_lane* lane )
+{
+    return lane->active_queue_size;
+}
+
+/**
+ * @brief Returns number of messages that were fully taken from the lane queue. Dropped messages are not counted.
+ */
+static uint32_t debug_itf_lane_sent_messages_count( const debug_tx_lane* lane )
+{
+    return lane->statistics.queued_messages_count - lane->statistics.dropped_oldest_count - lane->active_queue_size;
+}
+
+/**
+ * @brief Returns max number of messages in the lane queue
+ */
+static uint32_t debug_itf_lane_total_space( const debug_tx_lane* lane )
+{
+    return lane->capacity;
+}
+
+/**
+ * @brief Returns number of queue slots needed to store all messages
+ */
+static uint32_t debug_itf_lane_required_space( const debug_tx_message messages[], uint8_t messages_count )
+{
+    (void)messages;
+    return messages_count;
+}
+
+/**
+ * @brief Adds pointers of all messages to the lane queue as a single group. Caller must check that they fit.
+ *  Must be called inside critical section.
+ */
+static void debug_itf_lane_push_group( debug_tx_lane* lane, const debug_tx_message messages[], uint8_t messages_count )
+{
+    for(uint8_t i = 0; i < messages_count; i++)
+    {
+        debug_tx_request* request = &lane->requests[lane->write_index];
+        request->length = messages[i].length;
+        request->message = messages[i].message;
+        request->message_start = messages[i].message;
+        request->release_cbk = messages[i].release_cbk;
+        request->group_messages_left = (uint8_t)(messages_count - i);
+        request->is_group_start = (i == 0) ? 1U : 0U;
+
+        lane->active_queue_size += 1;
+        lane->write_index += 1;
+        if(lane->write_index == lane->capacity)
+        {
+            lane->write_index = 0;
+        }
+    }
+
+    lane->statistics.queued_messages_count += messages_count;
+}
+
+/**
+ * @brief Returns 1 if some of the head group messages were taken, or the head message was partially sent. Rest of such
+ *  group must be sent before anything else. Must be called inside critical section.
+ */
+static uint8_t debug_itf_lane_group_is_started( const debug_tx_lane* lane )
+{
+    if(lane->head_is_partially_sent != 0)
+    {
+        return 1;
+    }
+    return (lane->active_queue_size != 0 && lane->requests[lane->read_index].is_group_start == 0) ? 1U : 0U;
+}
+
+/**
+ * @brief Drops the oldest group that wasn't started yet. Rest of the group that is being sent is kept in front of the queue,
+ *  so a header is never sent without its data, or data without its trailer. Must be called inside critical section.
+ *
+ * @return Number of dropped messages, 0 if there is nothing to drop
+ */
+static uint8_t debug_itf_lane_drop_oldest( debug_tx_lane* lane )
+{
+    const uint32_t read_index = lane->read_index;
+    const uint32_t kept_count = (debug_itf_lane_group_is_started(lane) != 0) ? lane->requests[read_index].group_messages_left : 0U;
+    if(lane->active_queue_size <= kept_count)
+    {
+        return 0;
+    }
+
+    const uint32_t dropped_start_index = (read_index + kept_count) % lane->capacity;
+    const uint8_t dropped_count = lane->requests[dropped_start_index].group_messages_left;
+    for(uint32_t i = 0; i < dropped_count; i++)
+    {
+        debug_itf_release_request(&lane->requests[(dropped_start_index + i) % lane->capacity]);
+    }
+
+    // Kept messages are moved to the end of the dropped group, so the queue stays contiguous
+    for(uint32_t i = kept_count; i > 0; i--)
+    {
+        lane->requests[(read_index + i - 1U + dropped_count) % lane->capacity] =
+                lane->requests[(read_index + i - 1U) % lane->capacity];
+    }
+
+    lane->read_index = (uint16_t)((read_index + dropped_count) % lane->capacity);
+    lane->active_queue_size -= dropped_count;
+    return dropped_count;
+}
+
+/**
+ * @brief Removes next message from the lane queue. Consecutive short messages are copied into the staging buffer
+ *  and taken as a single transfer. Lane must not be empty. Must be called inside critical section.
+ *
+ * Messages longer than max_length are taken one chunk at a time. Message stays in the queue
+ *  until its last chunk is taken.
+ *
+ * @return transfer length. Transfer start is written into transfer_start
+ */
+static uint32_t debug_itf_lane_take( debug_tx_lane* lane, uint8_t** transfer_start, uint32_t max_length )
+{
+    uint32_t read_index = lane->read_index;
+    uint32_t next_read_index = (read_index + 1 == lane->capacity) ? 0 : read_index + 1;
+
+    debug_tx_request* head_request = &lane->requests[read_index];
+    const uint32_t first_length = head_request->length;
+    const uint32_t second_length = lane->requests[next_read_index].length;
+
+    if(first_length > max_length)
+    {
+        *transfer_start = head_request->message;
+
+        head_request->message += max_length;
+        head_request->length -= max_length;
+        lane->head_is_partially_sent = 1;
+        return max_length;
+    }
+    lane->head_is_partially_sent = 0;
+
+    const uint32_t staging_length = (max_length < DEBUG_ITF_TX_STAGING_SIZE) ? max_length : DEBUG_ITF_TX_STAGING_SIZE;
+
+    if(lane->active_queue_size < 2 || first_length > DEBUG_ITF_TX_COALESCE_THRESHOLD || second_length > DEBUG_ITF_TX_COALESCE_THRESHOLD
+            || first_length + second_length > staging_length)
+    {
+        // Nothing to coalesce, send message from its own memory. It is released when transport is done with it
+        *transfer_start = head_request->message;
+        tx_queue.in_flight_request = *head_request;
+
+        lane->read_index = next_read_index;
+        lane->active_queue_size -= 1;
+        return first_length;
+    }
+
+    uint32_t staged_length = 0;
+    while(lane->active_queue_size > 0)
+    {
+        const debug_tx_request* request = &lane->requests[read_index];
+        if(request->length > DEBUG_ITF_TX_COALESCE_THRESHOLD || staged_length + request->length > staging_length)
+        {
+            break;
+        }
+
+        memcpy(&tx_staging_buffer[staged_length], request->message, request->length);
+        staged_length += request->length;
+        debug_itf_release_request(request);
+
+        read_index += 1;
+        if ( read_index == lane->capacity )
+        {
+            read_index = 0;
+        }
+
+        lane->read_index = read_index;
+        lane->active_queue_size -= 1;
+    }
+
+    *transfer_start = tx_staging_buffer;
+    return staged_length;
+}
+
+/**
+ * @brief Calls release callback of the request if it has one
+ */
+static void debug_itf_release_request( const debug_tx_request* request )
+{
+    if(request->release_cbk != (void*)(0))
+    {
+        request->release_cbk(request->message_start);
+    }
+}
+
+#endif /* DEBUG_ITF_TX_RING_MODE */
+
+/**
+ * @brief Takes a free buffer of a small buffers pool. It is given back by the release callback of the message queued in it
+ *
+ * @return Index of the taken buffer, buffers_count if all of them are used
+ */
+static uint8_t debug_itf_take_pool_buffer( volatile uint8_t* buffer_is_used, uint8_t buffers_count )
+{
+    const debug_port_critical_state critical_state = debug_port_enter_critical();
+    uint8_t buffer_index = 0;
+    while(buffer_index < buffers_count && buffer_is_used[buffer_index] != 0)
+    {
+        buffer_index += 1;
+    }
+    if(buffer_index < buffers_count)
+    {
+        buffer_is_used[buffer_index] = 1;
+    }
+    debug_port_exit_critical(critical_state);
+
+    return buffer_index;
+}
+
+static void debug_itf_payload_reply_header_released( uint8_t* message )
+{
+    payload_reply_header_is_used[(message - &message_payload_reply_headers[0][0]) / sizeof(message_payload_reply_headers[0])] = 0;
+}
+
+static void debug_itf_tagged_reply_header_released( uint8_t* message )
+{
+    const uint32_t header_index = (uint32_t)((message - &message_tagged_reply_headers[0][0][0]) / sizeof(message_tagged_reply_headers[0][0]));
+    tagged_reply_header_is_used[header_index / DEBUG_TX_LANE_POOL_LENGTH][header_index % DEBUG_TX_LANE_POOL_LENGTH] = 0;
+}
+
+static void debug_itf_frame_crc_trailer_released( uint8_t* message )
+{
+    const uint32_t trailer_index = (uint32_t)((message - &tx_frame_crc_trailers[0][0][0]) / sizeof(tx_frame_crc_trailers[0][0]));
+    tx_frame_crc_trailer_is_used[trailer_index / DEBUG_TX_LANE_POOL_LENGTH][trailer_index % DEBUG_TX_LANE_POOL_LENGTH] = 0;
+}
+
+/**
+ * @brief Writes u32 value into a message in little endian byte order. Target doesn't need to be aligned
+ */
+static void debug_itf_put_u32( uint8_t* target, uint32_t value )
+{
+    memcpy(target, &value, sizeof(value));
+}
+
+/**
+ * @brief Returns number of trailer bytes used by DEBUG_ITF_FRAME_CRC mode
+ */
+static uint8_t debug_itf_frame_crc_length( uint8_t mode )
+{
+    switch(mode)
+    {
+    case DEBUG_ITF_FRAME_CRC_16: return 2;
+    case DEBUG_ITF_FRAME_CRC_32: return 4;
+    default: return 0;
+    }
+}
+
+/**
+ * @brief Calculates frame CRC over all messages, as if they were a single frame
+ */
+static uint32_t debug_itf_frame_crc( uint8_t mode, const debug_tx_message messages[], uint8_t messages_count )
+{
+    if(mode == DEBUG_ITF_FRAME_CRC_16)
+    {
+        uint16_t crc = DEBUG_CRC16_INIT;
+        for(uint8_t i = 0; i < messages_count; i++)
+        {
+            crc = debug_crc16_update(crc, messages[i].message, messages[i].length);
+        }
+        return crc;
+    }
+
+    uint32_t crc = DEBUG_CRC32_INIT;
+    for(uint8_t i = 0; i < messages_count; i++)
+    {
+        crc = debug_crc32_update(crc, messages[i].message, messages[i].length);
+    }
+    return crc ^ DEBUG_CRC32_FINAL_XOR;
+}
+
+/**
+ * @brief Writes CRC of the messages into a free trailer of the lane, to be queued after them. Trailer is given back by its
+ *  release callback
+ *
+ * @return 1 if trailer_message was filled in, 0 if all trailers of the lane are used
+ */
+static uint8_t debug_itf_make_frame_crc_trailer( DEBUG_ITF_TX_LANE lane_id, uint8_t mode, const debug_tx_message messages[],
+        uint8_t messages_count, debug_tx_message* trailer_message )
+{
+    trailer_message->message = (void*)(0);
+    const uint8_t trailer_index = debug_itf_take_pool_buffer(tx_frame_crc_trailer_is_used[lane_id], DEBUG_TX_LANE_POOL_LENGTH);
+    if(trailer_index == DEBUG_TX_LANE_POOL_LENGTH)
+    {
+        return 0;
+    }
+
+    uint8_t* trailer = tx_frame_crc_trailers[lane_id][trailer_index];
+    debug_itf_put_u32(trailer, debug_itf_frame_crc(mode, messages, messages_count)); // Little endian, so CRC-16 is in the first 2 bytes
+
+    trailer_message->message = trailer;
+    trailer_message->length = debug_itf_frame_crc_length(mode);
+    trailer_message->release_cbk = debug_itf_frame_crc_trailer_released;
+    return 1;
+}
+
+
+// Weak empty definitions for all generic requests. All these functions are intended to be redefined in application code
+__attribute__((weak)) void debug_itf_handle_generic_request_1_cbk( void ) {}
 __attribute__((weak)) void debug_itf_handle_generic_request_2_cbk( void ) {}
 __attribute__((weak)) void debug_itf_handle_generic_request_3_cbk( void ) {}
 __attribute__((weak)) void debug_itf_handle_generic_request_4_cbk( void ) {}
@@ -367,4 +2429,17 @@ __attribute__((weak)) void debug_itf_handle_generic_request_14_cbk( void ) {}
 __attribute__((weak)) void debug_itf_handle_generic_request_15_cbk( void ) {}
 __attribute__((weak)) void debug_itf_handle_generic_request_16_cbk( void ) {}
 
+// Weak empty definition of the hook called from RX interrupt when a request is queued in DEBUG_ITF_RX_DEFERRED_MODE.
+//  Can be redefined to pend a low priority interrupt (like PendSV) that calls debug_poll()
+__attribute__((weak)) void debug_itf_rx_job_queued_cbk( void ) {}
+
+// Weak empty definition for generic requests with payload. Selector is the request number from 0 to 15. Payload is only valid
+//  until the function returns. Reply with payload can be sent using debug_itf_queue_payload_reply()
+__attribute__((weak)) void debug_itf_handle_generic_parameter_request_cbk( uint8_t selector, const uint8_t* payload, uint16_t payload_length )
+{
+    (void)selector;
+    (void)payload;
+    (void)payload_length;
+}
+
 
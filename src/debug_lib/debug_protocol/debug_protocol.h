@@ -6,6 +6,13 @@
 
 #include <stdint.h>
 
+// Include only if file is available. It can overwrite file configuration definitions
+#if defined __has_include
+    #if __has_include( <device_definitions.h> )
+        #include "device_definitions.h"
+    #endif
+#endif
+
 /**************************************************************************************************/
 /*                                                                                                */
 /*                                      File configuration                                        */
@@ -17,7 +24,75 @@
 //  So we have can have DEBUG_ITF_TX_QUEUE_LENGTH number of messages in the queue and 1 more being currently transmitted.
 // 	Therefore if we only make a single request when UART doesn't send anything, this request will get directly into DMA
 //	without being added to the queue, as there is no practical need to do that.
-#define DEBUG_ITF_TX_QUEUE_LENGTH               (6U)
+#ifndef DEBUG_ITF_TX_QUEUE_LENGTH
+    #define DEBUG_ITF_TX_QUEUE_LENGTH           (6U)
+#endif
+
+// Same as DEBUG_ITF_TX_QUEUE_LENGTH, but for control lane. Control lane is used for short replies (ACK, NACK, descriptions),
+//  that are always sent before any bulk data that waits in the queue.
+#ifndef DEBUG_ITF_TX_CONTROL_QUEUE_LENGTH
+    #define DEBUG_ITF_TX_CONTROL_QUEUE_LENGTH   (6U)
+#endif
+
+// Max number of bytes that can be given to the transport with a single send() call. Longer messages are split into
+//  chunks of this size and sent one after another without anything in between. Default value is set for DMA channels with 16 bit counter.
+#ifndef DEBUG_ITF_MAX_TRANSFER_SIZE
+    #define DEBUG_ITF_MAX_TRANSFER_SIZE         (UINT16_MAX)
+#endif
+
+// Consecutive queued messages that are not longer than DEBUG_ITF_TX_COALESCE_THRESHOLD bytes are copied into a staging buffer
+//  of DEBUG_ITF_TX_STAGING_SIZE bytes and sent as a single transfer. Set threshold to 0 to disable coalescing.
+//  Not used in DEBUG_ITF_TX_RING_MODE, as the ring always sends all queued bytes it can as a single transfer.
+#ifndef DEBUG_ITF_TX_COALESCE_THRESHOLD
+    #define DEBUG_ITF_TX_COALESCE_THRESHOLD     (16U)
+#endif
+#ifndef DEBUG_ITF_TX_STAGING_SIZE
+    #define DEBUG_ITF_TX_STAGING_SIZE           (64U)
+#endif
+
+// Define DEBUG_ITF_TX_RING_MODE to switch TX path from the (pointer, length) queue to a copy-in byte ring.
+//  In this mode every queued message is copied into the ring right away, so the caller can reuse its message memory
+//  as soon as debug_itf_queue_message() returns. Messages longer than DEBUG_ITF_TX_RING_SIZE can't be sent in this mode, so
+//  the bulk ring must hold a whole debug buffer, which is checked at compile time in debug_utils.h. Interrupts are only disabled
+//  to reserve ring space and to publish it, the copy itself is done with interrupts enabled.
+//#define DEBUG_ITF_TX_RING_MODE
+#ifndef DEBUG_ITF_TX_RING_SIZE
+    #define DEBUG_ITF_TX_RING_SIZE              (1024U) // Must be a power of two
+#endif
+#ifndef DEBUG_ITF_TX_CONTROL_RING_SIZE
+    #define DEBUG_ITF_TX_CONTROL_RING_SIZE      (128U) // Must be a power of two
+#endif
+
+// Define DEBUG_ITF_COBS_FRAMING to send and receive every frame COBS encoded and followed by 0x00 delimiter. Frame is a group of
+//  messages queued with a single call (with its CRC trailer, if used), or a single request. A lost or corrupted byte then only
+//  breaks its own frame, and both sides continue from the next delimiter without waiting for a timeout. Encoding adds 1 byte per
+//  254 bytes plus code and delimiter bytes. Requires DEBUG_ITF_TX_RING_MODE, as frames are encoded while they are copied into
+//  the ring. Client must use COBS framing too.
+//#define DEBUG_ITF_COBS_FRAMING
+
+// Max number of payload bytes in a single request with payload. Tied to the transport RX buffer, so that the whole request
+//  always fits into it. Longer requests are rejected with NACK.
+#ifndef DEBUG_ITF_MAX_RX_PAYLOAD_SIZE
+    #ifdef DEBUG_UART_BUFFER_SIZE
+        #define DEBUG_ITF_MAX_RX_PAYLOAD_SIZE   (DEBUG_UART_BUFFER_SIZE - 5U)
+    #else
+        #define DEBUG_ITF_MAX_RX_PAYLOAD_SIZE   (59U)
+    #endif
+#endif
+
+// Frame CRC used right after start up: 0 - no trailers, 1 - CRC-16, 2 - CRC-32 (values of DEBUG_ITF_FRAME_CRC). Can be changed
+//  at runtime with debug_itf_set_frame_crc() or DEBUG_ITF_SET_FRAME_CRC_Code request. Client must be configured the same way
+#ifndef DEBUG_ITF_FRAME_CRC_DEFAULT_MODE
+    #define DEBUG_ITF_FRAME_CRC_DEFAULT_MODE        (0U)
+#endif
+
+// Define DEBUG_ITF_RX_DEFERRED_MODE to handle requests outside of the RX interrupt. debug_handle_rx() then only parses frames
+//  and copies complete ones into a queue of DEBUG_ITF_RX_JOB_QUEUE_LENGTH frames. Requests (including generic callbacks) are
+//  handled by debug_poll(), that must be called from a low priority context: main loop, or PendSV pended by
+//  debug_itf_rx_job_queued_cbk(). Requests received while the queue is full are dropped without a reply.
+#ifndef DEBUG_ITF_RX_JOB_QUEUE_LENGTH
+    #define DEBUG_ITF_RX_JOB_QUEUE_LENGTH       (4U) // Must be a power of two and not bigger than 128
+#endif
 
 /**************************************************************************************************/
 /*                                                                                                */
@@ -30,6 +105,19 @@
 #define DEBUG_ITF_KEEP_ALIVE_Code               (0x03U)
 
 #define DEBUG_ITF_READ_ERROR_LOG_Code           (0x08U)
+#define DEBUG_ITF_READ_LINK_TELEMETRY_Code      (0x09U)
+
+#define DEBUG_ITF_READ_TX_QUEUE_STATISTICS_Code (0x0AU)
+#define DEBUG_ITF_READ_TX_DROP_STATISTICS_Code  (0x0BU)
+// Repeats the last DEBUG_ITF_SCATTER_READ_Code request with the same descriptors. Replied with
+//  DEBUG_ITF_REPEAT_SCATTER_READ_REPLY_Code and payload that holds content of all ranges, like DEBUG_ITF_SCATTER_READ_Code reply.
+//  Handled by debug_memory module
+#define DEBUG_ITF_REPEAT_SCATTER_READ_Code      (0x0CU)
+// Stops the trigger. Replied with ACK. Handled by debug_trigger module
+#define DEBUG_ITF_TRIGGER_DISARM_Code           (0x0DU)
+// Replied with 0xAA 0x55 0x0E, u8 - DEBUG_TRIGGER_STATE, u16 - post trigger samples, u32 - captures count. Handled by
+//  debug_trigger module
+#define DEBUG_ITF_TRIGGER_STATUS_Code           (0x0EU)
 
 #define DEBUG_ITF_READ_BUFFERS_PROPERTIES_Code  (0x10U)
 
@@ -39,6 +127,116 @@
 
 #define DEBUG_ITF_GENERIC_REQUEST_BASE_Code     (0x40U)
 
+// Requests with this bit set in the code are followed by u16 payload length (little endian) and the payload itself:
+//  0xAA 0x55 code length_low length_high payload. Replies with payload use the same format.
+#define DEBUG_ITF_PAYLOAD_FLAG                  (0x80U)
+
+#define DEBUG_ITF_SET_FRAME_CRC_Code            (0x8CU) // Payload: u8 - DEBUG_ITF_FRAME_CRC
+// Payload: u8 - tag, then the wrapped request without prefix: code and, for codes with payload flag, length and payload.
+//  Every reply to the wrapped request is sent as a reply with the same code: 0xAA 0x55 0x8D length_low length_high tag reply,
+//  so client can keep several requests in flight and match replies to them by tag.
+#define DEBUG_ITF_TAGGED_REQUEST_Code           (0x8DU)
+// Payload: u32 - address, u16 - length. Replied with payload that holds memory content. Handled by debug_memory module
+#define DEBUG_ITF_PEEK_MEMORY_Code              (0x8EU)
+// Payload: u32 - address, data to write. Replied with ACK. Handled by debug_memory module
+#define DEBUG_ITF_POKE_MEMORY_Code              (0x8FU)
+// Payload: u16 - sample divider, u16 - entries per message, then u32 - address and u8 - data type of every entry. Replied with
+//  ACK. Watch list is registered as the active stream. Handled by debug_watch module
+#define DEBUG_ITF_SET_WATCH_LIST_Code           (0x90U)
+// Payload: u32 - address and u16 - length of every descriptor. Replied with payload that holds content of all ranges one after
+//  another. Descriptors are kept for DEBUG_ITF_REPEAT_SCATTER_READ_Code. Handled by debug_memory module
+#define DEBUG_ITF_SCATTER_READ_Code             (0x91U)
+// Payload: u8 - DEBUG_MEMORY_SNAPSHOT_MODE, then optional scatter read descriptors that replace the kept ones. Replied with payload:
+//  u32 - capture cycles, u32 - max capture cycles, content of all kept ranges copied in a single critical section.
+//  Handled by debug_memory module
+#define DEBUG_ITF_SNAPSHOT_Code                 (0x92U)
+// Payload: u8 - 1 to freeze all registered buffers, 0 to unfreeze them. Replied with ACK
+#define DEBUG_ITF_FREEZE_BUFFERS_Code           (0x93U)
+// Payload: u8 - buffer index, u8 - DEBUG_TRIGGER_CONDITION, u8 - DEBUG_TRIGGER_MODE, u16 - post trigger samples, u32 - level,
+//  u32 - upper level. Replied with ACK. Handled by debug_trigger module
+#define DEBUG_ITF_TRIGGER_ARM_Code              (0x94U)
+// Reply only code. Reply to DEBUG_ITF_REPEAT_SCATTER_READ_Code carries payload, so it gets its own code with payload flag
+#define DEBUG_ITF_REPEAT_SCATTER_READ_REPLY_Code (0x95U)
+
+#define DEBUG_ITF_GENERIC_PARAMETER_REQUEST_BASE_Code (0xC0U)
+
+
+/**************************************************************************************************/
+/*                                                                                                */
+/*                                     Global types declarations                                  */
+/*                                                                                                */
+/**************************************************************************************************/
+
+// TX priority lanes. Lower value is served first. A lane is only switched between messages, never in the middle of one.
+typedef enum DEBUG_ITF_TX_LANE
+{
+    DEBUG_ITF_TX_LANE_CONTROL = 0,
+    DEBUG_ITF_TX_LANE_BULK = 1,
+    DEBUG_ITF_TX_LANES_COUNT = 2,
+}DEBUG_ITF_TX_LANE;
+
+// What lane does with a new message when it is full. Default policy of all lanes is DEBUG_ITF_TX_DROP_NEWEST
+typedef enum DEBUG_ITF_TX_DROP_POLICY
+{
+    DEBUG_ITF_TX_DROP_NEWEST = 0, // New message is not queued
+    DEBUG_ITF_TX_DROP_OLDEST = 1, // Oldest groups of messages that weren't started are dropped whole until new one fits. Works
+                                  //  as DEBUG_ITF_TX_DROP_NEWEST in DEBUG_ITF_TX_RING_MODE, as ring doesn't store message boundaries
+    DEBUG_ITF_TX_BLOCK = 2, // Caller waits until TX frees enough space or timeout elapses. Requires get_cycle_count() in transport
+}DEBUG_ITF_TX_DROP_POLICY;
+
+// Optional trailer sent after every frame in both directions. Device appends it to every group of messages queued with a single
+//  call (like stream header and data) and checks it after every request. Trailer is little endian and covers the whole frame
+//  starting from 0xAA 0x55 prefix. Requests with wrong CRC are answered with NACK.
+typedef enum DEBUG_ITF_FRAME_CRC
+{
+    DEBUG_ITF_FRAME_CRC_NONE = 0,
+    DEBUG_ITF_FRAME_CRC_16 = 1, // CRC-16/CCITT-FALSE, 2 bytes
+    DEBUG_ITF_FRAME_CRC_32 = 2, // CRC-32 (IEEE 802.3), 4 bytes
+}DEBUG_ITF_FRAME_CRC;
+
+// Called when debug interface doesn't need memory of a queued message any longer, so its owner can reuse it. Message is the
+//  pointer that was queued. Called inside critical section, so it must be short and must not queue new messages.
+typedef void (*debug_itf_message_release_cbk)( uint8_t* message );
+
+// Usage statistics of a single TX lane. Queue depth is counted in messages, or in bytes in DEBUG_ITF_TX_RING_MODE
+typedef struct debug_itf_tx_lane_statistics
+{
+    uint32_t high_water_mark; // Max queue depth since start up
+    uint32_t queued_messages_count; // Number of messages accepted by the lane
+    uint32_t overflows_count; // Number of times lane was full when message was queued
+    uint32_t dropped_newest_count; // Number of new messages that were not queued
+    uint32_t dropped_oldest_count; // Number of queued messages dropped to free space for new ones
+    uint32_t block_timeouts_count; // Number of new messages that were not queued after blocking for the whole timeout
+} debug_itf_tx_lane_statistics;
+
+// Counters of the whole TX link. All values are free running and wrap around, so they must be used as differences between two reads
+typedef struct debug_itf_link_telemetry
+{
+    uint32_t sent_bytes_count; // Bytes handed over to transport
+    uint32_t sent_messages_count; // Messages that were fully handed over to transport
+    uint32_t high_water_mark; // Max depth of all lanes
+    uint32_t overflows_count; // Sum of overflows of all lanes
+    uint32_t busy_cycles_count; // Transport cycles TX was busy. 0 if transport has no get_cycle_count()
+    uint32_t current_cycle; // Transport cycle count when telemetry was read
+} debug_itf_link_telemetry;
+
+// Request handed over to a command handler. Payload is only present in requests with DEBUG_ITF_PAYLOAD_FLAG set in the code
+typedef struct debug_itf_request
+{
+    uint8_t code;
+    const uint8_t* payload; // Null pointer for requests without payload. Valid only until handler returns
+    uint16_t payload_length;
+    uint8_t is_tagged; // Request was wrapped into DEBUG_ITF_TAGGED_REQUEST_Code. Replies get the tag header
+    uint8_t tag;
+} debug_itf_request;
+
+// Queues a reply to a request. Returns 0 if reply was queued, or error code. debug_itf_queue_reply_message() is used by default.
+//  Replies to tagged requests are always queued into the control lane with the tag header, so registered callback isn't used for them
+typedef uint16_t (*debug_itf_reply_cbk)( uint8_t* message, uint32_t message_length );
+
+// Handles a request registered with debug_itf_register_command(). Context and reply are the ones given on registration.
+//  Called from the RX interrupt, or from debug_poll() in DEBUG_ITF_RX_DEFERRED_MODE
+typedef void (*debug_itf_command_handler)( const debug_itf_request* request, void* context, debug_itf_reply_cbk reply );
 
 /**************************************************************************************************/
 /*                                                                                                */
@@ -46,8 +244,28 @@
 /*                                                                                                */
 /**************************************************************************************************/
 
-void debug_itf_queue_message(uint8_t* message, uint32_t message_length);
+uint16_t debug_itf_queue_message(uint8_t* message, uint32_t message_length);
+uint16_t debug_itf_queue_lane_message(DEBUG_ITF_TX_LANE lane_id, uint8_t* message, uint32_t message_length);
+uint16_t debug_itf_queue_lane_owned_message( DEBUG_ITF_TX_LANE lane_id, uint8_t* message, uint32_t message_length,
+        debug_itf_message_release_cbk release_cbk );
+uint16_t debug_itf_set_tx_lane_drop_policy( DEBUG_ITF_TX_LANE lane_id, DEBUG_ITF_TX_DROP_POLICY policy, uint32_t block_timeout_cycles );
 void debug_itf_update_message_queue( void );
+uint32_t debug_itf_pull_tx_data( uint8_t* target, uint32_t max_length );
+
+const debug_itf_tx_lane_statistics* debug_itf_get_tx_lane_statistics( DEBUG_ITF_TX_LANE lane_id );
+void debug_itf_get_link_telemetry( debug_itf_link_telemetry* telemetry );
+uint32_t debug_itf_get_cycle_count( void );
+uint16_t debug_itf_queue_payload_reply( uint8_t code, uint8_t* payload, uint16_t payload_length );
+uint16_t debug_itf_queue_reply_message( uint8_t* message, uint32_t message_length );
+uint16_t debug_itf_queue_request_reply( const debug_itf_request* request, uint8_t* message, uint32_t message_length );
+uint16_t debug_itf_queue_request_owned_reply( const debug_itf_request* request, uint8_t* message, uint32_t message_length,
+        debug_itf_message_release_cbk release_cbk );
+uint16_t debug_itf_queue_request_data( const debug_itf_request* request, uint8_t* message, uint32_t message_length );
+
+uint16_t debug_itf_set_frame_crc( DEBUG_ITF_FRAME_CRC mode );
+
+uint16_t debug_itf_register_command( uint8_t code, debug_itf_command_handler handler, void* context, debug_itf_reply_cbk reply_cbk );
+void debug_itf_unregister_command( uint8_t code );
 
 void debug_itf_handle_generic_request_1_cbk( void );
 void debug_itf_handle_generic_request_2_cbk( void );
@@ -66,6 +284,48 @@ void debug_itf_handle_generic_request_14_cbk( void );
 void debug_itf_handle_generic_request_15_cbk( void );
 void debug_itf_handle_generic_request_16_cbk( void );
 
+void debug_itf_handle_generic_parameter_request_cbk( uint8_t selector, const uint8_t* payload, uint16_t payload_length );
+
+void debug_itf_rx_job_queued_cbk( void );
+
+/**************************************************************************************************/
+/*                                                                                                */
+/*                                      Static error handing                                      */
+/*                                                                                                */
+/**************************************************************************************************/
+
+#if (DEBUG_ITF_TX_RING_SIZE & (DEBUG_ITF_TX_RING_SIZE - 1U)) != 0 || DEBUG_ITF_TX_RING_SIZE < 4
+    #error "DEBUG_ITF_TX_RING_SIZE must be a power of two and >= 4. Change DEBUG_ITF_TX_RING_SIZE value accordingly"
+#endif
+
+#if (DEBUG_ITF_TX_CONTROL_RING_SIZE & (DEBUG_ITF_TX_CONTROL_RING_SIZE - 1U)) != 0 || DEBUG_ITF_TX_CONTROL_RING_SIZE < 4
+    #error "DEBUG_ITF_TX_CONTROL_RING_SIZE must be a power of two and >= 4. Change DEBUG_ITF_TX_CONTROL_RING_SIZE value accordingly"
+#endif
+
+#if DEBUG_ITF_MAX_TRANSFER_SIZE < DEBUG_ITF_TX_STAGING_SIZE
+    #error "DEBUG_ITF_MAX_TRANSFER_SIZE must not be smaller than DEBUG_ITF_TX_STAGING_SIZE"
+#endif
+
+#if DEBUG_ITF_MAX_RX_PAYLOAD_SIZE < 1 || DEBUG_ITF_MAX_RX_PAYLOAD_SIZE > UINT16_MAX
+    #error "DEBUG_ITF_MAX_RX_PAYLOAD_SIZE must be > 0 and < 2^16-1. Change DEBUG_ITF_MAX_RX_PAYLOAD_SIZE or DEBUG_UART_BUFFER_SIZE value accordingly"
+#endif
+
+#if (DEBUG_ITF_RX_JOB_QUEUE_LENGTH & (DEBUG_ITF_RX_JOB_QUEUE_LENGTH - 1U)) != 0 || DEBUG_ITF_RX_JOB_QUEUE_LENGTH > 128
+    #error "DEBUG_ITF_RX_JOB_QUEUE_LENGTH must be a power of two and <= 128. Change DEBUG_ITF_RX_JOB_QUEUE_LENGTH value accordingly"
+#endif
+
+#if DEBUG_ITF_FRAME_CRC_DEFAULT_MODE > 2
+    #error "DEBUG_ITF_FRAME_CRC_DEFAULT_MODE must be 0, 1 or 2. Change DEBUG_ITF_FRAME_CRC_DEFAULT_MODE value accordingly"
+#endif
+
+#if defined(DEBUG_ITF_COBS_FRAMING) && !defined(DEBUG_ITF_TX_RING_MODE)
+    #error "DEBUG_ITF_COBS_FRAMING requires DEBUG_ITF_TX_RING_MODE. Define DEBUG_ITF_TX_RING_MODE or remove DEBUG_ITF_COBS_FRAMING"
+#endif
+
+#if DEBUG_ITF_TX_COALESCE_THRESHOLD > DEBUG_ITF_TX_STAGING_SIZE
+    #error "DEBUG_ITF_TX_COALESCE_THRESHOLD must not be bigger than DEBUG_ITF_TX_STAGING_SIZE"
+#endif
+
 #endif /* DEVICE_UART_DEBUG_PROTOCOL_H_ */
 
 /**
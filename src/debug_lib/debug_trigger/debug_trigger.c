@@ -0,0 +1,431 @@
+#include "../../debug_lib/debug_trigger/debug_trigger.h"
+#include "../../debug_lib/debug_port.h"
+
+/**************************************************************************************************/
+/*                                                                                                */
+/*                                  Static variables declarations                                 */
+/*                                                                                                */
+/**************************************************************************************************/
+
+static debug_trigger_config trigger_config;
+static uint8_t watched_buffer_type = NO_Type;
+static volatile uint8_t trigger_state = DEBUG_TRIGGER_DISARMED;
+static uint16_t recorded_samples_count = 0; // Samples since arming, stops counting at DEBUG_BUFFER_SIZE
+static uint16_t sampled_write_index = 0; // next_write_index of the watched buffer at the last sample
+static uint16_t post_trigger_samples_left = 0;
+static uint32_t previous_value = 0; // Used by edge conditions
+static uint32_t captures_count = 0;
+// Registered buffers that were circular before arming, restored by disarming. Only buffers registered before arming are restored
+static uint32_t circular_buffers_mask = 0;
+static uint8_t saved_buffers_count = 0;
+
+// Payload: u8 - DEBUG_TRIGGER_STATE, u16 - post trigger samples, u32 - captures count
+static uint8_t message_trigger_status[10] = { 0xAA, 0x55, DEBUG_ITF_TRIGGER_STATUS_Code, 0x00 };
+static uint8_t message_ack[3] = { 0xAA, 0x55, 0xAA };
+static uint8_t message_nack[3] = { 0xAA, 0x55, 0x55 };
+
+/**************************************************************************************************/
+/*                                                                                                */
+/*                                 Static functions declarations                                  */
+/*                                                                                                */
+/**************************************************************************************************/
+
+static void debug_trigger_save_buffer_modes( void );
+static void debug_trigger_restore_buffer_modes( void );
+static void debug_trigger_restart( void );
+static void debug_trigger_capture( void );
+static uint8_t debug_trigger_read_newest_value( uint32_t* value );
+static int8_t debug_trigger_compare( uint32_t value, uint32_t level );
+static uint8_t debug_trigger_condition_is_met( uint32_t value );
+
+static void debug_trigger_arm_handler( const debug_itf_request* request, void* context, debug_itf_reply_cbk reply );
+static void debug_trigger_disarm_handler( const debug_itf_request* request, void* context, debug_itf_reply_cbk reply );
+static void debug_trigger_status_handler( const debug_itf_request* request, void* context, debug_itf_reply_cbk reply );
+
+/**************************************************************************************************/
+/*                                                                                                */
+/*                                 Global functions implementations                               */
+/*                                                                                                */
+/**************************************************************************************************/
+
+/**
+ * @brief Makes all registered buffers circular, restarts them and starts checking the condition. Buffers must be registered
+ *  before arming, and the previous capture is lost. Mode each buffer had before arming is restored by debug_trigger_disarm()
+ *
+ * @return 0 if trigger was armed, error code otherwise
+ */
+pif_error_code debug_trigger_arm( const debug_trigger_config* config )
+{
+    const debug_com_buffers* buffers = debug_get_com_buffer();
+    if(config->buffer_index >= buffers->next_free_buffer_index || config->condition >= DEBUG_TRIGGER_CONDITIONS_COUNT ||
+            config->mode > DEBUG_TRIGGER_AUTO || config->post_trigger_samples >= DEBUG_BUFFER_SIZE)
+    {
+        return LOG_ERROR(6201); // Invalid trigger configuration
+    }
+
+    const debug_port_critical_state critical_state = debug_port_enter_critical();
+    if(trigger_state == DEBUG_TRIGGER_DISARMED)
+    {
+        debug_trigger_save_buffer_modes(); // Trigger that is armed again keeps modes from before the first arming
+    }
+    trigger_config = *config;
+    watched_buffer_type = buffers->buffers_types[config->buffer_index];
+    debug_trigger_restart();
+    debug_port_exit_critical(critical_state);
+
+    return 0;
+}
+
+/**
+ * @brief Stops checking the condition and gives every buffer back the mode it had before arming. Values and freeze are left as
+ *  they are, so a captured window can still be read
+ */
+void debug_trigger_disarm( void )
+{
+    const debug_port_critical_state critical_state = debug_port_enter_critical();
+    if(trigger_state != DEBUG_TRIGGER_DISARMED)
+    {
+        debug_trigger_restore_buffer_modes();
+        trigger_state = DEBUG_TRIGGER_DISARMED;
+    }
+    debug_port_exit_critical(critical_state);
+}
+
+/**
+ * @brief Checks the newest value of the watched buffer and freezes all registered buffers when the window is captured. Must be
+ *  called once per sample, after values were added to all registered buffers
+ */
+void debug_trigger_update( void )
+{
+    if(trigger_state != DEBUG_TRIGGER_ARMED && trigger_state != DEBUG_TRIGGER_TRIGGERED)
+    {
+        return;
+    }
+
+    // Client can arm or disarm the trigger from another context, so the whole update is done with the same configuration
+    const debug_port_critical_state critical_state = debug_port_enter_critical();
+    uint32_t value = 0;
+    if(debug_trigger_read_newest_value(&value) == 0)
+    {
+        // Watched buffer didn't take a value (frozen, held while it is sent or in write delay), so there is no new sample
+        debug_port_exit_critical(critical_state);
+        return;
+    }
+
+    if(recorded_samples_count < DEBUG_BUFFER_SIZE)
+    {
+        recorded_samples_count += 1;
+    }
+
+    if(trigger_state == DEBUG_TRIGGER_ARMED)
+    {
+        // Trigger sample can't come before the whole pre-trigger part is recorded
+        const uint8_t is_triggered = (recorded_samples_count >= DEBUG_BUFFER_SIZE - trigger_config.post_trigger_samples) &&
+                (debug_trigger_condition_is_met(value) != 0);
+        previous_value = value;
+
+        if(is_triggered != 0)
+        {
+            trigger_state = DEBUG_TRIGGER_TRIGGERED;
+            post_trigger_samples_left = trigger_config.post_trigger_samples;
+            if(post_trigger_samples_left == 0)
+            {
+                debug_trigger_capture();
+            }
+        }
+    }
+    else
+    {
+        post_trigger_samples_left -= 1;
+        if(post_trigger_samples_left == 0)
+        {
+            debug_trigger_capture();
+        }
+    }
+    debug_port_exit_critical(critical_state);
+}
+
+
+DEBUG_TRIGGER_STATE debug_trigger_get_state( void )
+{
+    return (DEBUG_TRIGGER_STATE)trigger_state;
+}
+
+
+uint32_t debug_trigger_get_captures_count( void )
+{
+    return captures_count;
+}
+
+/**
+ * @brief Adds trigger arm, disarm and status requests to the debug interface
+ *
+ * @return 0 if all requests were registered, error code otherwise
+ */
+pif_error_code debug_trigger_register_commands( void )
+{
+    const uint8_t codes[3] = { DEBUG_ITF_TRIGGER_ARM_Code, DEBUG_ITF_TRIGGER_DISARM_Code, DEBUG_ITF_TRIGGER_STATUS_Code };
+    const debug_itf_command_handler handlers[3] =
+    {
+        debug_trigger_arm_handler, debug_trigger_disarm_handler, debug_trigger_status_handler,
+    };
+
+    for(uint8_t i = 0; i < 3; i++)
+    {
+        const uint16_t register_error = debug_itf_register_command(codes[i], handlers[i], (void*)(0), (void*)(0));
+        if(register_error != 0)
+        {
+            return register_error;
+        }
+    }
+
+    return 0;
+}
+
+/**************************************************************************************************/
+/*                                                                                                */
+/*                                 Static functions implementations                               */
+/*                                                                                                */
+/**************************************************************************************************/
+
+/**
+ * @brief Saves which registered buffers are circular. Must be called inside critical section
+ */
+static void debug_trigger_save_buffer_modes( void )
+{
+    const debug_com_buffers* buffers = debug_get_com_buffer();
+    circular_buffers_mask = 0;
+    for(uint8_t i = 0; i < buffers->next_free_buffer_index; i++)
+    {
+        const debug_buffer_state* state = debug_get_buffer_state(buffers->buffers_values[i],
+                (DEBUG_DATA_TYPE)buffers->buffers_types[i]);
+        if(state->is_circular != 0)
+        {
+            circular_buffers_mask |= (1UL << i);
+        }
+    }
+    saved_buffers_count = buffers->next_free_buffer_index;
+}
+
+/**
+ * @brief Gives saved mode back to the buffers. Values are kept: oldest index doesn't depend on the mode, so a linear buffer
+ *  that has wrapped is still read in chronological order and only fills up the rest of it. Must be called inside critical section
+ */
+static void debug_trigger_restore_buffer_modes( void )
+{
+    const debug_com_buffers* buffers = debug_get_com_buffer();
+    for(uint8_t i = 0; i < saved_buffers_count; i++)
+    {
+        debug_buffer_state* state = debug_get_buffer_state(buffers->buffers_values[i], (DEBUG_DATA_TYPE)buffers->buffers_types[i]);
+        state->is_circular = ((circular_buffers_mask & (1UL << i)) != 0) ? 1U : 0U;
+    }
+}
+
+/**
+ * @brief Restarts all registered buffers in circular mode and arms the trigger. Must be called inside critical section
+ */
+static void debug_trigger_restart( void )
+{
+    // Same as debug_set_buffer_circular() and debug_unfreeze_buffer(). debug_set_buffer_circular() takes the critical section
+    //  itself, which nests on Cortex-M, but not with the host spin lock of debug_port.h. Read holds are kept, so values of
+    //  buffers that are still sent aren't overwritten
+    debug_com_buffers* buffers = debug_get_com_buffer();
+    for(uint8_t i = 0; i < buffers->next_free_buffer_index; i++)
+    {
+        debug_buffer_state* state = debug_get_buffer_state(buffers->buffers_values[i], (DEBUG_DATA_TYPE)buffers->buffers_types[i]);
+        state->is_circular = 1;
+        state->is_frozen = 0;
+        state->next_write_index = 0;
+        state->has_wrapped = 0;
+    }
+
+    recorded_samples_count = 0;
+    sampled_write_index = 0;
+    post_trigger_samples_left = 0;
+    previous_value = 0;
+    trigger_state = DEBUG_TRIGGER_ARMED;
+}
+
+/**
+ * @brief Freezes all registered buffers with the captured window. Buffer reads are tracked from now on for auto re-arm
+ */
+static void debug_trigger_capture( void )
+{
+    debug_freeze_all_com_buffers();
+    debug_get_com_buffer()->read_buffers_mask = 0;
+    captures_count += 1;
+    trigger_state = DEBUG_TRIGGER_CAPTURED;
+}
+
+/**
+ * @brief Newest value of the watched buffer as bits of a 32 bit value. Signed 16 bit values are sign extended. Every added value
+ *  moves next_write_index, as a circular buffer wraps only when the next value arrives, so an unchanged index means no new value
+ *
+ * @return 1 if a new value was read, 0 if buffer didn't take a value since the previous sample
+ */
+static uint8_t debug_trigger_read_newest_value( uint32_t* value )
+{
+    void* buffer_pointer = debug_get_com_buffer()->buffers_values[trigger_config.buffer_index];
+    const debug_buffer_state* state = debug_get_buffer_state(buffer_pointer, (DEBUG_DATA_TYPE)watched_buffer_type);
+    if(state == (void*)(0) || state->next_write_index == sampled_write_index)
+    {
+        return 0;
+    }
+
+    sampled_write_index = state->next_write_index;
+    const uint16_t index = state->next_write_index - 1U;
+    switch(watched_buffer_type)
+    {
+        case F32_Type:
+        {
+            const union { float f32; uint32_t u32; } f32_value = { .f32 = ((debug_f32_buffer*)buffer_pointer)->values[index] };
+            *value = f32_value.u32;
+            break;
+        }
+        case I32_Type:
+            *value = (uint32_t)((debug_i32_buffer*)buffer_pointer)->values[index];
+            break;
+        case U32_Type:
+            *value = ((debug_u32_buffer*)buffer_pointer)->values[index];
+            break;
+        case I16_Type:
+            *value = (uint32_t)(int32_t)((debug_i16_buffer*)buffer_pointer)->values[index];
+            break;
+        case U16_Type:
+            *value = ((debug_u16_buffer*)buffer_pointer)->values[index];
+            break;
+        default:
+            *value = ((debug_u8_buffer*)buffer_pointer)->values[index];
+            break;
+    }
+    return 1;
+}
+
+/**
+ * @brief Compares values as the type of the watched buffer
+ *
+ * @return 1 if value > level, -1 if value < level, 0 otherwise
+ */
+static int8_t debug_trigger_compare( uint32_t value, uint32_t level )
+{
+    switch(watched_buffer_type)
+    {
+        case F32_Type:
+        {
+            const union { uint32_t u32; float f32; } f32_value = { .u32 = value }, f32_level = { .u32 = level };
+            return (int8_t)((f32_value.f32 > f32_level.f32) - (f32_value.f32 < f32_level.f32));
+        }
+        case I32_Type:
+        case I16_Type:
+            return (int8_t)(((int32_t)value > (int32_t)level) - ((int32_t)value < (int32_t)level));
+        default:
+            return (int8_t)((value > level) - (value < level));
+    }
+}
+
+
+static uint8_t debug_trigger_condition_is_met( uint32_t value )
+{
+    const int8_t value_to_level = debug_trigger_compare(value, trigger_config.level);
+    // Edges need a previous value, which is only present after the first sample
+    const uint8_t has_previous_value = (recorded_samples_count > 1);
+    const int8_t previous_to_level = debug_trigger_compare(previous_value, trigger_config.level);
+    const uint8_t is_rising_edge = has_previous_value && previous_to_level <= 0 && value_to_level > 0;
+    const uint8_t is_falling_edge = has_previous_value && previous_to_level >= 0 && value_to_level < 0;
+
+    switch(trigger_config.condition)
+    {
+        case DEBUG_TRIGGER_ABOVE:
+            return value_to_level > 0;
+        case DEBUG_TRIGGER_BELOW:
+            return value_to_level < 0;
+        case DEBUG_TRIGGER_RISING_EDGE:
+            return is_rising_edge;
+        case DEBUG_TRIGGER_FALLING_EDGE:
+            return is_falling_edge;
+        case DEBUG_TRIGGER_ANY_EDGE:
+            return is_rising_edge || is_falling_edge;
+        case DEBUG_TRIGGER_OUTSIDE_WINDOW:
+            return value_to_level < 0 || debug_trigger_compare(value, trigger_config.upper_level) > 0;
+        default:
+            return 0;
+    }
+}
+
+/*                                    Command handlers                                            */
+/**************************************************************************************************/
+
+/**
+ * @brief Configures and arms the trigger. Payload: u8 - buffer index, u8 - DEBUG_TRIGGER_CONDITION, u8 - DEBUG_TRIGGER_MODE,
+ *  u16 - post trigger samples, u32 - level, u32 - upper level
+ */
+static void debug_trigger_arm_handler( const debug_itf_request* request, void* context, debug_itf_reply_cbk reply )
+{
+    (void)context;
+
+    if(request->payload_length != 13)
+    {
+        LOG_ERROR(6202); // Invalid trigger arm request length
+        reply(message_nack, sizeof(message_nack));
+        return;
+    }
+
+    const uint8_t* payload = request->payload;
+    const debug_trigger_config config =
+    {
+        .level = (uint32_t)payload[5] | ((uint32_t)payload[6] << 8) | ((uint32_t)payload[7] << 16) | ((uint32_t)payload[8] << 24),
+        .upper_level = (uint32_t)payload[9] | ((uint32_t)payload[10] << 8) | ((uint32_t)payload[11] << 16) |
+                ((uint32_t)payload[12] << 24),
+        .post_trigger_samples = (uint16_t)(payload[3] | (payload[4] << 8)),
+        .buffer_index = payload[0],
+        .condition = payload[1],
+        .mode = payload[2],
+    };
+    if(debug_trigger_arm(&config) != 0)
+    {
+        reply(message_nack, sizeof(message_nack));
+        return;
+    }
+
+    reply(message_ack, sizeof(message_ack));
+}
+
+
+static void debug_trigger_disarm_handler( const debug_itf_request* request, void* context, debug_itf_reply_cbk reply )
+{
+    (void)request;
+    (void)context;
+
+    debug_trigger_disarm();
+    reply(message_ack, sizeof(message_ack));
+}
+
+/**
+ * @brief Replies with trigger state. In auto mode a captured window that was fully read is replaced by arming the trigger again
+ */
+static void debug_trigger_status_handler( const debug_itf_request* request, void* context, debug_itf_reply_cbk reply )
+{
+    (void)request;
+    (void)context;
+
+    const debug_port_critical_state critical_state = debug_port_enter_critical();
+    const debug_com_buffers* buffers = debug_get_com_buffer();
+    const uint32_t all_buffers_mask = (buffers->next_free_buffer_index >= 32U) ?
+            UINT32_MAX : ((1UL << buffers->next_free_buffer_index) - 1U);
+    if(trigger_state == DEBUG_TRIGGER_CAPTURED && trigger_config.mode == DEBUG_TRIGGER_AUTO &&
+            (buffers->read_buffers_mask & all_buffers_mask) == all_buffers_mask)
+    {
+        debug_trigger_restart();
+    }
+
+    message_trigger_status[3] = trigger_state;
+    message_trigger_status[4] = (uint8_t)(trigger_config.post_trigger_samples & 0xFFU);
+    message_trigger_status[5] = (uint8_t)(trigger_config.post_trigger_samples >> 8);
+    for(uint8_t i = 0; i < 4U; i++)
+    {
+        message_trigger_status[6U + i] = (uint8_t)(captures_count >> (8U * i));
+    }
+    debug_port_exit_critical(critical_state);
+
+    reply(message_trigger_status, sizeof(message_trigger_status));
+}
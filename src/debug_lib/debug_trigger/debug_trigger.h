@@ -0,0 +1,92 @@
+// Description is in the end of the file
+#pragma once
+
+#ifndef DEBUG_TRIGGER_H_
+#define DEBUG_TRIGGER_H_
+
+#include <stdint.h>
+#include "../../debug_lib/debug_utils.h"
+
+// Include only if file is available. It can overwrite file configuration definitions
+#if defined __has_include
+    #if __has_include( <device_definitions.h> )
+        #include "device_definitions.h"
+    #endif
+#endif
+
+/**************************************************************************************************/
+/*                                                                                                */
+/*                                     Global types declarations                                  */
+/*                                                                                                */
+/**************************************************************************************************/
+
+// Levels are compared as values of the watched buffer type: f32, signed or unsigned integer
+typedef enum DEBUG_TRIGGER_CONDITION
+{
+    DEBUG_TRIGGER_ABOVE = 0, // Value > level
+    DEBUG_TRIGGER_BELOW = 1, // Value < level
+    DEBUG_TRIGGER_RISING_EDGE = 2, // Previous value <= level and value > level
+    DEBUG_TRIGGER_FALLING_EDGE = 3, // Previous value >= level and value < level
+    DEBUG_TRIGGER_ANY_EDGE = 4, // Rising or falling edge
+    DEBUG_TRIGGER_OUTSIDE_WINDOW = 5, // Value < level or value > upper_level
+    DEBUG_TRIGGER_CONDITIONS_COUNT = 6,
+}DEBUG_TRIGGER_CONDITION;
+
+typedef enum DEBUG_TRIGGER_MODE
+{
+    DEBUG_TRIGGER_SINGLE = 0, // Stays captured until armed again
+    DEBUG_TRIGGER_AUTO = 1, // Is armed again by the first status request after all registered buffers were read
+}DEBUG_TRIGGER_MODE;
+
+typedef enum DEBUG_TRIGGER_STATE
+{
+    DEBUG_TRIGGER_DISARMED = 0,
+    DEBUG_TRIGGER_ARMED = 1, // Pre-trigger samples are recorded and condition is checked
+    DEBUG_TRIGGER_TRIGGERED = 2, // Post-trigger samples are recorded
+    DEBUG_TRIGGER_CAPTURED = 3, // Registered buffers are frozen with the whole window
+}DEBUG_TRIGGER_STATE;
+
+typedef struct debug_trigger_config
+{
+    uint32_t level; // Bits of the value in the watched buffer type. Signed 16 bit levels are sign extended
+    uint32_t upper_level; // Used only by DEBUG_TRIGGER_OUTSIDE_WINDOW
+    uint16_t post_trigger_samples; // Samples recorded after the trigger sample. Must be smaller than DEBUG_BUFFER_SIZE
+    uint8_t buffer_index; // Registered buffer that is watched
+    uint8_t condition; // DEBUG_TRIGGER_CONDITION
+    uint8_t mode; // DEBUG_TRIGGER_MODE
+} debug_trigger_config;
+
+/**************************************************************************************************/
+/*                                                                                                */
+/*                                  Global functions declarations                                 */
+/*                                                                                                */
+/**************************************************************************************************/
+
+pif_error_code debug_trigger_arm( const debug_trigger_config* config );
+void debug_trigger_disarm( void );
+
+void debug_trigger_update( void );
+DEBUG_TRIGGER_STATE debug_trigger_get_state( void );
+uint32_t debug_trigger_get_captures_count( void );
+
+pif_error_code debug_trigger_register_commands( void );
+
+#endif /* DEBUG_TRIGGER_H_ */
+
+/**
+ * Trigger: captures a window of all registered debug buffers around a rare event, like an oscilloscope does, so the event can be
+ *  seen at full sample rate without streaming everything.
+ *
+ * Arming makes all registered buffers circular and restarts them. Disarming gives every buffer back the mode it had before
+ *  arming, but keeps its values, so a captured window can still be read. debug_trigger_update() must be called once per sample, after
+ *  new values were added to all registered buffers, so all of them have the same number of values. It checks the newest value of
+ *  the watched buffer against the condition. Calls after which the watched buffer didn't take a new value (it was frozen, held
+ *  while it is sent or in write delay) are not counted as samples. Condition is checked only after enough samples for the
+ *  pre-trigger part were recorded. After the trigger sample, post_trigger_samples more samples are recorded and all registered buffers are frozen.
+ *  Then every buffer holds DEBUG_BUFFER_SIZE - 1 - post_trigger_samples values before the trigger sample, the trigger sample and
+ *  post_trigger_samples values after it, and is read in that order with the usual buffer requests.
+ *
+ * debug_trigger_register_commands() adds DEBUG_ITF_TRIGGER_ARM_Code, DEBUG_ITF_TRIGGER_DISARM_Code and
+ *  DEBUG_ITF_TRIGGER_STATUS_Code requests to the debug interface. In DEBUG_TRIGGER_AUTO mode the status request that comes after
+ *  all registered buffers were read arms the trigger again, so client captures one window after another by polling the status.
+ */
@@ -1,4 +1,5 @@
 #include "../debug_lib/debug_utils.h"
+#include "../debug_lib/debug_port.h"
 
 
 static debug_error_log error_log;
@@ -11,6 +12,10 @@ const debug_transport* active_transport = (void*)0;
 uint32_t error_log_write_index = 0;
 uint32_t total_errors_count = 0;
 
+#if !defined(__ARM_ARCH_PROFILE) || (__ARM_ARCH_PROFILE != 'M')
+volatile uint8_t debug_port_host_lock = 0; // Used by host implementation of debug_port.h critical sections
+#endif
+
 
 const debug_error_log* const debug_get_error_log_ptr( void )
 {
@@ -29,14 +34,15 @@ uint16_t debug_log_error( const pif_error_code error_code )
 
     total_errors_count += 1;
 
-    // We skip writing if error log is full
-    if (error_log_write_index == DEBUG_ERROR_LOG_DEPTH)
+    // We skip writing if error log is full. Index is read once, so an interrupt that logs meanwhile can't make us write past the log
+    const uint32_t write_index = error_log_write_index;
+    if (write_index >= DEBUG_ERROR_LOG_DEPTH)
     {
         return error_code;
     }
 
-    error_log.error_codes[error_log_write_index] = error_code;
-    error_log_write_index += 1;
+    error_log.error_codes[write_index] = error_code;
+    error_log_write_index = write_index + 1U;
 
     return error_code;
 }
@@ -69,144 +75,161 @@ void setup_debug_interface( const debug_transport* transport )
 }
 
 
-// todo add description
+/**
+ * @brief Out of line version of debug_add_value_to_f32_buffer_inline(). Other types behave the same way
+ */
 void debug_add_value_to_f32_buffer(debug_f32_buffer* target_buffer, float value)
 {
-    if(target_buffer->write_delay_access_count > 0)
-    {
-        target_buffer->write_delay_access_count -= 1;
-        return;
-    }
-
-    if(target_buffer->next_write_index == DEBUG_BUFFER_SIZE)
-    {
-        return;
-    }
-    target_buffer->values[target_buffer->next_write_index] = value;
-    target_buffer->next_write_index += 1;
+    debug_add_value_to_f32_buffer_inline(target_buffer, value);
 }
 
 
 // todo add description
 void debug_reset_f32_buffer(debug_f32_buffer* target_buffer)
 {
-    target_buffer->next_write_index = 0;
+    target_buffer->state.next_write_index = 0;
+    target_buffer->state.has_wrapped = 0;
 }
 
 
 void debug_add_value_to_i32_buffer(debug_i32_buffer* target_buffer, int32_t value)
 {
-    if(target_buffer->write_delay_access_count > 0)
-    {
-        target_buffer->write_delay_access_count -= 1;
-        return;
-    }
-
-    if(target_buffer->next_write_index == DEBUG_BUFFER_SIZE)
-    {
-        return;
-    }
-    target_buffer->values[target_buffer->next_write_index] = value;
-    target_buffer->next_write_index += 1;
+    debug_add_value_to_i32_buffer_inline(target_buffer, value);
 }
 
 
 void debug_reset_i32_buffer(debug_i32_buffer* target_buffer)
 {
-    target_buffer->next_write_index = 0;
+    target_buffer->state.next_write_index = 0;
+    target_buffer->state.has_wrapped = 0;
 }
 
 
 void debug_add_value_to_u32_buffer( debug_u32_buffer* target_buffer, uint32_t value )
 {
-    if(target_buffer->write_delay_access_count > 0)
-    {
-        target_buffer->write_delay_access_count -= 1;
-        return;
-    }
-
-    if(target_buffer->next_write_index == DEBUG_BUFFER_SIZE)
-    {
-        return;
-    }
-    target_buffer->values[target_buffer->next_write_index] = value;
-    target_buffer->next_write_index += 1;
+    debug_add_value_to_u32_buffer_inline(target_buffer, value);
 }
 
 
 void debug_reset_u32_buffer( debug_u32_buffer* target_buffer )
 {
-    target_buffer->next_write_index = 0;
+    target_buffer->state.next_write_index = 0;
+    target_buffer->state.has_wrapped = 0;
 }
 
 
 void debug_add_value_to_i16_buffer( debug_i16_buffer* target_buffer, int16_t value )
 {
-    if(target_buffer->write_delay_access_count > 0)
-    {
-        target_buffer->write_delay_access_count -= 1;
-        return;
-    }
-
-    if(target_buffer->next_write_index == DEBUG_BUFFER_SIZE)
-    {
-        return;
-    }
-    target_buffer->values[target_buffer->next_write_index] = value;
-    target_buffer->next_write_index += 1;
+    debug_add_value_to_i16_buffer_inline(target_buffer, value);
 }
 
 
 void debug_reset_i16_buffer( debug_i16_buffer* target_buffer )
 {
-    target_buffer->next_write_index = 0;
+    target_buffer->state.next_write_index = 0;
+    target_buffer->state.has_wrapped = 0;
 }
 
 
 void debug_add_value_to_u16_buffer( debug_u16_buffer* target_buffer, uint16_t value )
 {
-    if(target_buffer->write_delay_access_count > 0)
-    {
-        target_buffer->write_delay_access_count -= 1;
-        return;
-    }
-
-    if(target_buffer->next_write_index == DEBUG_BUFFER_SIZE)
-    {
-        return;
-    }
-    target_buffer->values[target_buffer->next_write_index] = value;
-    target_buffer->next_write_index += 1;
+    debug_add_value_to_u16_buffer_inline(target_buffer, value);
 }
 
 
 void debug_reset_u16_buffer( debug_u16_buffer* target_buffer )
 {
-    target_buffer->next_write_index = 0;
+    target_buffer->state.next_write_index = 0;
+    target_buffer->state.has_wrapped = 0;
 }
 
-// TODO I really don't like that i have many exactly same functions with different types, though I'm not sure if this can be handled differently
-//          but if it is possible - something to do later.
 void debug_add_value_to_u8_buffer( debug_u8_buffer* target_buffer, uint8_t value )
 {
-    if(target_buffer->write_delay_access_count > 0)
+    debug_add_value_to_u8_buffer_inline(target_buffer, value);
+}
+
+
+void debug_reset_u8_buffer( debug_u8_buffer* target_buffer )
+{
+    target_buffer->state.next_write_index = 0;
+    target_buffer->state.has_wrapped = 0;
+}
+
+
+/**
+ * @brief Recording state of a buffer of any type
+ *
+ * @return State, or null pointer if buffer type is unknown
+ */
+debug_buffer_state* debug_get_buffer_state( void* buffer_pointer, DEBUG_DATA_TYPE buffer_type )
+{
+    switch(buffer_type)
     {
-        target_buffer->write_delay_access_count -= 1;
-        return;
+        case F32_Type:
+            return &((debug_f32_buffer*)buffer_pointer)->state;
+        case I32_Type:
+            return &((debug_i32_buffer*)buffer_pointer)->state;
+        case U32_Type:
+            return &((debug_u32_buffer*)buffer_pointer)->state;
+        case I16_Type:
+            return &((debug_i16_buffer*)buffer_pointer)->state;
+        case U16_Type:
+            return &((debug_u16_buffer*)buffer_pointer)->state;
+        case U8_Type:
+            return &((debug_u8_buffer*)buffer_pointer)->state;
+        default:
+            return (void*)(0);
     }
+}
 
-    if(target_buffer->next_write_index == DEBUG_BUFFER_SIZE)
+/**
+ * @brief Switches between recording once and circular recording. Buffer is restarted, as old values can't be ordered
+ */
+void debug_set_buffer_circular( void* buffer_pointer, DEBUG_DATA_TYPE buffer_type, uint8_t is_circular )
+{
+    debug_buffer_state* state = debug_get_buffer_state(buffer_pointer, buffer_type);
+    if(state == (void*)(0))
     {
         return;
     }
-    target_buffer->values[target_buffer->next_write_index] = value;
-    target_buffer->next_write_index += 1;
+
+    const debug_port_critical_state critical_state = debug_port_enter_critical();
+    state->is_circular = (is_circular != 0) ? 1U : 0U;
+    state->next_write_index = 0;
+    state->has_wrapped = 0;
+    debug_port_exit_critical(critical_state);
 }
 
 
-void debug_reset_u8_buffer( debug_u8_buffer* target_buffer )
+void debug_freeze_buffer( void* buffer_pointer, DEBUG_DATA_TYPE buffer_type )
 {
-    target_buffer->next_write_index = 0;
+    debug_buffer_state* state = debug_get_buffer_state(buffer_pointer, buffer_type);
+    if(state != (void*)(0))
+    {
+        state->is_frozen = 1;
+    }
+}
+
+
+void debug_unfreeze_buffer( void* buffer_pointer, DEBUG_DATA_TYPE buffer_type )
+{
+    debug_buffer_state* state = debug_get_buffer_state(buffer_pointer, buffer_type);
+    if(state != (void*)(0))
+    {
+        state->is_frozen = 0;
+    }
+}
+
+/**
+ * @brief Index of the oldest value. Values are in chronological order from it to the end of the buffer and then from its start
+ */
+uint16_t debug_get_buffer_oldest_index( const debug_buffer_state* state )
+{
+    if(state->has_wrapped == 0 || state->next_write_index >= DEBUG_BUFFER_SIZE)
+    {
+        return 0;
+    }
+    return state->next_write_index;
 }
 
 
@@ -247,6 +270,26 @@ debug_com_buffers* debug_get_com_buffer( void )
     return &com_buffers;
 }
 
+/**
+ * @brief Freezes all registered buffers, e.g. when a fault is detected, so circular buffers keep the values before it
+ */
+void debug_freeze_all_com_buffers( void )
+{
+    for(uint8_t i = 0; i < com_buffers.next_free_buffer_index; i++)
+    {
+        debug_freeze_buffer(com_buffers.buffers_values[i], (DEBUG_DATA_TYPE)com_buffers.buffers_types[i]);
+    }
+}
+
+
+void debug_unfreeze_all_com_buffers( void )
+{
+    for(uint8_t i = 0; i < com_buffers.next_free_buffer_index; i++)
+    {
+        debug_unfreeze_buffer(com_buffers.buffers_values[i], (DEBUG_DATA_TYPE)com_buffers.buffers_types[i]);
+    }
+}
+
 
 pif_error_code debug_register_com_stream( debug_com_stream* stream_instance )
 {
@@ -281,7 +324,7 @@ debug_com_stream* debug_get_active_com_stream( void )
     return active_com_stream;
 }
 
-__attribute__((weak)) void debug_update_com_stream( void )
+__attribute__((weak)) pif_error_code debug_update_com_stream( void )
 {
-
+    return 4220; // Nothing can be sent without debug protocol
 }
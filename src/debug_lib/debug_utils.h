@@ -52,6 +52,7 @@
 
 typedef struct {
     void (*send)(const uint8_t *data, const uint32_t len);
+    uint32_t (*get_cycle_count)(void); // Optional. Free running counter used for DEBUG_ITF_TX_BLOCK timeouts
 } debug_transport;
 
 
@@ -69,6 +70,7 @@ typedef uint16_t pif_error_code;
 #define DEBUG_OPTIMIZATION_Ofast    __attribute__((optimize("-Ofast")))
 
 #define DEBUG_NOINLINE              __attribute__((noinline))
+#define DEBUG_ALWAYS_INLINE         __attribute__((always_inline)) inline
 #define DEBUG_NOREORDER             __attribute__((no_reorder))
 
 #define DEBUG_UNUSED                __attribute__((unused))
@@ -98,46 +100,53 @@ typedef struct debug_error_log
 } debug_error_log;
 
 
-typedef struct debug_f32_buffer
+// Recording state shared by all buffer types. Zero initialised state records values once from the start of the buffer.
+//  next_write_index and write_delay_access_count used to be fields of the buffer itself, so code that accessed them as
+//  buffer.next_write_index must use buffer.state.next_write_index now
+typedef struct debug_buffer_state
 {
-    float values[DEBUG_BUFFER_SIZE];
     uint16_t next_write_index;
     uint16_t write_delay_access_count;
+    uint8_t is_circular; // Oldest values are overwritten when buffer is full, instead of recording being stopped
+    uint8_t is_frozen; // Values are not added while set, so buffer can be read without being changed
+    uint8_t has_wrapped; // Circular buffer was filled at least once, so the oldest value is at next_write_index
+    uint8_t read_holds_count; // Queued reads that send a circular buffer from its own memory. Values are not added meanwhile
+} debug_buffer_state;
+
+typedef struct debug_f32_buffer
+{
+    float values[DEBUG_BUFFER_SIZE];
+    debug_buffer_state state;
 }debug_f32_buffer;
 
 typedef struct debug_i32_buffer
 {
     int32_t values[DEBUG_BUFFER_SIZE];
-    uint16_t next_write_index;
-    uint16_t write_delay_access_count;
+    debug_buffer_state state;
 }debug_i32_buffer;
 
 typedef struct debug_u32_buffer
 {
     uint32_t values[DEBUG_BUFFER_SIZE];
-    uint16_t next_write_index;
-    uint16_t write_delay_access_count;
+    debug_buffer_state state;
 }debug_u32_buffer;
 
 typedef struct debug_i16_buffer
 {
     int16_t values[DEBUG_BUFFER_SIZE];
-    uint16_t next_write_index;
-    uint16_t write_delay_access_count;
+    debug_buffer_state state;
 }debug_i16_buffer;
 
 typedef struct debug_u16_buffer
 {
     uint16_t values[DEBUG_BUFFER_SIZE];
-    uint16_t next_write_index;
-    uint16_t write_delay_access_count;
+    debug_buffer_state state;
 }debug_u16_buffer;
 
 typedef struct debug_u8_buffer
 {
     uint8_t values[DEBUG_BUFFER_SIZE];
-    uint16_t next_write_index;
-    uint16_t write_delay_access_count;
+    debug_buffer_state state;
 }debug_u8_buffer;
 
 typedef enum DEBUG_DATA_TYPE
@@ -158,6 +167,7 @@ typedef struct debug_com_buffers
     uint8_t buffers_types[DEBUG_MAX_BUFFERS_COUNT];
     uint8_t next_free_buffer_index;
     uint8_t read_requests_count;
+    uint32_t read_buffers_mask; // Bit of every buffer that was read since the mask was cleared. Limits buffers count to 32
 } debug_com_buffers;
 
 
@@ -183,6 +193,7 @@ typedef struct debug_com_stream
 	uint8_t entry_fields_count; // Number of unique basic types(like u8, u16, i32, f32, etc) per message entry
 	uint8_t is_active; // bool to show if stream is actively subscribed to. Init to 0
 	uint8_t entry_fields_types[DEBUG_MAX_STREAM_FIELDS_COUNT];
+	debug_itf_message_release_cbk message_released_cbk; // Optional. Called with message pointer when its memory can be reused
 } debug_com_stream;
 
 /**************************************************************************************************/
@@ -219,9 +230,56 @@ void debug_reset_u16_buffer( debug_u16_buffer* target_buffer );
 void debug_add_value_to_u8_buffer( debug_u8_buffer* target_buffer, uint8_t value );
 void debug_reset_u8_buffer( debug_u8_buffer* target_buffer );
 
+// Defines debug_add_value_to_<type>_buffer_inline(), which is inlined into the caller. The common case of a value that is written
+//  takes a single branch, while freeze, read hold, write delay, full buffer and circular wrap are handled after it
+#define DEBUG_DEFINE_BUFFER_INLINE_ADD(type_name, value_type)                                                       \
+    static DEBUG_ALWAYS_INLINE void debug_add_value_to_##type_name##_buffer_inline( debug_##type_name##_buffer* target_buffer, \
+            value_type value )                                                                                      \
+    {                                                                                                               \
+        debug_buffer_state* state = &target_buffer->state;                                                          \
+        const uint16_t write_index = state->next_write_index;                                                       \
+        const uint16_t write_delay = state->write_delay_access_count;                                               \
+        const uint8_t is_frozen = state->is_frozen | state->read_holds_count;                                       \
+        if(__builtin_expect((write_delay | is_frozen | (uint16_t)(write_index >= DEBUG_BUFFER_SIZE)) == 0, 1))      \
+        {                                                                                                           \
+            target_buffer->values[write_index] = value;                                                             \
+            state->next_write_index = (uint16_t)(write_index + 1U);                                                 \
+        }                                                                                                           \
+        else if(is_frozen != 0)                                                                                     \
+        {                                                                                                           \
+            /* Frozen or held buffer is left as it is, including write delay */                                     \
+        }                                                                                                           \
+        else if(write_delay > 0)                                                                                    \
+        {                                                                                                           \
+            state->write_delay_access_count = (uint16_t)(write_delay - 1U);                                         \
+        }                                                                                                           \
+        else if(state->is_circular != 0)                                                                            \
+        {                                                                                                           \
+            /* Wrap is done when the next value arrives, so fast path doesn't check for it */                       \
+            target_buffer->values[0] = value;                                                                       \
+            state->next_write_index = 1U;                                                                           \
+            state->has_wrapped = 1U;                                                                                \
+        }                                                                                                           \
+    }
+
+DEBUG_DEFINE_BUFFER_INLINE_ADD(f32, float)
+DEBUG_DEFINE_BUFFER_INLINE_ADD(i32, int32_t)
+DEBUG_DEFINE_BUFFER_INLINE_ADD(u32, uint32_t)
+DEBUG_DEFINE_BUFFER_INLINE_ADD(i16, int16_t)
+DEBUG_DEFINE_BUFFER_INLINE_ADD(u16, uint16_t)
+DEBUG_DEFINE_BUFFER_INLINE_ADD(u8, uint8_t)
+
+debug_buffer_state* debug_get_buffer_state( void* buffer_pointer, DEBUG_DATA_TYPE buffer_type );
+void debug_set_buffer_circular( void* buffer_pointer, DEBUG_DATA_TYPE buffer_type, uint8_t is_circular );
+void debug_freeze_buffer( void* buffer_pointer, DEBUG_DATA_TYPE buffer_type );
+void debug_unfreeze_buffer( void* buffer_pointer, DEBUG_DATA_TYPE buffer_type );
+uint16_t debug_get_buffer_oldest_index( const debug_buffer_state* state );
+
 void debug_register_com_buffer( void* buffer_pointer, DEBUG_DATA_TYPE buffer_type );
 void debug_unregister_all_com_buffers( void );
 debug_com_buffers* debug_get_com_buffer( void );
+void debug_freeze_all_com_buffers( void );
+void debug_unfreeze_all_com_buffers( void );
 
 
 /*                                 Debug streams related functions                                */
@@ -231,12 +289,13 @@ void debug_unregister_com_stream( void );
 
 debug_com_stream* debug_get_active_com_stream( void );
 
-void debug_update_com_stream( void );
+pif_error_code debug_update_com_stream( void );
 
 /*                                 Debug interrupt handlers                                       */
 /**************************************************************************************************/
 void debug_handle_rx(uint8_t* message, uint32_t message_length);
 void debug_handle_tx(void);
+void debug_poll( void );
 
 
 /**************************************************************************************************/
@@ -248,25 +307,38 @@ void debug_handle_tx(void);
 /**************************************************************************************************/
 #if DEBUG_ERROR_LOG_VERSION == 1
 
-    #if DEBUG_ERROR_LOG_DEPTH > UINT16_MAX / 2
-        // This requirement is needed to ensure that a whole error log can be sent using UART with a single DMA request.
-        #error "Error log must not take more than UINT16_MAX bytes. Please use smaller value for DEBUG_ERROR_LOG_DEPTH definition."
-    #endif /* DEBUG_ERROR_LOG_DEPTH > 0xFFFF */
+    #if DEBUG_ERROR_LOG_DEPTH > UINT16_MAX
+        // Error log depth is sent to the client as u16 value. Log itself can be bigger than a single DMA transfer, as it is split into chunks.
+        #error "Error log depth must fit into u16. Please use smaller value for DEBUG_ERROR_LOG_DEPTH definition."
+    #endif /* DEBUG_ERROR_LOG_DEPTH > UINT16_MAX */
 
 #endif /* DEBUG_ERROR_LOG_VERSION == 1 */
 
 
 /*                               Debug buffers related error checkers                             */
 /**************************************************************************************************/
-#if DEBUG_BUFFER_SIZE > UINT16_MAX / 4
-	// This requirement is needed to ensure that a whole buffer can be sent using UART with a single DMA request. The biggest simple buffer is 4 bytes long,
-	//	therefore we need to limit buffer size to UINT16_MAX /4.
-    #error "Debug buffer size must not take more than UINT16_MAX bytes. Please change smaller DEBUG_BUFFER_SIZE value"
-#endif /* DEBUG_BUFFER_SIZE > UINT16_MAX / 4 */
+#if DEBUG_BUFFER_SIZE > UINT16_MAX
+	// Number of points in a buffer is sent to the client as u16 value and buffers use u16 write index. Buffer data itself
+	//	can take more than a single DMA transfer, as it is split into chunks by the debug protocol.
+    #error "Debug buffer size must fit into u16. Please change smaller DEBUG_BUFFER_SIZE value"
+#endif /* DEBUG_BUFFER_SIZE > UINT16_MAX */
+
+#ifdef DEBUG_ITF_TX_RING_MODE
+    // Whole buffer of u32 or f32 values is copied into the bulk ring as a single group: tag header (6 bytes), values and
+    //  CRC-32 trailer (4 bytes), plus COBS overhead when it is used
+    #define DEBUG_BUFFER_MAX_GROUP_SIZE     (DEBUG_BUFFER_SIZE * 4U + 10U)
+    #ifdef DEBUG_ITF_COBS_FRAMING
+        #if DEBUG_BUFFER_MAX_GROUP_SIZE + DEBUG_BUFFER_MAX_GROUP_SIZE / 254U + 2U > DEBUG_ITF_TX_RING_SIZE
+            #error "Debug buffer doesn't fit into the TX ring. Please use bigger DEBUG_ITF_TX_RING_SIZE or smaller DEBUG_BUFFER_SIZE value"
+        #endif
+    #elif DEBUG_BUFFER_MAX_GROUP_SIZE > DEBUG_ITF_TX_RING_SIZE
+        #error "Debug buffer doesn't fit into the TX ring. Please use bigger DEBUG_ITF_TX_RING_SIZE or smaller DEBUG_BUFFER_SIZE value"
+    #endif
+#endif /* DEBUG_ITF_TX_RING_MODE */
 
-#if DEBUG_MAX_BUFFER_COUNT > 32
-    #error "DEBUG_MAX_BUFFER_COUNT must be <= 32. Otherwise it will break debug interface addressing approach. Please select value of DEBUG_MAX_BUFFER_COUNT to be <= 32"
-#endif /* DEBUG_MAX_BUFFER_COUNT > 16 */
+#if DEBUG_MAX_BUFFERS_COUNT > 32
+    #error "DEBUG_MAX_BUFFERS_COUNT must be <= 32. Otherwise it will break debug interface addressing approach and read_buffers_mask. Please select value of DEBUG_MAX_BUFFERS_COUNT to be <= 32"
+#endif /* DEBUG_MAX_BUFFERS_COUNT > 32 */
 
 /*                               Debug streams related error checkers                             */
 /**************************************************************************************************/
@@ -305,5 +377,21 @@ void debug_handle_tx(void);
  *          as errors to the error_log.
  *  - DEBUG_DISABLE_LOGGING - switches all LOG_ERROR calls into the content of these calls. Meaning removes all the error logging overhead without affecting other behaviours.
  *
+ * Values are added to debug buffers either with debug_add_value_to_<type>_buffer() or with the same
+ *  debug_add_value_to_<type>_buffer_inline(). Both behave the same way, but the inline version has no call overhead, so it should be
+ *  used in hot code like control loops and interrupts. The out of line version keeps code size small where speed doesn't matter.
+ *
+ * A buffer stops recording when it is full, so by default it holds the first DEBUG_BUFFER_SIZE values after reset. With
+ *  debug_set_buffer_circular() it keeps overwriting the oldest values instead, and debug_freeze_buffer() (or
+ *  debug_freeze_all_com_buffers() when something interesting happens) stops it, so it holds the last values before the event.
+ *  Registered buffers are always sent to the client in chronological order starting from the oldest value. In pointer TX mode
+ *  a buffer is sent from its own memory, so from the read request until its transfer is done a circular buffer is held: values
+ *  added meanwhile are dropped, like in a frozen buffer. A linear buffer is not held, as new values only go after the sent ones,
+ *  so it keeps recording without a gap. Client can freeze and unfreeze all registered buffers with
+ *  DEBUG_ITF_FREEZE_BUFFERS_Code request, so that all of them keep the same window over several reads.
+ *
+ * Recording state of every buffer type is kept in its debug_buffer_state member. Code written for the older layout, where
+ *  next_write_index and write_delay_access_count were fields of the buffer, must access them through buffer.state.
+ *
  */
 
@@ -0,0 +1,351 @@
+#include "../../debug_lib/debug_watch/debug_watch.h"
+#include "../../debug_lib/debug_memory/debug_memory.h"
+#include "../../debug_lib/debug_port.h"
+
+/**************************************************************************************************/
+/*                                                                                                */
+/*                                  Static variables declarations                                 */
+/*                                                                                                */
+/**************************************************************************************************/
+
+// States of a message buffer from the pool
+#define WATCH_MESSAGE_FREE                      0 // Can be taken for recording
+#define WATCH_MESSAGE_RECORDING                 1 // New samples are saved into it
+#define WATCH_MESSAGE_QUEUED                    2 // Owned by debug interface until it is released
+
+#define WATCH_NO_MESSAGE                        (0xFFU)
+
+static debug_watch_entry watch_entries[DEBUG_WATCH_MAX_ENTRIES_COUNT];
+static DEBUG_MEMORY_ACCESS_WIDTH watch_entries_access_widths[DEBUG_WATCH_MAX_ENTRIES_COUNT]; // Checked when the list is set
+static uint8_t watch_entries_count = 0; // 0 if no watch list is set
+static uint16_t watch_entries_per_message = 0;
+static uint16_t watch_sample_divider = 1;
+static uint16_t watch_sample_size = 0; // Bytes of all entries of a single sample
+static uint16_t sample_calls_count = 0;
+
+static uint8_t watch_messages[DEBUG_WATCH_MESSAGE_BUFFERS_COUNT][DEBUG_WATCH_MESSAGE_SIZE];
+static volatile uint8_t watch_messages_state[DEBUG_WATCH_MESSAGE_BUFFERS_COUNT];
+static uint8_t record_message_index = WATCH_NO_MESSAGE;
+static uint16_t recorded_samples_count = 0;
+static uint32_t dropped_samples_count = 0;
+
+static debug_com_stream watch_stream =
+{
+        .timeout_ms = DEBUG_WATCH_STREAM_TIMEOUT_MS,
+        .id = DEBUG_WATCH_STREAM_ID,
+        .is_active = 0,
+};
+
+static uint8_t message_ack[3] = { 0xAA, 0x55, 0xAA };
+static uint8_t message_nack[3] = { 0xAA, 0x55, 0x55 };
+
+/**************************************************************************************************/
+/*                                                                                                */
+/*                                 Static functions declarations                                  */
+/*                                                                                                */
+/**************************************************************************************************/
+
+static uint8_t debug_watch_type_size( uint8_t type );
+static uint8_t debug_watch_take_free_message( void );
+static void debug_watch_message_released( uint8_t* message );
+
+static void debug_watch_set_list_handler( const debug_itf_request* request, void* context, debug_itf_reply_cbk reply );
+
+/**************************************************************************************************/
+/*                                                                                                */
+/*                                 Global functions implementations                               */
+/*                                                                                                */
+/**************************************************************************************************/
+
+/**
+ * @brief Replaces the watch list and registers it as the active stream. Stream is stopped, so client has to start it again.
+ *
+ * @param entries_per_message number of samples sent in a single stream message
+ * @param sample_divider only every sample_divider-th debug_watch_sample() call takes a sample
+ * @return 0 if the list was set, error code otherwise
+ */
+pif_error_code debug_watch_set_list( const debug_watch_entry* entries, uint8_t entries_count, uint16_t entries_per_message,
+        uint16_t sample_divider )
+{
+    if(entries_count == 0 || entries_count > DEBUG_WATCH_MAX_ENTRIES_COUNT || entries_per_message == 0 || sample_divider == 0)
+    {
+        return LOG_ERROR(6101); // Invalid watch list
+    }
+
+    uint32_t sample_size = 0;
+    DEBUG_MEMORY_ACCESS_WIDTH access_widths[DEBUG_WATCH_MAX_ENTRIES_COUNT];
+    for(uint8_t i = 0; i < entries_count; i++)
+    {
+        const uint8_t entry_size = debug_watch_type_size(entries[i].type);
+        if(entry_size == 0)
+        {
+            return LOG_ERROR(6101); // Invalid watch list. Unknown entry type
+        }
+
+        if(debug_memory_check_read(entries[i].address, entry_size, &access_widths[i]) != 0)
+        {
+            return LOG_ERROR(6102); // Watch entry is outside of readable debug_memory regions
+        }
+        sample_size += entry_size;
+    }
+
+    if(sample_size * entries_per_message > DEBUG_WATCH_MESSAGE_SIZE)
+    {
+        return LOG_ERROR(6103); // Samples don't fit into a message. Use less entries per message or increase DEBUG_WATCH_MESSAGE_SIZE
+    }
+
+    const debug_com_stream* active_stream = debug_get_active_com_stream();
+    if(active_stream != (void*)(0) && active_stream != &watch_stream)
+    {
+        return LOG_ERROR(6104); // Another stream is registered
+    }
+    if(active_stream == &watch_stream)
+    {
+        debug_unregister_com_stream();
+    }
+
+    const debug_port_critical_state critical_state = debug_port_enter_critical();
+    for(uint8_t i = 0; i < entries_count; i++)
+    {
+        watch_entries[i] = entries[i];
+        watch_entries_access_widths[i] = access_widths[i];
+        watch_stream.entry_fields_types[i] = entries[i].type;
+    }
+    watch_entries_count = entries_count;
+    watch_entries_per_message = entries_per_message;
+    watch_sample_divider = sample_divider;
+    watch_sample_size = (uint16_t)sample_size;
+    sample_calls_count = 0;
+
+    // Messages owned by debug interface are released later, the rest had samples of the previous list
+    record_message_index = WATCH_NO_MESSAGE;
+    recorded_samples_count = 0;
+    for(uint8_t i = 0; i < DEBUG_WATCH_MESSAGE_BUFFERS_COUNT; i++)
+    {
+        if(watch_messages_state[i] != WATCH_MESSAGE_QUEUED)
+        {
+            watch_messages_state[i] = WATCH_MESSAGE_FREE;
+        }
+    }
+
+    watch_stream.entry_fields_count = entries_count;
+    watch_stream.entries_per_message_count = entries_per_message;
+    watch_stream.message_byte_size = (uint16_t)(sample_size * entries_per_message);
+    watch_stream.message_released_cbk = debug_watch_message_released;
+    debug_port_exit_critical(critical_state);
+
+    return debug_register_com_stream(&watch_stream);
+}
+
+/**
+ * @brief Stops sampling and unregisters the watch stream
+ */
+void debug_watch_clear_list( void )
+{
+    if(debug_get_active_com_stream() == &watch_stream)
+    {
+        debug_unregister_com_stream();
+    }
+
+    const debug_port_critical_state critical_state = debug_port_enter_critical();
+    watch_entries_count = 0;
+    record_message_index = WATCH_NO_MESSAGE;
+    recorded_samples_count = 0;
+    debug_port_exit_critical(critical_state);
+}
+
+/**
+ * @brief Takes a sample of all watch list entries and queues the message when it is full. Must be called periodically from a
+ *  single context, like a timer interrupt. Does nothing if no watch list is set.
+ */
+void debug_watch_sample( void )
+{
+    // All entries are copied in a single critical section, so values of a sample belong together and the list can't be
+    //  replaced meanwhile. Entries were checked when the list was set, so only up to DEBUG_WATCH_MAX_ENTRIES_COUNT copies are made
+    const debug_port_critical_state critical_state = debug_port_enter_critical();
+    if(watch_entries_count == 0)
+    {
+        debug_port_exit_critical(critical_state);
+        return;
+    }
+
+    sample_calls_count += 1;
+    if(sample_calls_count < watch_sample_divider)
+    {
+        debug_port_exit_critical(critical_state);
+        return;
+    }
+    sample_calls_count = 0;
+
+    if(record_message_index == WATCH_NO_MESSAGE)
+    {
+        record_message_index = debug_watch_take_free_message();
+        if(record_message_index == WATCH_NO_MESSAGE)
+        {
+            dropped_samples_count += 1;
+            debug_port_exit_critical(critical_state);
+            return;
+        }
+    }
+
+    uint8_t* sample = &watch_messages[record_message_index][recorded_samples_count * watch_sample_size];
+    for(uint8_t i = 0; i < watch_entries_count; i++)
+    {
+        const uint8_t entry_size = debug_watch_type_size(watch_entries[i].type);
+        debug_memory_copy(watch_entries[i].address, sample, entry_size, watch_entries_access_widths[i]);
+        sample += entry_size;
+    }
+
+    uint8_t full_message_index = WATCH_NO_MESSAGE;
+    recorded_samples_count += 1;
+    if(recorded_samples_count == watch_entries_per_message)
+    {
+        // State is changed before queueing, as debug system can release the message before debug_update_com_stream() returns
+        full_message_index = record_message_index;
+        watch_messages_state[full_message_index] = WATCH_MESSAGE_QUEUED;
+        record_message_index = WATCH_NO_MESSAGE;
+        recorded_samples_count = 0;
+    }
+    debug_port_exit_critical(critical_state);
+
+    if(full_message_index == WATCH_NO_MESSAGE)
+    {
+        return;
+    }
+
+    watch_stream.message = watch_messages[full_message_index];
+    const pif_error_code update_error = debug_update_com_stream();
+    if(update_error != 0)
+    {
+        watch_messages_state[full_message_index] = WATCH_MESSAGE_FREE;
+        if(update_error != 4220) // Samples are not lost if nobody is subscribed to the stream
+        {
+            dropped_samples_count += watch_stream.entries_per_message_count;
+        }
+    }
+}
+
+/**
+ * @brief Number of samples lost because no message buffer was free or debug interface refused to queue a full message
+ */
+uint32_t debug_watch_get_dropped_samples_count( void )
+{
+    return dropped_samples_count;
+}
+
+/**
+ * @brief Adds watch list request to the debug interface
+ *
+ * @return 0 if request was registered, error code otherwise
+ */
+pif_error_code debug_watch_register_commands( void )
+{
+    return debug_itf_register_command(DEBUG_ITF_SET_WATCH_LIST_Code, debug_watch_set_list_handler, (void*)(0), (void*)(0));
+}
+
+/**************************************************************************************************/
+/*                                                                                                */
+/*                                 Static functions implementations                               */
+/*                                                                                                */
+/**************************************************************************************************/
+
+/**
+ * @brief Size of a single value of DEBUG_DATA_TYPE
+ *
+ * @return Size in bytes, or 0 for unknown type
+ */
+static uint8_t debug_watch_type_size( uint8_t type )
+{
+    switch(type)
+    {
+        case F32_Type:
+        case I32_Type:
+        case U32_Type:
+            return 4;
+        case I16_Type:
+        case U16_Type:
+            return 2;
+        case U8_Type:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/**
+ * @brief Takes a free message from the pool. Must be called inside critical section
+ *
+ * @return Message index, or WATCH_NO_MESSAGE if all messages are in use
+ */
+static uint8_t debug_watch_take_free_message( void )
+{
+    for(uint8_t i = 0; i < DEBUG_WATCH_MESSAGE_BUFFERS_COUNT; i++)
+    {
+        if(watch_messages_state[i] == WATCH_MESSAGE_FREE)
+        {
+            watch_messages_state[i] = WATCH_MESSAGE_RECORDING;
+            return i;
+        }
+    }
+    return WATCH_NO_MESSAGE;
+}
+
+/**
+ * @brief Returns the message to the pool when debug interface doesn't need it any longer. Called inside critical section
+ */
+static void debug_watch_message_released( uint8_t* message )
+{
+    const uint32_t message_index = (uint32_t)(message - watch_messages[0]) / DEBUG_WATCH_MESSAGE_SIZE;
+    if(message_index < DEBUG_WATCH_MESSAGE_BUFFERS_COUNT)
+    {
+        watch_messages_state[message_index] = WATCH_MESSAGE_FREE;
+    }
+}
+
+/*                                    Command handlers                                            */
+/**************************************************************************************************/
+
+/**
+ * @brief Sets the watch list. Payload: u16 - sample divider, u16 - entries per message, then entries of u32 - address and
+ *  u8 - DEBUG_DATA_TYPE. Payload without entries clears the list
+ */
+static void debug_watch_set_list_handler( const debug_itf_request* request, void* context, debug_itf_reply_cbk reply )
+{
+    (void)context;
+
+    if(request->payload_length < 4 || (request->payload_length - 4U) % 5U != 0 ||
+            (request->payload_length - 4U) / 5U > DEBUG_WATCH_MAX_ENTRIES_COUNT)
+    {
+        LOG_ERROR(6105); // Invalid watch list request length
+        reply(message_nack, sizeof(message_nack));
+        return;
+    }
+
+    const uint8_t entries_count = (uint8_t)((request->payload_length - 4U) / 5U);
+    if(entries_count == 0)
+    {
+        debug_watch_clear_list();
+        reply(message_ack, sizeof(message_ack));
+        return;
+    }
+
+    const uint16_t sample_divider = (uint16_t)(request->payload[0] | (request->payload[1] << 8));
+    const uint16_t entries_per_message = (uint16_t)(request->payload[2] | (request->payload[3] << 8));
+
+    debug_watch_entry entries[DEBUG_WATCH_MAX_ENTRIES_COUNT];
+    for(uint8_t i = 0; i < entries_count; i++)
+    {
+        const uint8_t* entry = &request->payload[4U + 5U * i];
+        entries[i].address = (uintptr_t)((uint32_t)entry[0] | ((uint32_t)entry[1] << 8) | ((uint32_t)entry[2] << 16) |
+                ((uint32_t)entry[3] << 24));
+        entries[i].type = entry[4];
+    }
+
+    if(debug_watch_set_list(entries, entries_count, entries_per_message, sample_divider) != 0)
+    {
+        reply(message_nack, sizeof(message_nack));
+        return;
+    }
+
+    reply(message_ack, sizeof(message_ack));
+}
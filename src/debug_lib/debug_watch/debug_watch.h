@@ -0,0 +1,108 @@
+// Description is in the end of the file
+#pragma once
+
+#ifndef DEBUG_WATCH_H_
+#define DEBUG_WATCH_H_
+
+#include <stdint.h>
+#include "../../debug_lib/debug_utils.h"
+
+// Include only if file is available. It can overwrite file configuration definitions
+#if defined __has_include
+    #if __has_include( <device_definitions.h> )
+        #include "device_definitions.h"
+    #endif
+#endif
+
+/**************************************************************************************************/
+/*                                                                                                */
+/*                                  Default file configurations                                   */
+/*                                                                                                */
+/**************************************************************************************************/
+
+#ifndef DEBUG_WATCH_MAX_ENTRIES_COUNT
+    #define DEBUG_WATCH_MAX_ENTRIES_COUNT           (16U) // Must not be bigger than DEBUG_MAX_STREAM_FIELDS_COUNT
+#endif
+
+// Size of a single stream message with samples. Entries per message requested by the client must fit into it
+#ifndef DEBUG_WATCH_MESSAGE_SIZE
+    #define DEBUG_WATCH_MESSAGE_SIZE                (256U)
+#endif
+
+// Full messages wait for transfer in these buffers, while samples are recorded into the next free one
+#ifndef DEBUG_WATCH_MESSAGE_BUFFERS_COUNT
+    #define DEBUG_WATCH_MESSAGE_BUFFERS_COUNT       (2U)
+#endif
+
+#ifndef DEBUG_WATCH_STREAM_ID
+    #define DEBUG_WATCH_STREAM_ID                   (0xE0U)
+#endif
+#ifndef DEBUG_WATCH_STREAM_TIMEOUT_MS
+    #define DEBUG_WATCH_STREAM_TIMEOUT_MS           (2000U)
+#endif
+
+/**************************************************************************************************/
+/*                                                                                                */
+/*                                     Global types declarations                                  */
+/*                                                                                                */
+/**************************************************************************************************/
+
+typedef struct debug_watch_entry
+{
+    uintptr_t address;
+    uint8_t type; // DEBUG_DATA_TYPE
+} debug_watch_entry;
+
+/**************************************************************************************************/
+/*                                                                                                */
+/*                                  Global functions declarations                                 */
+/*                                                                                                */
+/**************************************************************************************************/
+
+pif_error_code debug_watch_set_list( const debug_watch_entry* entries, uint8_t entries_count, uint16_t entries_per_message,
+        uint16_t sample_divider );
+void debug_watch_clear_list( void );
+
+void debug_watch_sample( void );
+uint32_t debug_watch_get_dropped_samples_count( void );
+
+pif_error_code debug_watch_register_commands( void );
+
+/**************************************************************************************************/
+/*                                                                                                */
+/*                                      Static error handing                                      */
+/*                                                                                                */
+/**************************************************************************************************/
+
+#if DEBUG_WATCH_MAX_ENTRIES_COUNT < 1 || DEBUG_WATCH_MAX_ENTRIES_COUNT > DEBUG_MAX_STREAM_FIELDS_COUNT
+    #error "DEBUG_WATCH_MAX_ENTRIES_COUNT must be > 0 and not bigger than DEBUG_MAX_STREAM_FIELDS_COUNT"
+#endif
+
+#if DEBUG_WATCH_MESSAGE_SIZE < 4 || DEBUG_WATCH_MESSAGE_SIZE > UINT16_MAX
+    #error "DEBUG_WATCH_MESSAGE_SIZE must be >= 4 and fit into u16. Change DEBUG_WATCH_MESSAGE_SIZE value accordingly"
+#endif
+
+#if DEBUG_WATCH_MESSAGE_BUFFERS_COUNT < 1 || DEBUG_WATCH_MESSAGE_BUFFERS_COUNT > 255
+    #error "DEBUG_WATCH_MESSAGE_BUFFERS_COUNT must be > 0 and < 256. Change DEBUG_WATCH_MESSAGE_BUFFERS_COUNT value accordingly"
+#endif
+
+#if DEBUG_WATCH_STREAM_ID == 0 || DEBUG_WATCH_STREAM_ID > 255
+    #error "DEBUG_WATCH_STREAM_ID must be from 1 to 255, as stream id 0 means that no stream is registered"
+#endif
+
+#endif /* DEBUG_WATCH_H_ */
+
+/**
+ * Watch list: a stream that is defined by the client at runtime instead of a debug_com_stream written into the firmware.
+ *
+ * Client resolves variable names into addresses and types (for example from the firmware ELF file), and uploads the list with
+ *  DEBUG_ITF_SET_WATCH_LIST_Code request. Every entry must be readable through debug_memory regions. The list is registered as
+ *  the active stream, so it is started, read and stopped with the usual streaming requests.
+ *
+ * debug_watch_sample() must be called periodically (like from a timer interrupt). Every sample_divider-th call reads all entries
+ *  inside a single critical section, so values of a single sample belong together. Entries are checked against debug_memory
+ *  regions when the list is set, so the critical section only copies them. Watch list must be cleared before regions are removed. A message is queued as soon as it holds
+ *  entries_per_message samples. Samples that find no free message buffer are dropped and counted.
+ *
+ * Watch list can't be set while another stream is registered.
+ */
@@ -20,12 +20,21 @@ static struct {
 // TODO Not sure what the optimal value should be here. Set to 8 for
 // easier debugging with smaller buffer.
 #define STREAM_BUFFER_LENGTH        8
-// Double buffer for storing profiling events in stream mode.
-static profiling_event profiling_stream_buffer_a[STREAM_BUFFER_LENGTH];
-static profiling_event profiling_stream_buffer_b[STREAM_BUFFER_LENGTH];
-static profiling_event* record_stream_buffer = profiling_stream_buffer_a;
+
+// States of a stream buffer from the pool
+#define STREAM_BUFFER_FREE          0 // Can be taken for recording
+#define STREAM_BUFFER_RECORDING     1 // New events are saved into it
+#define STREAM_BUFFER_QUEUED        2 // Owned by debug interface until it is released
+
+// Pool of buffers for storing profiling events in stream mode.
+static profiling_event profiling_stream_buffers[PROFILING_STREAM_BUFFERS_COUNT][STREAM_BUFFER_LENGTH];
+static volatile uint8_t profiling_stream_buffers_state[PROFILING_STREAM_BUFFERS_COUNT];
+// Null pointer when all buffers are in flight
+static profiling_event* record_stream_buffer = (void*)(0);
 // Index of the next free slot in the current stream buffer.
 static uint8_t buf_index = 0;
+// Number of events that were lost because no buffer was free or debug interface refused to queue a full buffer
+static uint32_t dropped_stream_events_count = 0;
 
 static debug_com_stream profiling_stream =
 {
@@ -47,6 +56,10 @@ static debug_com_stream profiling_stream =
 
 static inline void profiling_debug_buffer_save(profiling_event* profiling_event_instance);
 static inline void profiling_debug_stream_save(profiling_event* profiling_event_instance);
+#ifdef DEBUG_ENABLE_PROFILING
+static profiling_event* profiling_take_free_stream_buffer( void );
+static void profiling_stream_buffer_released( uint8_t* message );
+#endif
 
 /**************************************************************************************************/
 /*                                                                                                */
@@ -100,7 +113,9 @@ void setup_profiling_stream_tracing( void )
 #ifdef DEBUG_ENABLE_PROFILING
     profiling_enable_dwt_counter();
 
-    profiling_stream.message = profiling_stream_buffer_a;
+    record_stream_buffer = profiling_take_free_stream_buffer();
+    profiling_stream.message = record_stream_buffer;
+    profiling_stream.message_released_cbk = profiling_stream_buffer_released;
 
     debug_register_com_stream(&profiling_stream);
 #endif
@@ -179,6 +194,22 @@ void profiling_stream_trace_event_end(profiling_event* profiling_event_instance)
 #endif
 }
 
+
+/**
+ * @brief Returns number of stream events that were dropped because all stream buffers were in flight, or debug interface
+ *  TX queue was full.
+ *
+ * Growing value means that events are generated faster than UART can send them.
+ */
+uint32_t profiling_get_dropped_stream_events_count( void )
+{
+#ifdef DEBUG_ENABLE_PROFILING
+    return dropped_stream_events_count;
+#else
+    return 0;
+#endif
+}
+
 /**************************************************************************************************/
 /*                                                                                                */
 /*                                Static functions implementations                                */
@@ -197,16 +228,16 @@ void profiling_stream_trace_event_end(profiling_event* profiling_event_instance)
 static inline void profiling_debug_buffer_save(profiling_event* profiling_event_instance)
 {
 #ifdef DEBUG_ENABLE_PROFILING
-    debug_add_value_to_u32_buffer(&profiling_buffer.start_stamp,
+    debug_add_value_to_u32_buffer_inline(&profiling_buffer.start_stamp,
             profiling_event_instance->start_stamp);
 
-    debug_add_value_to_u32_buffer(&profiling_buffer.duration,
+    debug_add_value_to_u32_buffer_inline(&profiling_buffer.duration,
             profiling_event_instance->duration);
 
-    debug_add_value_to_u32_buffer(&profiling_buffer.thread_id,
+    debug_add_value_to_u32_buffer_inline(&profiling_buffer.thread_id,
             profiling_event_instance->thread_id);
 
-    debug_add_value_to_u16_buffer(&profiling_buffer.name_id,
+    debug_add_value_to_u16_buffer_inline(&profiling_buffer.name_id,
             profiling_event_instance->name_id);
 #endif
 }
@@ -216,14 +247,25 @@ static inline void profiling_debug_buffer_save(profiling_event* profiling_event_
  * @brief Save a profiling event to the stream buffer.
  *
  * This function writes a profiling event instance into the current
- * record in the stream buffer. When the buffer is full, it swaps
- * buffers and triggers the debug system to send the collected data.
+ * record in the stream buffer. When the buffer is full, it is handed
+ * over to the debug system and a free buffer is taken from the pool.
+ * Buffer returns to the pool when the debug system releases it.
  *
  * @param[in] profiling_event_instance Pointer to the profiling event to save.
  */
 static inline void profiling_debug_stream_save(profiling_event* profiling_event_instance)
 {
 #ifdef DEBUG_ENABLE_PROFILING
+    if(record_stream_buffer == (void*)(0))
+    {
+        record_stream_buffer = profiling_take_free_stream_buffer();
+        if(record_stream_buffer == (void*)(0))
+        {
+            dropped_stream_events_count += 1;
+            return;
+        }
+    }
+
     // Get pointer to current record in stream buffer
     profiling_event* buf = &record_stream_buffer[buf_index];
 
@@ -236,27 +278,74 @@ static inline void profiling_debug_stream_save(profiling_event* profiling_event_
     // Increment buffer index and wrap around if needed
     buf_index += 1;
 
-    // If buffer is full, swap buffers and notify debug system
+    // If buffer is full, hand it over to the debug system and take the next one
     if(buf_index == STREAM_BUFFER_LENGTH)
     {
         buf_index = 0;
-        if(record_stream_buffer == profiling_stream_buffer_a)
-        {
-            profiling_stream.message = profiling_stream_buffer_a;
-            record_stream_buffer = profiling_stream_buffer_b;
-        }else
+
+        // State is changed before queueing, as debug system can release the buffer before debug_update_com_stream() returns
+        const uint8_t buffer_id = (record_stream_buffer - profiling_stream_buffers[0]) / STREAM_BUFFER_LENGTH;
+        profiling_stream_buffers_state[buffer_id] = STREAM_BUFFER_QUEUED;
+        profiling_stream.message = record_stream_buffer;
+
+        // Trigger the debug system to update the stream
+        const pif_error_code update_error = debug_update_com_stream();
+        if(update_error != 0)
         {
-            profiling_stream.message = profiling_stream_buffer_b;
-            record_stream_buffer = profiling_stream_buffer_a;
+            // Buffer wasn't queued, so it is still ours and is recorded again
+            profiling_stream_buffers_state[buffer_id] = STREAM_BUFFER_RECORDING;
+            if(update_error != 4220) // Events are not lost if nobody is subscribed to the stream
+            {
+                dropped_stream_events_count += STREAM_BUFFER_LENGTH;
+            }
+            return;
         }
 
-        // Trigger the debug system to update the stream
-        debug_update_com_stream();
+        record_stream_buffer = profiling_take_free_stream_buffer();
+#if PROFILING_STREAM_FULL_POLICY == PROFILING_STREAM_WAIT_FOR_BUFFER
+        const uint32_t wait_start_stamp = DWT->CYCCNT;
+        while(record_stream_buffer == (void*)(0) && DWT->CYCCNT - wait_start_stamp < PROFILING_STREAM_WAIT_TIMEOUT_CYCLES)
+        {
+            record_stream_buffer = profiling_take_free_stream_buffer();
+        }
+#endif
     }
 #endif
 }
 
 
+#ifdef DEBUG_ENABLE_PROFILING
+/**
+ * @brief Takes a free buffer from the stream buffers pool.
+ *
+ * @return pointer to the buffer, or null pointer if all buffers are in flight
+ */
+static profiling_event* profiling_take_free_stream_buffer( void )
+{
+    for(uint8_t i = 0; i < PROFILING_STREAM_BUFFERS_COUNT; i++)
+    {
+        if(profiling_stream_buffers_state[i] == STREAM_BUFFER_FREE)
+        {
+            profiling_stream_buffers_state[i] = STREAM_BUFFER_RECORDING;
+            return profiling_stream_buffers[i];
+        }
+    }
+
+    return (void*)(0);
+}
+
+
+/**
+ * @brief Returns stream buffer to the pool. Called by the debug system when buffer data was sent or copied.
+ */
+static void profiling_stream_buffer_released( uint8_t* message )
+{
+    const uint8_t buffer_id = ((profiling_event*)message - profiling_stream_buffers[0]) / STREAM_BUFFER_LENGTH;
+    profiling_stream_buffers_state[buffer_id] = STREAM_BUFFER_FREE;
+}
+#endif
+
+
 /**************************************************************************************************/
 /*                                                                                                */
 /*                                          Unused code                                           */
@@ -9,6 +9,29 @@
 #include "../debug_lib/debug_utils.h"
 
 
+/**************************************************************************************************/
+/*                                                                                                */
+/*                                      File configuration                                        */
+/*                                                                                                */
+/**************************************************************************************************/
+
+// Number of stream buffers in the pool. One buffer is filled with new events while the others wait in the debug TX queue
+//  or are being sent. Buffer returns to the pool only after debug interface releases it, so data is never overwritten
+//  while it is sent.
+#ifndef PROFILING_STREAM_BUFFERS_COUNT
+    #define PROFILING_STREAM_BUFFERS_COUNT          (3U) // Must not be smaller than 2
+#endif
+
+// What to do with new events when all stream buffers are in flight
+#define PROFILING_STREAM_DROP_EVENTS                (0U) // New events are dropped and counted until a buffer is released
+#define PROFILING_STREAM_WAIT_FOR_BUFFER            (1U) // Wait up to PROFILING_STREAM_WAIT_TIMEOUT_CYCLES for a buffer to be released.
+                                                         //  Must not be used for events from interrupts with higher priority than TX DMA
+#ifndef PROFILING_STREAM_FULL_POLICY
+    #define PROFILING_STREAM_FULL_POLICY            PROFILING_STREAM_DROP_EVENTS
+#endif
+#ifndef PROFILING_STREAM_WAIT_TIMEOUT_CYCLES
+    #define PROFILING_STREAM_WAIT_TIMEOUT_CYCLES    (100000U)
+#endif
 
 /**************************************************************************************************/
 /*                                                                                                */
@@ -42,6 +65,7 @@ void profiling_buffer_trace_event_end(profiling_event* profiling_event_instance)
 
 void profiling_stream_trace_event_begin(profiling_event* profiling_event_instance);
 void profiling_stream_trace_event_end(profiling_event* profiling_event_instance);
+uint32_t profiling_get_dropped_stream_events_count( void );
 
 
 /**************************************************************************************************/
@@ -67,6 +91,16 @@ static inline void profiling_save_current_dwt_clock_cycle( uint32_t* save_target
 
 
 
+/**************************************************************************************************/
+/*                                                                                                */
+/*                                      Static error handing                                      */
+/*                                                                                                */
+/**************************************************************************************************/
+
+#if PROFILING_STREAM_BUFFERS_COUNT < 2
+    #error "PROFILING_STREAM_BUFFERS_COUNT must be >= 2, so events can be saved while a buffer is sent"
+#endif
+
 #endif /* PROFILING_PIF_H_ */
 
 /**
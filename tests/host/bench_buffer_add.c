@@ -0,0 +1,141 @@
+/**
+ * Cycles per value added to debug buffers with the inline debug_add_value_to_<type>_buffer_inline() and with the out of line
+ *  debug_add_value_to_<type>_buffer() of debug_utils.c, which is a real call as the library is built without LTO.
+ *
+ * Every sample adds one value to each of four buffers of different types, like a control loop that records its state. Buffers
+ *  are measured while they are written (circular, so they never get full) and while they are frozen, which is the path taken
+ *  while a buffer is sent or held by a trigger. The best of several runs is taken. Cycles are read with the time stamp counter
+ *  on x86; on other machines nanoseconds are reported instead. On Cortex-M the difference must be measured with DWT.
+ */
+#include "debug_lib/debug_utils.h"
+
+#include <stdio.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+    #include <x86intrin.h>
+#endif
+
+#define BENCH_RUNS_COUNT                (31U)
+#define BENCH_SAMPLES_PER_RUN           (1000000U)
+#define BENCH_VALUES_PER_SAMPLE         (4U)
+
+static debug_f32_buffer f32_buffer;
+static debug_i32_buffer i32_buffer;
+static debug_u16_buffer u16_buffer;
+static debug_u8_buffer u8_buffer;
+
+/**************************************************************************************************/
+/*                                          Measurement                                           */
+/**************************************************************************************************/
+
+static uint64_t bench_now( void )
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+#endif
+}
+
+
+static void bench_add_inline( uint32_t sample )
+{
+    debug_add_value_to_f32_buffer_inline(&f32_buffer, (float)sample * 0.5f);
+    debug_add_value_to_i32_buffer_inline(&i32_buffer, (int32_t)sample);
+    debug_add_value_to_u16_buffer_inline(&u16_buffer, (uint16_t)sample);
+    debug_add_value_to_u8_buffer_inline(&u8_buffer, (uint8_t)sample);
+}
+
+
+static void bench_add_out_of_line( uint32_t sample )
+{
+    debug_add_value_to_f32_buffer(&f32_buffer, (float)sample * 0.5f);
+    debug_add_value_to_i32_buffer(&i32_buffer, (int32_t)sample);
+    debug_add_value_to_u16_buffer(&u16_buffer, (uint16_t)sample);
+    debug_add_value_to_u8_buffer(&u8_buffer, (uint8_t)sample);
+}
+
+
+/**
+ * @brief Adds BENCH_SAMPLES_PER_RUN samples. Sample function is inlined into the loop, as the control loop would be
+ *
+ * @return Cycles (or nanoseconds) per added value
+ */
+static inline __attribute__((always_inline)) double bench_run( void (*add_sample)( uint32_t sample ) )
+{
+    const uint64_t start = bench_now();
+    for(uint32_t sample = 0; sample < BENCH_SAMPLES_PER_RUN; sample++)
+    {
+        add_sample(sample);
+        // Rest of the control loop writes memory too, so buffer state can't be kept in registers across samples
+        __asm__ volatile("" ::: "memory");
+    }
+    return (double)(bench_now() - start) / ((double)BENCH_SAMPLES_PER_RUN * BENCH_VALUES_PER_SAMPLE);
+}
+
+
+/**
+ * @brief Runs both versions one after another, so they see the same machine load, and prints the best run of each
+ */
+static void bench_compare( const char* name )
+{
+    double best_inline = 0;
+    double best_out_of_line = 0;
+    for(uint32_t run = 0; run < BENCH_RUNS_COUNT; run++)
+    {
+        const double inline_per_value = bench_run(bench_add_inline);
+        const double out_of_line_per_value = bench_run(bench_add_out_of_line);
+        if(run == 0 || inline_per_value < best_inline)
+        {
+            best_inline = inline_per_value;
+        }
+        if(run == 0 || out_of_line_per_value < best_out_of_line)
+        {
+            best_out_of_line = out_of_line_per_value;
+        }
+    }
+    printf("%10s %12.2f %12.2f\n", name, best_inline, best_out_of_line);
+}
+
+
+static void bench_set_frozen( uint8_t is_frozen )
+{
+    f32_buffer.state.is_frozen = is_frozen;
+    i32_buffer.state.is_frozen = is_frozen;
+    u16_buffer.state.is_frozen = is_frozen;
+    u8_buffer.state.is_frozen = is_frozen;
+}
+
+
+int main( void )
+{
+    debug_set_buffer_circular(&f32_buffer, F32_Type, 1);
+    debug_set_buffer_circular(&i32_buffer, I32_Type, 1);
+    debug_set_buffer_circular(&u16_buffer, U16_Type, 1);
+    debug_set_buffer_circular(&u8_buffer, U8_Type, 1);
+
+    // Both versions must leave the buffers in the same state
+    bench_add_inline(1U);
+    const uint16_t inline_index = u8_buffer.state.next_write_index;
+    bench_add_out_of_line(2U);
+    if(u8_buffer.state.next_write_index != inline_index + 1U || u8_buffer.values[inline_index] != 2U ||
+            f32_buffer.values[inline_index] != 1.0f)
+    {
+        printf("FAIL: out of line add differs from inline add\n");
+        return 1;
+    }
+
+#if defined(__x86_64__) || defined(__i386__)
+    printf("Cycles per added value (TSC), best of %u runs, %u buffers per sample\n", BENCH_RUNS_COUNT, BENCH_VALUES_PER_SAMPLE);
+#else
+    printf("Nanoseconds per added value, best of %u runs, %u buffers per sample\n", BENCH_RUNS_COUNT, BENCH_VALUES_PER_SAMPLE);
+#endif
+    printf("%10s %12s %12s\n", "buffers", "inline", "out of line");
+
+    bench_compare("written");
+    bench_set_frozen(1U);
+    bench_compare("frozen");
+    return 0;
+}
@@ -0,0 +1,164 @@
+/**
+ * Cycles per byte of the software CRCs of debug_crc.c, compared with plain bit by bit versions of the same CRCs.
+ *
+ * Every function is run over frames of typical debug protocol lengths. The best of several runs is taken, so the result shows
+ *  the cost of the algorithm and not of preemption. Cycles are read with the time stamp counter on x86; on other machines
+ *  nanoseconds are reported instead. Host numbers only compare the algorithms, on Cortex-M they must be measured with DWT.
+ */
+#include "debug_lib/debug_crc/debug_crc.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+    #include <x86intrin.h>
+#endif
+
+#define BENCH_RUNS_COUNT                (15U)
+#define BENCH_BYTES_PER_RUN             (1024U * 1024U)
+#define BENCH_MAX_FRAME_LENGTH          (2048U)
+
+static uint8_t frame[BENCH_MAX_FRAME_LENGTH];
+static volatile uint32_t crc_sink; // Keeps the compiler from removing the benchmarked calls
+
+/**************************************************************************************************/
+/*                                      Reference versions                                        */
+/**************************************************************************************************/
+
+static uint16_t bench_crc16_bitwise( uint16_t crc, const uint8_t* data, uint32_t length )
+{
+    for(uint32_t i = 0; i < length; i++)
+    {
+        crc ^= (uint16_t)(data[i] << 8);
+        for(uint8_t bit = 0; bit < 8U; bit++)
+        {
+            crc = (crc & 0x8000U) ? (uint16_t)((crc << 1) ^ 0x1021U) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+
+static uint32_t bench_crc32_bitwise( uint32_t crc, const uint8_t* data, uint32_t length )
+{
+    for(uint32_t i = 0; i < length; i++)
+    {
+        crc ^= data[i];
+        for(uint8_t bit = 0; bit < 8U; bit++)
+        {
+            crc = (crc & 1U) ? ((crc >> 1) ^ 0xEDB88320U) : (crc >> 1);
+        }
+    }
+    return crc;
+}
+
+
+static uint32_t bench_crc16_software( uint32_t crc, const uint8_t* data, uint32_t length )
+{
+    return debug_crc16_software_update((uint16_t)crc, data, length);
+}
+
+
+static uint32_t bench_crc16_reference( uint32_t crc, const uint8_t* data, uint32_t length )
+{
+    return bench_crc16_bitwise((uint16_t)crc, data, length);
+}
+
+/**************************************************************************************************/
+/*                                          Measurement                                           */
+/**************************************************************************************************/
+
+static uint64_t bench_now( void )
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+#endif
+}
+
+
+/**
+ * @brief Runs CRC over BENCH_BYTES_PER_RUN bytes in frames of frame_length bytes
+ *
+ * @return Best cycles (or nanoseconds) per byte of all runs
+ */
+static double bench_measure( uint32_t (*crc_update)( uint32_t crc, const uint8_t* data, uint32_t length ), uint32_t init,
+        uint32_t frame_length )
+{
+    const uint32_t frames_count = BENCH_BYTES_PER_RUN / frame_length;
+    double best = 0;
+    for(uint32_t run = 0; run < BENCH_RUNS_COUNT; run++)
+    {
+        // Every frame continues the previous CRC, so the CPU can't overlap independent short frames
+        uint32_t crc = init;
+        const uint64_t start = bench_now();
+        for(uint32_t i = 0; i < frames_count; i++)
+        {
+            crc = crc_update(crc, frame, frame_length);
+        }
+        crc_sink = crc;
+        const double per_byte = (double)(bench_now() - start) / ((double)frames_count * frame_length);
+        if(run == 0 || per_byte < best)
+        {
+            best = per_byte;
+        }
+    }
+    return best;
+}
+
+
+static int bench_check( void )
+{
+    const uint8_t check_data[9] = { '1', '2', '3', '4', '5', '6', '7', '8', '9' };
+    if(debug_crc16_software_update(DEBUG_CRC16_INIT, check_data, 9) != 0x29B1U ||
+            (debug_crc32_software_update(DEBUG_CRC32_INIT, check_data, 9) ^ DEBUG_CRC32_FINAL_XOR) != 0xCBF43926U)
+    {
+        printf("FAIL: wrong check value of the software CRC\n");
+        return 1;
+    }
+
+    if(debug_crc16_software_update(DEBUG_CRC16_INIT, frame, BENCH_MAX_FRAME_LENGTH) !=
+            bench_crc16_bitwise(DEBUG_CRC16_INIT, frame, BENCH_MAX_FRAME_LENGTH) ||
+            debug_crc32_software_update(DEBUG_CRC32_INIT, frame, BENCH_MAX_FRAME_LENGTH) !=
+            bench_crc32_bitwise(DEBUG_CRC32_INIT, frame, BENCH_MAX_FRAME_LENGTH))
+    {
+        printf("FAIL: software CRC differs from bit by bit CRC\n");
+        return 1;
+    }
+    return 0;
+}
+
+
+int main( void )
+{
+    srand(1);
+    for(uint32_t i = 0; i < BENCH_MAX_FRAME_LENGTH; i++)
+    {
+        frame[i] = (uint8_t)rand();
+    }
+
+    if(bench_check() != 0)
+    {
+        return 1;
+    }
+
+    const uint32_t frame_lengths[4] = { 16U, 64U, 400U, 2048U };
+#if defined(__x86_64__) || defined(__i386__)
+    printf("Cycles per byte (TSC), best of %u runs\n", BENCH_RUNS_COUNT);
+#else
+    printf("Nanoseconds per byte, best of %u runs\n", BENCH_RUNS_COUNT);
+#endif
+    printf("%8s %14s %14s %14s %14s\n", "frame", "crc16 table", "crc16 bitwise", "crc32 slice4", "crc32 bitwise");
+    for(uint32_t i = 0; i < 4U; i++)
+    {
+        printf("%8u %14.2f %14.2f %14.2f %14.2f\n", frame_lengths[i],
+                bench_measure(bench_crc16_software, DEBUG_CRC16_INIT, frame_lengths[i]),
+                bench_measure(bench_crc16_reference, DEBUG_CRC16_INIT, frame_lengths[i]),
+                bench_measure(debug_crc32_software_update, DEBUG_CRC32_INIT, frame_lengths[i]),
+                bench_measure(bench_crc32_bitwise, DEBUG_CRC32_INIT, frame_lengths[i]));
+    }
+    return 0;
+}
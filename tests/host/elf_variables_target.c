@@ -0,0 +1,77 @@
+/**
+ * Firmware stand-in for test_elf_variables.py, which resolves its variables with python_debug_logger/helper_scripts/elf_variables.py.
+ *
+ * Every resolvable expression is printed as "<expression> <offset> <data type> <size>", where the offset is taken from the
+ *  address of the variable that starts the expression. The test adds it to the address of the variable reported by nm, so the
+ *  resolver is checked against the compiler and not against a second copy of the layout.
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Values of BUFFER_TYPE / DEBUG_DATA_TYPE
+#define TARGET_F32_TYPE                 (1U)
+#define TARGET_I32_TYPE                 (2U)
+#define TARGET_U32_TYPE                 (3U)
+#define TARGET_I16_TYPE                 (4U)
+#define TARGET_U16_TYPE                 (5U)
+#define TARGET_U8_TYPE                  (6U)
+
+typedef struct
+{
+    float d;
+    float q;
+} target_dq;
+
+typedef struct
+{
+    uint8_t state;
+    int16_t speed;
+    uint8_t padding[300];       // Offsets of the following members need two ULEB128 bytes and are over 255
+    volatile uint32_t ticks;
+    const target_dq currents[3];
+    int32_t table[2][3];
+} target_motor;
+
+// Declared first and defined later, so the definition refers to the declaration with DW_AT_specification
+extern uint16_t target_declared_first;
+extern target_motor target_motor_state;
+
+uint16_t target_declared_first = 7U;
+target_motor target_motor_state = { .state = 1U };
+int16_t target_matrix[4][5][2];
+uint8_t target_flag;
+static volatile float target_gain = 1.5f; // Kept by volatile, as it is never written
+
+/**************************************************************************************************/
+/*                                           Printing                                             */
+/**************************************************************************************************/
+
+static void target_print( const char* expression, const volatile void* variable, const volatile void* value, uint32_t data_type,
+        size_t size )
+{
+    printf("%s %zu %u %zu\n", expression, (size_t)((const volatile uint8_t*)value - (const volatile uint8_t*)variable), data_type, size);
+}
+
+
+int main( void )
+{
+    target_print("target_declared_first", &target_declared_first, &target_declared_first, TARGET_U16_TYPE, 2U);
+    target_print("target_flag", &target_flag, &target_flag, TARGET_U8_TYPE, 1U);
+    target_print("target_gain", &target_gain, &target_gain, TARGET_F32_TYPE, 4U);
+
+    target_print("target_motor_state.state", &target_motor_state, &target_motor_state.state, TARGET_U8_TYPE, 1U);
+    target_print("target_motor_state.speed", &target_motor_state, &target_motor_state.speed, TARGET_I16_TYPE, 2U);
+    target_print("target_motor_state.padding[299]", &target_motor_state, &target_motor_state.padding[299], TARGET_U8_TYPE, 1U);
+    target_print("target_motor_state.ticks", &target_motor_state, &target_motor_state.ticks, TARGET_U32_TYPE, 4U);
+    target_print("target_motor_state.currents[0].d", &target_motor_state, &target_motor_state.currents[0].d, TARGET_F32_TYPE, 4U);
+    target_print("target_motor_state.currents[2].q", &target_motor_state, &target_motor_state.currents[2].q, TARGET_F32_TYPE, 4U);
+    target_print("target_motor_state.table[0][0]", &target_motor_state, &target_motor_state.table[0][0], TARGET_I32_TYPE, 4U);
+    target_print("target_motor_state.table[1][2]", &target_motor_state, &target_motor_state.table[1][2], TARGET_I32_TYPE, 4U);
+
+    target_print("target_matrix[0][0][0]", target_matrix, &target_matrix[0][0][0], TARGET_I16_TYPE, 2U);
+    target_print("target_matrix[1][0][1]", target_matrix, &target_matrix[1][0][1], TARGET_I16_TYPE, 2U);
+    target_print("target_matrix[3][4][1]", target_matrix, &target_matrix[3][4][1], TARGET_I16_TYPE, 2U);
+    target_print("target_matrix[2][3][0]", target_matrix, &target_matrix[2][3][0], TARGET_I16_TYPE, 2U);
+    return 0;
+}
@@ -0,0 +1,73 @@
+# Checks python_debug_logger/helper_scripts/elf_variables.py on ELF files of elf_variables_target.c.
+# Usage: test_elf_variables.py <elf> [<elf> ...]. Every ELF is run to print the expected offsets, data types and sizes, and
+#  nm gives the addresses of the variables. Needs pyelftools (pip install pyelftools); without it the check is skipped.
+
+import os
+import subprocess
+import sys
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "..", "python_debug_logger"))
+
+try:
+    from helper_scripts import elf_variables
+except ImportError as error:
+    print(f"SKIP: ELF resolver is not checked, {error}")
+    sys.exit(0)
+
+# Expressions that must be refused, as the debug protocol can't read them
+INVALID_EXPRESSIONS = (
+    "target_motor_state",               # Struct, not a basic value
+    "target_motor_state.table[1]",      # Row of a two dimensional array
+    "target_motor_state.currents[3].d", # Out of bounds
+    "target_matrix[1][5][0]",           # Out of bounds in inner dimension
+    "target_motor_state.voltage",       # No such member
+    "target_flag.state",                # Member of a value that is not a struct
+    "target_gain[0]",                   # Element of a value that is not an array
+    "target_missing",
+)
+
+def nm_addresses(elf_path: str):
+    output = subprocess.run(["nm", elf_path], check=True, capture_output=True, text=True).stdout
+    addresses = {}
+    for line in output.splitlines():
+        fields = line.split()
+        if (len(fields) == 3):
+            addresses[fields[2]] = int(fields[0], 16)
+    return addresses
+
+def check_elf(elf_path: str):
+    """Returns count of failed checks"""
+    expected = subprocess.run([elf_path], check=True, capture_output=True, text=True).stdout
+    addresses = nm_addresses(elf_path)
+    variables = elf_variables.ElfVariables(elf_path)
+    failures = 0
+
+    for line in expected.splitlines():
+        expression, offset, data_type, size = line.split()
+        name = expression.split(".")[0].split("[")[0]
+        expected_result = (addresses[name] + int(offset), int(data_type), int(size))
+        try:
+            result = variables.resolve(expression)
+        except ValueError as error:
+            result = str(error)
+        if (result != expected_result):
+            print(f"FAIL: {elf_path}: {expression} resolved to {result}, expected {expected_result}")
+            failures += 1
+
+    for expression in INVALID_EXPRESSIONS:
+        try:
+            result = variables.resolve(expression)
+            print(f"FAIL: {elf_path}: {expression} resolved to {result}, expected ValueError")
+            failures += 1
+        except ValueError:
+            pass
+
+    if (failures == 0):
+        print(f"PASS: {elf_path}: {len(expected.splitlines())} expressions resolved, {len(INVALID_EXPRESSIONS)} refused")
+    return failures
+
+if __name__ == "__main__":
+    failures = 0
+    for elf_path in sys.argv[1:]:
+        failures += check_elf(elf_path)
+    sys.exit(1 if failures != 0 else 0)
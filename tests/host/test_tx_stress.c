@@ -0,0 +1,377 @@
+/**
+ * Producer/consumer stress test of the TX queue with the host critical sections of debug_port.h.
+ *
+ * Several producer threads queue numbered messages into both lanes at the same time, while the consumer thread plays the
+ *  role of UART DMA and TX complete interrupt: it copies every transfer given to send() into a received byte stream and
+ *  calls debug_handle_tx(). The consumer queues messages too, like an interrupt that preempts the producers would.
+ *
+ * Afterwards the received stream is parsed. Every accepted message must arrive exactly once, unchanged and in order per
+ *  producer, and link telemetry and lane statistics must match what producers and consumer counted themselves.
+ *
+ * With STRESS_DROP_OLDEST defined, bulk lane uses DEBUG_ITF_TX_DROP_OLDEST and every message is queued with a CRC-16 frame
+ *  trailer, so it is a group of two. Transfers are shorter than most messages, so groups are dropped while the head is partially
+ *  sent. Bulk messages may then be missing, but every received message must still be whole and followed by its own trailer.
+ */
+#include "debug_lib/debug_utils.h"
+#include "debug_lib/debug_crc/debug_crc.h"
+#include "debug_lib/debug_protocol/debug_protocol.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define PRODUCERS_COUNT                 (4U)
+#define INTERRUPT_PRODUCER_ID           PRODUCERS_COUNT
+#define SOURCES_COUNT                   (PRODUCERS_COUNT + 1U)
+#define TEST_DURATION_MS                (2000U)
+#define MAX_MESSAGES_PER_PRODUCER       (200000U) // Bounds the received stream on fast multi-core machines
+#define MESSAGE_SLOTS_COUNT             (8U)
+#define MAX_MESSAGE_LENGTH              (64U)
+#define HEADER_LENGTH                   (8U)
+#define RECEIVED_STREAM_SIZE            (64U * 1024U * 1024U)
+#ifdef STRESS_DROP_OLDEST
+    #define MESSAGE_ENTRIES_COUNT       (2U) // Message and its frame CRC trailer
+    #define TRAILER_LENGTH              (2U)
+#else
+    #define MESSAGE_ENTRIES_COUNT       (1U)
+    #define TRAILER_LENGTH              (0U)
+#endif
+
+// Message: 0xAA 0x55, u8 - source id, u8 - length, u32 - sequence number, pattern bytes that depend on all of them
+static uint8_t message_slots[SOURCES_COUNT][MESSAGE_SLOTS_COUNT][MAX_MESSAGE_LENGTH];
+static volatile uint8_t message_slot_is_queued[SOURCES_COUNT][MESSAGE_SLOTS_COUNT];
+
+static uint32_t accepted_count[SOURCES_COUNT];
+static uint32_t refused_count[SOURCES_COUNT];
+static uint32_t accepted_per_lane[DEBUG_ITF_TX_LANES_COUNT];
+static uint32_t refused_per_lane[DEBUG_ITF_TX_LANES_COUNT];
+static uint32_t received_count[SOURCES_COUNT];
+static uint32_t missing_per_lane[DEBUG_ITF_TX_LANES_COUNT]; // Accepted messages that never arrived, so were dropped
+
+static uint8_t* received_stream;
+static uint32_t received_length = 0;
+static uint32_t transfers_count = 0;
+
+static const uint8_t* volatile pending_transfer = (void*)(0);
+static volatile uint32_t pending_transfer_length = 0;
+static volatile uint32_t producers_running = PRODUCERS_COUNT;
+static struct timespec test_end_time;
+
+/**************************************************************************************************/
+/*                                      Transport simulation                                      */
+/**************************************************************************************************/
+
+static void stress_send( const uint8_t* data, const uint32_t length )
+{
+    if(pending_transfer != (void*)(0))
+    {
+        printf("FAIL: transfer started while the previous one is in flight\n");
+        exit(1);
+    }
+    pending_transfer_length = length;
+    __atomic_store_n(&pending_transfer, data, __ATOMIC_RELEASE);
+}
+
+static uint32_t stress_get_cycle_count( void )
+{
+    return 0;
+}
+
+static const debug_transport stress_transport =
+{
+        .send = stress_send,
+        .get_cycle_count = stress_get_cycle_count,
+};
+
+/**************************************************************************************************/
+/*                                          Producers                                             */
+/**************************************************************************************************/
+
+static uint8_t pattern_byte( uint32_t source, uint32_t sequence, uint32_t position )
+{
+    return (uint8_t)(sequence * 31U + source * 7U + position * 13U);
+}
+
+static void message_released( uint8_t* message )
+{
+    const uint32_t slot_index = (uint32_t)((message - &message_slots[0][0][0]) / MAX_MESSAGE_LENGTH);
+    __atomic_store_n(&message_slot_is_queued[slot_index / MESSAGE_SLOTS_COUNT][slot_index % MESSAGE_SLOTS_COUNT], 0,
+            __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Queues the next message of the source, if it has a free slot
+ *
+ * @return 1 if message was accepted
+ */
+static uint8_t queue_next_message( uint32_t source, DEBUG_ITF_TX_LANE lane_id, uint32_t* slot_index )
+{
+    if(__atomic_load_n(&message_slot_is_queued[source][*slot_index], __ATOMIC_ACQUIRE) != 0)
+    {
+        return 0; // Previous message from this slot wasn't sent yet
+    }
+
+    uint8_t* message = message_slots[source][*slot_index];
+    const uint32_t sequence = accepted_count[source];
+    const uint8_t length = (uint8_t)(HEADER_LENGTH + (sequence * 11U + source) % (MAX_MESSAGE_LENGTH - HEADER_LENGTH + 1U));
+    message[0] = 0xAA;
+    message[1] = 0x55;
+    message[2] = (uint8_t)source;
+    message[3] = length;
+    memcpy(&message[4], &sequence, sizeof(sequence));
+    for(uint32_t i = HEADER_LENGTH; i < length; i++)
+    {
+        message[i] = pattern_byte(source, sequence, i);
+    }
+
+    message_slot_is_queued[source][*slot_index] = 1;
+    if(debug_itf_queue_lane_owned_message(lane_id, message, length, message_released) != 0)
+    {
+        message_slot_is_queued[source][*slot_index] = 0;
+        refused_count[source] += 1;
+        __atomic_fetch_add(&refused_per_lane[lane_id], 1U, __ATOMIC_RELAXED);
+        return 0;
+    }
+
+    accepted_count[source] += 1;
+    __atomic_fetch_add(&accepted_per_lane[lane_id], 1U, __ATOMIC_RELAXED);
+    *slot_index = (*slot_index + 1U) % MESSAGE_SLOTS_COUNT;
+    return 1;
+}
+
+static DEBUG_ITF_TX_LANE source_lane( uint32_t source )
+{
+    if(source == INTERRUPT_PRODUCER_ID)
+    {
+        return DEBUG_ITF_TX_LANE_CONTROL;
+    }
+    return (source % 2U == 0) ? DEBUG_ITF_TX_LANE_BULK : DEBUG_ITF_TX_LANE_CONTROL;
+}
+
+static uint8_t test_time_is_over( void )
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec > test_end_time.tv_sec ||
+            (now.tv_sec == test_end_time.tv_sec && now.tv_nsec >= test_end_time.tv_nsec)) ? 1 : 0;
+}
+
+/**
+ * @brief Queues messages until test time is over. Thread never yields, so on a single core it is preempted by the scheduler
+ *  at random points, including inside critical sections, and the other threads spin on the lock meanwhile
+ */
+static void* producer_thread( void* argument )
+{
+    const uint32_t source = (uint32_t)(uintptr_t)argument;
+    uint32_t slot_index = 0;
+
+    while(test_time_is_over() == 0 && accepted_count[source] < MAX_MESSAGES_PER_PRODUCER)
+    {
+        queue_next_message(source, source_lane(source), &slot_index);
+    }
+
+    __atomic_fetch_sub(&producers_running, 1U, __ATOMIC_RELEASE);
+    return (void*)(0);
+}
+
+/**************************************************************************************************/
+/*                                          Consumer                                              */
+/**************************************************************************************************/
+
+static void* consumer_thread( void* argument )
+{
+    (void)argument;
+    uint32_t slot_index = 0;
+
+    while(1)
+    {
+        // Producers finish their last send() before they are counted out, so nothing can come after this check but
+        //  transfers started by this thread
+        const uint8_t producers_are_done = (__atomic_load_n(&producers_running, __ATOMIC_ACQUIRE) == 0) ? 1 : 0;
+        const uint8_t* transfer = __atomic_load_n(&pending_transfer, __ATOMIC_ACQUIRE);
+        if(transfer == (void*)(0))
+        {
+            if(producers_are_done != 0)
+            {
+                break;
+            }
+            continue;
+        }
+
+        if(received_length + pending_transfer_length > RECEIVED_STREAM_SIZE)
+        {
+            printf("FAIL: received stream overflow\n");
+            exit(1);
+        }
+        memcpy(&received_stream[received_length], transfer, pending_transfer_length);
+        received_length += pending_transfer_length;
+        transfers_count += 1;
+        __atomic_store_n(&pending_transfer, (void*)(0), __ATOMIC_RELEASE);
+
+        // TX complete interrupt, that sometimes queues a message of its own
+        debug_handle_tx();
+        if(transfers_count % 3U == 0)
+        {
+            queue_next_message(INTERRUPT_PRODUCER_ID, source_lane(INTERRUPT_PRODUCER_ID), &slot_index);
+        }
+    }
+
+    return (void*)(0);
+}
+
+/**************************************************************************************************/
+/*                                          Checks                                                */
+/**************************************************************************************************/
+
+static uint32_t failures_count = 0;
+
+static void check( int condition, const char* description, uint32_t expected, uint32_t actual )
+{
+    if(!condition)
+    {
+        printf("FAIL: %s (expected %u, got %u)\n", description, expected, actual);
+        failures_count += 1;
+    }
+}
+
+static void check_received_stream( void )
+{
+    uint32_t next_sequence[SOURCES_COUNT] = { 0 };
+    uint32_t offset = 0;
+
+    while(offset < received_length && failures_count < 10U)
+    {
+        const uint8_t* message = &received_stream[offset];
+        if(received_length - offset < HEADER_LENGTH || message[0] != 0xAA || message[1] != 0x55 ||
+                message[2] >= SOURCES_COUNT || message[3] < HEADER_LENGTH || message[3] > MAX_MESSAGE_LENGTH ||
+                received_length - offset < message[3] + TRAILER_LENGTH)
+        {
+            check(0, "message header at offset", offset, offset);
+            return;
+        }
+
+        const uint32_t source = message[2];
+        uint32_t sequence;
+        memcpy(&sequence, &message[4], sizeof(sequence));
+#ifdef STRESS_DROP_OLDEST
+        if(source_lane(source) == DEBUG_ITF_TX_LANE_BULK)
+        {
+            // Dropped messages leave gaps, but order must be kept
+            check(sequence >= next_sequence[source], "sequence number (repeated message)", next_sequence[source], sequence);
+            next_sequence[source] = sequence;
+        }
+#endif
+        check(sequence == next_sequence[source], "sequence number (lost or repeated message)", next_sequence[source], sequence);
+        next_sequence[source] = sequence + 1U;
+        received_count[source] += 1;
+
+        const uint8_t expected_length =
+                (uint8_t)(HEADER_LENGTH + (sequence * 11U + source) % (MAX_MESSAGE_LENGTH - HEADER_LENGTH + 1U));
+        check(message[3] == expected_length, "message length", expected_length, message[3]);
+        for(uint32_t i = HEADER_LENGTH; i < message[3]; i++)
+        {
+            if(message[i] != pattern_byte(source, sequence, i))
+            {
+                check(0, "message content (torn message)", pattern_byte(source, sequence, i), message[i]);
+                break;
+            }
+        }
+#ifdef STRESS_DROP_OLDEST
+        const uint16_t crc = debug_crc16_software_update(DEBUG_CRC16_INIT, message, message[3]);
+        const uint16_t trailer = (uint16_t)(message[message[3]] | (message[message[3] + 1U] << 8));
+        check(trailer == crc, "frame trailer (orphan or dropped trailer)", crc, trailer);
+#endif
+        offset += message[3] + TRAILER_LENGTH;
+    }
+
+    for(uint32_t source = 0; source < SOURCES_COUNT; source++)
+    {
+        missing_per_lane[source_lane(source)] += accepted_count[source] - received_count[source];
+    }
+#ifndef STRESS_DROP_OLDEST
+    check(missing_per_lane[DEBUG_ITF_TX_LANE_BULK] == 0, "received bulk messages", 0, missing_per_lane[DEBUG_ITF_TX_LANE_BULK]);
+#endif
+    check(missing_per_lane[DEBUG_ITF_TX_LANE_CONTROL] == 0, "received control messages", 0,
+            missing_per_lane[DEBUG_ITF_TX_LANE_CONTROL]);
+}
+
+static void check_telemetry( void )
+{
+    // Every dropped message is a separate group, so it is a separate overflow. Statistics count trailers as messages too
+    uint32_t sent_total = 0;
+    uint32_t overflows_total = 0;
+    for(uint32_t lane_id = 0; lane_id < DEBUG_ITF_TX_LANES_COUNT; lane_id++)
+    {
+        const debug_itf_tx_lane_statistics* statistics = debug_itf_get_tx_lane_statistics((DEBUG_ITF_TX_LANE)lane_id);
+        check(statistics->queued_messages_count == accepted_per_lane[lane_id] * MESSAGE_ENTRIES_COUNT, "lane queued messages",
+                accepted_per_lane[lane_id] * MESSAGE_ENTRIES_COUNT, statistics->queued_messages_count);
+        check(statistics->overflows_count == refused_per_lane[lane_id] + missing_per_lane[lane_id], "lane overflows",
+                refused_per_lane[lane_id] + missing_per_lane[lane_id], statistics->overflows_count);
+        check(statistics->dropped_newest_count == refused_per_lane[lane_id], "lane dropped newest", refused_per_lane[lane_id],
+                statistics->dropped_newest_count);
+        check(statistics->dropped_oldest_count == missing_per_lane[lane_id] * MESSAGE_ENTRIES_COUNT, "lane dropped oldest",
+                missing_per_lane[lane_id] * MESSAGE_ENTRIES_COUNT, statistics->dropped_oldest_count);
+        sent_total += (accepted_per_lane[lane_id] - missing_per_lane[lane_id]) * MESSAGE_ENTRIES_COUNT;
+        overflows_total += refused_per_lane[lane_id] + missing_per_lane[lane_id];
+    }
+
+    debug_itf_link_telemetry telemetry;
+    debug_itf_get_link_telemetry(&telemetry);
+    check(telemetry.sent_bytes_count == received_length, "sent bytes", received_length, telemetry.sent_bytes_count);
+    check(telemetry.sent_messages_count == sent_total, "sent messages", sent_total, telemetry.sent_messages_count);
+    check(telemetry.overflows_count == overflows_total, "link overflows", overflows_total, telemetry.overflows_count);
+}
+
+int main( void )
+{
+    received_stream = malloc(RECEIVED_STREAM_SIZE);
+    if(received_stream == (void*)(0))
+    {
+        return 1;
+    }
+
+    setup_debug_interface(&stress_transport);
+#ifdef STRESS_DROP_OLDEST
+    debug_itf_set_frame_crc(DEBUG_ITF_FRAME_CRC_16);
+    debug_itf_set_tx_lane_drop_policy(DEBUG_ITF_TX_LANE_BULK, DEBUG_ITF_TX_DROP_OLDEST, 0);
+#endif
+    clock_gettime(CLOCK_MONOTONIC, &test_end_time);
+    test_end_time.tv_sec += TEST_DURATION_MS / 1000U;
+    test_end_time.tv_nsec += (long)(TEST_DURATION_MS % 1000U) * 1000000L;
+    if(test_end_time.tv_nsec >= 1000000000L)
+    {
+        test_end_time.tv_sec += 1;
+        test_end_time.tv_nsec -= 1000000000L;
+    }
+
+    pthread_t consumer;
+    pthread_t producers[PRODUCERS_COUNT];
+    pthread_create(&consumer, (void*)(0), consumer_thread, (void*)(0));
+    for(uint32_t i = 0; i < PRODUCERS_COUNT; i++)
+    {
+        pthread_create(&producers[i], (void*)(0), producer_thread, (void*)(uintptr_t)i);
+    }
+    for(uint32_t i = 0; i < PRODUCERS_COUNT; i++)
+    {
+        pthread_join(producers[i], (void*)(0));
+    }
+    pthread_join(consumer, (void*)(0));
+
+    check(pending_transfer == (void*)(0), "no transfer in flight at the end", 0, 1);
+    check_received_stream();
+    check_telemetry();
+
+    uint32_t refused_total = 0;
+    for(uint32_t source = 0; source < SOURCES_COUNT; source++)
+    {
+        refused_total += refused_count[source];
+    }
+    printf("%s: %u messages in %u transfers, %u bytes, %u refused while lanes were full, %u dropped oldest\n",
+            (failures_count == 0) ? "PASS" : "FAIL", accepted_per_lane[0] + accepted_per_lane[1], transfers_count,
+            received_length, refused_total, missing_per_lane[DEBUG_ITF_TX_LANE_BULK]);
+
+    free(received_stream);
+    return (failures_count == 0) ? 0 : 1;
+}